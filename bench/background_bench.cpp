@@ -0,0 +1,206 @@
+#include "emu/apu/apu.h"
+#include "emu/cartridge/cartridge.h"
+#include "emu/cpu6502/cpu.h"
+#include "emu/memory/memorymanager.h"
+#include "emu/ppu/ppu.h"
+#include "emu/ppu/tilerow.h"
+#include "emu/system/powerhandler.h"
+#include "emu/system/simd.h"
+#include "emu/system/system.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <print>
+#include <string>
+#include <vector>
+
+
+// Background render cost per frame for three generations of the pixel loop: the original DrawTile body
+// (palette RAM read, float color conversion and four bounds checked byte stores per pixel), the per pixel
+// loop over the resolved palette, and the tile row expanders. Nametable, attributes and palette come from
+// a running game and a fine X offset is applied, so every path draws 33 tiles per line.
+
+constexpr std::uint64_t WarmupFrames = 300;
+constexpr std::uint32_t Iterations = 2000;
+constexpr std::uint32_t FineX = 3;
+
+
+// Tile rows of all 240 lines, fetched up front so only the pixel work is measured
+static auto CaptureTileRows(emu::MemoryManager& memoryManager) -> std::vector<emu::TileRow>
+{
+	std::vector<emu::TileRow> rows;
+
+	auto ppuCtrl = memoryManager.ReadPPUIO(0x2000);
+	std::uint16_t patternBase = ppuCtrl & 0x10 ? 0x100 : 0x000;
+
+	auto& tileCache = memoryManager.GetTileCache();
+
+	for (std::uint16_t y = 0; y < 240; y++)
+	{
+		for (std::uint16_t x = 0; x < 33; x++)
+		{
+			std::uint16_t column = x % 32;
+			std::uint16_t nametable = x < 32 ? 0x2000 : 0x2400;
+
+			auto tileID = memoryManager.ReadPPURAM(nametable + (y / 8) * 32 + column);
+			auto attribute = memoryManager.ReadPPURAM(nametable + 0x3C0 + (y / 32) * 8 + column / 4);
+
+			std::uint8_t paletteBase = ((attribute >> ((((y / 8) & 2) << 1) | (column & 2))) & 0x3) << 2;
+
+			rows.push_back(emu::TileRow{ &tileCache.GetTile(patternBase + tileID).PixelValues[(y % 8) * 8], paletteBase });
+		}
+	}
+
+	return rows;
+}
+
+// Colors as the PPU stored them before the resolved palette, 3 bits per channel
+static constexpr std::array<std::uint32_t, 64> PaletteColors
+{
+	0x333, 0x014, 0x006, 0x326, 0x403, 0x503, 0x510, 0x420, 0x320, 0x120, 0x031, 0x040, 0x022, 0x111, 0x000, 0x000,
+	0x555, 0x036, 0x027, 0x407, 0x507, 0x704, 0x700, 0x630, 0x430, 0x140, 0x040, 0x053, 0x044, 0x222, 0x000, 0x000,
+	0x777, 0x357, 0x447, 0x637, 0x707, 0x737, 0x740, 0x750, 0x660, 0x360, 0x070, 0x276, 0x077, 0x444, 0x000, 0x000,
+	0x777, 0x567, 0x657, 0x757, 0x747, 0x755, 0x764, 0x770, 0x773, 0x572, 0x473, 0x276, 0x467, 0x666, 0x000, 0x000,
+};
+
+static auto RenderDrawTile(const std::vector<emu::TileRow>& rows, emu::MemoryManager& memoryManager, std::vector<std::uint8_t>& image) -> void
+{
+	for (std::uint32_t y = 0; y < 240; y++)
+	{
+		for (std::uint32_t tile = 0; tile < 33; tile++)
+		{
+			auto& row = rows[y * 33 + tile];
+
+			for (std::uint32_t xIndex = 0; xIndex < 8; xIndex++)
+			{
+				std::uint8_t paletteIndex = row.PaletteBase | row.PixelValues[xIndex];
+				auto paletteColor = memoryManager.ReadPPURAM(0x3F00 + paletteIndex);
+
+				auto color = PaletteColors.at(paletteColor);
+
+				auto x = tile * 8 + xIndex - FineX;
+
+				if (x >= 256)
+					continue;
+
+				image.at((y * 256 + x) * 4 + 0) = ((color & 0x0F00) >> 8) / 7.0f * 255;
+				image.at((y * 256 + x) * 4 + 1) = ((color & 0x00F0) >> 4) / 7.0f * 255;
+				image.at((y * 256 + x) * 4 + 2) = (color & 0x000F) / 7.0f * 255;
+				image.at((y * 256 + x) * 4 + 3) = 255;
+			}
+		}
+	}
+}
+
+static auto RenderPerPixel(const std::vector<emu::TileRow>& rows, const emu::Palette& palette, std::vector<std::uint8_t>& image) -> void
+{
+	for (std::uint32_t y = 0; y < 240; y++)
+	{
+		auto line = std::span(image).subspan(y * 256 * 4, 256 * 4);
+
+		for (std::uint32_t tile = 0; tile < 33; tile++)
+		{
+			auto& row = rows[y * 33 + tile];
+
+			for (std::uint32_t xIndex = 0; xIndex < 8; xIndex++)
+			{
+				auto x = tile * 8 + xIndex - FineX;
+
+				if (x >= 256)
+					continue;
+
+				auto color = palette.GetColor(row.PaletteBase | row.PixelValues[xIndex]);
+				std::memcpy(&line[x * 4], &color, sizeof(color));
+			}
+		}
+	}
+}
+
+static auto RenderExpanded(const std::vector<emu::TileRow>& rows, const emu::Palette& palette, std::vector<std::uint8_t>& image, emu::ExpandTileRowsFn expandTileRows) -> void
+{
+	std::array<std::uint32_t, 33 * 8> lineBuffer{};
+
+	for (std::uint32_t y = 0; y < 240; y++)
+	{
+		expandTileRows(std::span(rows).subspan(y * 33, 33), palette.GetColors().data(), lineBuffer.data());
+
+		std::memcpy(&image[y * 256 * 4], &lineBuffer[FineX], 256 * sizeof(std::uint32_t));
+	}
+}
+
+template<typename Fn>
+static auto Measure(std::string_view name, std::uint32_t iterations, std::vector<std::uint8_t>& image, Fn&& fn) -> double
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	std::uint32_t checksum{ 0 };
+
+	for (std::uint32_t i = 0; i < iterations; i++)
+	{
+		fn();
+		checksum += image[(120 * 256 + 128) * 4 + (i & 3)];
+	}
+
+	auto endTime = std::chrono::steady_clock::now();
+	auto microseconds = std::chrono::duration<double, std::micro>(endTime - startTime).count() / iterations;
+
+	std::println("{:<28}: {:8.2f} us/frame  (checksum {:08x})", name, microseconds, checksum);
+
+	return microseconds;
+}
+
+
+auto main(int argc, char** argv) -> int
+{
+	std::string romPath = argc > 1 ? argv[1] : "rom/SuperMarioBros.nes";
+
+	emu::Cartridge cartridge(romPath);
+	emu::Controller controller;
+	emu::MemoryManager memoryManager(cartridge, controller);
+
+	emu::PowerHandler powerHandler{ emu::PowerState::Run };
+
+	emu::PPU ppu{ powerHandler, memoryManager, cartridge.GetAttributes().NametableMirroring };
+	emu::APU apu{ powerHandler, memoryManager };
+	emu::CPU cpu{ powerHandler, memoryManager };
+
+	emu::System system{ powerHandler, cpu, ppu, apu };
+
+	system.Reset();
+
+	for (std::uint64_t frame = 0; frame < WarmupFrames; frame++)
+		system.RunFrame();
+
+	auto rows = CaptureTileRows(memoryManager);
+	auto& palette = memoryManager.GetPalette();
+
+	std::vector<std::uint8_t> reference(256 * 240 * 4);
+	std::vector<std::uint8_t> image(256 * 240 * 4);
+
+	auto detected = emu::DetectSIMDLevel();
+
+	std::println("");
+	std::println("Detected SIMD level: {}", emu::GetSIMDLevelName(detected));
+	std::println("");
+
+	auto drawTile = Measure("DrawTile (original)", Iterations / 10, reference, [&] { RenderDrawTile(rows, memoryManager, reference); });
+	auto perPixel = Measure("Per pixel", Iterations, reference, [&] { RenderPerPixel(rows, palette, reference); });
+	std::println("{:<28}  {:.2f}x", "", drawTile / perPixel);
+
+	for (auto level : { emu::SIMDLevel::Scalar, emu::SIMDLevel::SSSE3, emu::SIMDLevel::AVX2 })
+	{
+		if (level > detected)
+			continue;
+
+		auto expandTileRows = emu::GetTileRowExpander(level);
+
+		auto expanded = Measure(std::format("Tile rows ({})", emu::GetSIMDLevelName(level)), Iterations, image, [&] { RenderExpanded(rows, palette, image, expandTileRows); });
+
+		std::println("{:<28}  {:.2f}x, {:.2f}x over per pixel{}", "", drawTile / expanded, perPixel / expanded, image == reference ? "" : "  OUTPUT MISMATCH");
+	}
+
+	return 0;
+}
@@ -0,0 +1,77 @@
+#include "emu/cartridge/cartridge.h"
+#include "emu/cpu6502/cpu.h"
+#include "emu/memory/memorymanager.h"
+#include "emu/system/powerhandler.h"
+
+#include <chrono>
+#include <cstdint>
+#include <print>
+#include <string>
+
+
+// CPU throughput of the interpreter, the block cache and the recompiler, all run in scanline sized
+// budgets as System::RunFrame does. The PPU is not running, vblank and NMI are faked once per NTSC frame.
+
+constexpr std::uint32_t CyclesPerScanline = 114;
+constexpr std::uint64_t CyclesPerFrame = 29781;
+constexpr std::uint64_t DefaultFrames = 3000;
+
+
+static auto Measure(const std::string& romPath, bool blockCache, bool recompiler, std::uint64_t frames) -> double
+{
+	emu::Cartridge cartridge(romPath);
+	emu::Controller controller;
+	emu::MemoryManager memoryManager(cartridge, controller);
+	emu::PowerHandler powerHandler{ emu::PowerState::Run };
+	emu::CPU cpu{ powerHandler, memoryManager };
+
+	cpu.SetBlockCacheEnabled(blockCache);
+	cpu.SetRecompilerEnabled(recompiler);
+	cpu.Reset();
+
+	std::uint64_t nextFrame{ CyclesPerFrame };
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	while (cpu.GetCycles() < frames * CyclesPerFrame)
+	{
+		cpu.Run(CyclesPerScanline);
+
+		if (cpu.GetCycles() >= nextFrame)
+		{
+			nextFrame += CyclesPerFrame;
+
+			memoryManager.SetPPUIOBit(0x2002, 0x80);
+
+			if (memoryManager.ReadPPUIO(0x2000) & 0x80)
+				memoryManager.TriggerNMI();
+		}
+	}
+
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	auto cyclesPerSecond = cpu.GetCycles() / seconds;
+
+	std::println("{:<12}: {:8.1f} M cycles/s  {:6.1f}x realtime  ({} blocks, {} compiled)", recompiler ? "Recompiler" : blockCache ? "Block cache" : "Interpreter",
+		cyclesPerSecond / 1e6, cyclesPerSecond / 1'789'773.0, cpu.GetBlockCache().GetBlockCount(), cpu.GetRecompiler().GetCompiledBlocks());
+
+	return cyclesPerSecond;
+}
+
+
+auto main(int argc, char** argv) -> int
+{
+	std::string romPath = argc > 1 ? argv[1] : "rom/SuperMarioBros.nes";
+	std::uint64_t frames = argc > 2 ? std::stoull(argv[2]) : DefaultFrames;
+
+	std::println("");
+
+	auto interpreter = Measure(romPath, false, false, frames);
+	auto blockCache = Measure(romPath, true, false, frames);
+	auto recompiler = Measure(romPath, true, true, frames);
+
+	std::println("");
+	std::println("Block cache : {:.2f}x", blockCache / interpreter);
+	std::println("Recompiler  : {:.2f}x", recompiler / interpreter);
+
+	return 0;
+}
@@ -0,0 +1,155 @@
+#include "emu/cartridge/cartridge.h"
+#include "emu/memory/memorymanager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <print>
+#include <random>
+#include <string>
+#include <vector>
+
+
+// Compares the page table bus against the address range if-chain that CPU::ReadAddress used before.
+// The access mix resembles a running game: zero page, stack, work RAM and program ROM fetches.
+
+constexpr std::size_t AddressCount = 1 << 20;
+constexpr std::uint32_t Iterations = 64;
+
+
+static auto LegacyRead(emu::MemoryManager& memoryManager, std::uint16_t address) -> std::uint8_t
+{
+	if (address >= 0x2000 && address < 0x2008)
+		return memoryManager.ReadPPUIO(address);
+	else if (address >= 0x4000 && address < 0x4018)
+		return memoryManager.ReadAPUIO(address);
+	else if (address < 0x8000)
+		return memoryManager.ReadCPURAM(address);
+
+	return memoryManager.ReadProgramROM(address);
+}
+
+static auto LegacyWrite(emu::MemoryManager& memoryManager, std::uint16_t address, std::uint8_t value) -> void
+{
+	if (address >= 0x2000 && address < 0x2008)
+	{
+		memoryManager.WritePPUIO(address, value);
+		return;
+	}
+
+	if (address >= 0x4000 && address < 0x4018)
+	{
+		memoryManager.WriteAPUIO(address, value);
+		return;
+	}
+
+	memoryManager.WriteCPURAM(address, value);
+}
+
+static auto GenerateAddresses(std::uint32_t programROMSize) -> std::vector<std::uint16_t>
+{
+	std::mt19937 generator{ 6502 };
+	std::uniform_int_distribution<std::uint32_t> region{ 0, 99 };
+	std::uniform_int_distribution<std::uint32_t> byte{ 0x00, 0xFF };
+	std::uniform_int_distribution<std::uint32_t> ram{ 0x200, 0x7FF };
+	std::uniform_int_distribution<std::uint32_t> rom{ 0x0000, programROMSize - 1 };
+
+	std::vector<std::uint16_t> addresses(AddressCount);
+
+	for (auto& address : addresses)
+	{
+		auto r = region(generator);
+
+		if (r < 30)
+			address = static_cast<std::uint16_t>(byte(generator));
+		else if (r < 40)
+			address = static_cast<std::uint16_t>(0x100 + byte(generator));
+		else if (r < 50)
+			address = static_cast<std::uint16_t>(ram(generator));
+		else
+			address = static_cast<std::uint16_t>(0x8000 + rom(generator));
+	}
+
+	return addresses;
+}
+
+template<typename Fn>
+static auto Measure(std::string_view name, std::size_t accessCount, Fn&& fn) -> double
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	auto checksum = fn();
+
+	auto endTime = std::chrono::steady_clock::now();
+	auto seconds = std::chrono::duration<double>(endTime - startTime).count();
+	auto nanoseconds = seconds * 1e9 / (static_cast<double>(accessCount) * Iterations);
+
+	std::println("{:<24}: {:6.2f} ns/access  (checksum {:08x})", name, nanoseconds, checksum);
+
+	return nanoseconds;
+}
+
+
+auto main(int argc, char** argv) -> int
+{
+	std::string romPath = argc > 1 ? argv[1] : "rom/SuperMarioBros.nes";
+
+	emu::Cartridge cartridge(romPath);
+	emu::Controller controller;
+	emu::MemoryManager memoryManager(cartridge, controller);
+
+	auto programROMSize = std::min<std::uint32_t>(cartridge.GetROM(emu::ROMType::Program).GetSize(), 0x8000);
+	auto addresses = GenerateAddresses(programROMSize);
+
+	std::vector<std::uint16_t> ramAddresses{};
+	std::ranges::copy_if(addresses, std::back_inserter(ramAddresses), [](auto address) { return address < 0x800; });
+
+	std::println("");
+
+	auto legacyRead = Measure("Read  (if-chain)", addresses.size(), [&]
+	{
+		std::uint32_t checksum{ 0 };
+
+		for (std::uint32_t i = 0; i < Iterations; i++)
+			for (auto address : addresses)
+				checksum += LegacyRead(memoryManager, address);
+
+		return checksum;
+	});
+
+	auto pageRead = Measure("Read  (page table)", addresses.size(), [&]
+	{
+		std::uint32_t checksum{ 0 };
+
+		for (std::uint32_t i = 0; i < Iterations; i++)
+			for (auto address : addresses)
+				checksum += memoryManager.ReadBus(address);
+
+		return checksum;
+	});
+
+	auto legacyWrite = Measure("Write (if-chain)", ramAddresses.size(), [&]
+	{
+		for (std::uint32_t i = 0; i < Iterations; i++)
+			for (auto address : ramAddresses)
+				LegacyWrite(memoryManager, address, static_cast<std::uint8_t>(address + i));
+
+		return static_cast<std::uint32_t>(memoryManager.ReadCPURAM(0x10));
+	});
+
+	auto pageWrite = Measure("Write (page table)", ramAddresses.size(), [&]
+	{
+		for (std::uint32_t i = 0; i < Iterations; i++)
+			for (auto address : ramAddresses)
+				memoryManager.WriteBus(address, static_cast<std::uint8_t>(address + i));
+
+		return static_cast<std::uint32_t>(memoryManager.ReadCPURAM(0x10));
+	});
+
+	std::println("");
+	std::println("Read speedup  : {:.2f}x", legacyRead / pageRead);
+	std::println("Write speedup : {:.2f}x", legacyWrite / pageWrite);
+
+	return 0;
+}
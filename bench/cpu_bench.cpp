@@ -0,0 +1,61 @@
+#include "emu/cartridge/cartridge.h"
+#include "emu/cpu6502/cpu.h"
+#include "emu/memory/memorymanager.h"
+#include "emu/system/powerhandler.h"
+
+#include <chrono>
+#include <cstdint>
+#include <print>
+#include <string>
+
+
+// Measures raw interpreter throughput (instructions per second) without any cycle pacing.
+// The PPU is not running, so vblank and NMI are faked once per NTSC frame worth of CPU cycles.
+
+constexpr std::uint64_t CyclesPerFrame = 29781;
+constexpr std::uint64_t DefaultInstructions = 50'000'000;
+
+
+auto main(int argc, char** argv) -> int
+{
+	std::string romPath = argc > 1 ? argv[1] : "rom/SuperMarioBros.nes";
+	std::uint64_t instructionCount = argc > 2 ? std::stoull(argv[2]) : DefaultInstructions;
+
+	emu::Cartridge cartridge(romPath);
+	emu::Controller controller;
+	emu::MemoryManager memoryManager(cartridge, controller);
+	emu::PowerHandler powerHandler{ emu::PowerState::Run };
+	emu::CPU cpu{ powerHandler, memoryManager };
+
+	cpu.Reset();
+
+	std::uint64_t nextFrame{ CyclesPerFrame };
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	for (std::uint64_t instruction = 0; instruction < instructionCount; instruction++)
+	{
+		cpu.Step();
+
+		if (cpu.GetCycles() >= nextFrame)
+		{
+			nextFrame += CyclesPerFrame;
+
+			memoryManager.SetPPUIOBit(0x2002, 0x80);
+
+			if (memoryManager.ReadPPUIO(0x2000) & 0x80)
+				memoryManager.TriggerNMI();
+		}
+	}
+
+	auto endTime = std::chrono::steady_clock::now();
+	auto seconds = std::chrono::duration<double>(endTime - startTime).count();
+
+	std::println("Instructions      : {}", instructionCount);
+	std::println("CPU cycles        : {}", cpu.GetCycles());
+	std::println("Elapsed time      : {:.3f} s", seconds);
+	std::println("Instructions/sec  : {:.0f}", instructionCount / seconds);
+	std::println("Emulated speed    : {:.1f}x realtime (NTSC)", (cpu.GetCycles() / 1'789'773.0) / seconds);
+
+	return 0;
+}
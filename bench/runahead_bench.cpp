@@ -0,0 +1,74 @@
+#include "emu/apu/apu.h"
+#include "emu/cartridge/cartridge.h"
+#include "emu/cpu6502/cpu.h"
+#include "emu/memory/memorymanager.h"
+#include "emu/ppu/ppu.h"
+#include "emu/system/powerhandler.h"
+#include "emu/system/system.h"
+
+#include <chrono>
+#include <cstdint>
+#include <print>
+#include <string>
+
+
+// Host frames per second each run-ahead depth sustains. A host frame runs depth + 1 emulated frames,
+// of which only the last one is drawn, plus a save and a load. Runs SMB in play with Right held.
+
+constexpr std::uint64_t WarmupFrames = 600;
+constexpr std::uint32_t HostFrames = 600;
+constexpr std::uint32_t MaxDepth = 4;
+
+constexpr double NTSCFramesPerSecond = 60.0988;
+
+
+auto main(int argc, char** argv) -> int
+{
+	std::string romPath = argc > 1 ? argv[1] : "rom/SuperMarioBros.nes";
+
+	emu::Cartridge cartridge(romPath);
+	emu::Controller controller;
+	emu::MemoryManager memoryManager(cartridge, controller);
+
+	emu::PowerHandler powerHandler{ emu::PowerState::Run };
+
+	emu::PPU ppu{ powerHandler, memoryManager, cartridge.GetAttributes().NametableMirroring };
+	emu::APU apu{ powerHandler, memoryManager };
+	emu::CPU cpu{ powerHandler, memoryManager };
+
+	emu::System system{ powerHandler, cpu, ppu, apu };
+
+	system.Reset();
+
+	for (std::uint64_t frame = 0; frame < WarmupFrames; frame++)
+	{
+		controller.SetButtonBits(frame >= 40 && frame < 45 ? 0x08 : 0x00);
+		system.RunFrame();
+	}
+
+	controller.SetButtonBits(0x80);
+
+	emu::MachineState start{};
+	system.SaveState(start);
+
+	std::println("");
+	std::println("Depth   Host fps   Emulated fps   Realtime");
+
+	for (std::uint32_t depth = 0; depth <= MaxDepth; depth++)
+	{
+		system.LoadState(start);
+		system.SetRunAhead(depth);
+
+		auto startTime = std::chrono::steady_clock::now();
+
+		for (std::uint32_t frame = 0; frame < HostFrames; frame++)
+			system.RunFrameAhead();
+
+		auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		auto hostFPS = HostFrames / seconds;
+
+		std::println("{:>5}   {:8.0f}   {:12.0f}   {:7.1f}x", depth, hostFPS, hostFPS * (depth + 1), hostFPS / NTSCFramesPerSecond);
+	}
+
+	return 0;
+}
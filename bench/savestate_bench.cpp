@@ -0,0 +1,91 @@
+#include "emu/apu/apu.h"
+#include "emu/cartridge/cartridge.h"
+#include "emu/cpu6502/cpu.h"
+#include "emu/memory/memorymanager.h"
+#include "emu/ppu/ppu.h"
+#include "emu/system/powerhandler.h"
+#include "emu/system/savestate.h"
+#include "emu/system/system.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <print>
+#include <string>
+#include <vector>
+
+
+// Save and load of the whole console into a binary state, taken from a running game. Save copies the
+// state out into a byte buffer as a file write would, load copies it back first.
+
+constexpr std::uint64_t WarmupFrames = 600;
+constexpr std::uint32_t Iterations = 20000;
+
+
+template<typename Fn>
+static auto Measure(std::string_view name, std::uint32_t iterations, Fn&& fn) -> double
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	std::uint32_t checksum{ 0 };
+
+	for (std::uint32_t i = 0; i < iterations; i++)
+		checksum += fn();
+
+	auto endTime = std::chrono::steady_clock::now();
+	auto microseconds = std::chrono::duration<double, std::micro>(endTime - startTime).count() / iterations;
+
+	std::println("{:<20}: {:8.2f} us  (checksum {:08x})", name, microseconds, checksum);
+
+	return microseconds;
+}
+
+
+auto main(int argc, char** argv) -> int
+{
+	std::string romPath = argc > 1 ? argv[1] : "rom/SuperMarioBros.nes";
+
+	emu::Cartridge cartridge(romPath);
+	emu::Controller controller;
+	emu::MemoryManager memoryManager(cartridge, controller);
+
+	emu::PowerHandler powerHandler{ emu::PowerState::Run };
+
+	emu::PPU ppu{ powerHandler, memoryManager, cartridge.GetAttributes().NametableMirroring };
+	emu::APU apu{ powerHandler, memoryManager };
+	emu::CPU cpu{ powerHandler, memoryManager };
+
+	emu::System system{ powerHandler, cpu, ppu, apu };
+
+	system.Reset();
+
+	for (std::uint64_t frame = 0; frame < WarmupFrames; frame++)
+		system.RunFrame();
+
+	auto state = std::make_unique<emu::MachineState>();
+	std::vector<std::uint8_t> file(sizeof(emu::MachineState));
+
+	std::println("");
+	std::println("State size          : {} bytes", sizeof(emu::MachineState));
+
+	auto save = Measure("SaveState", Iterations, [&]
+	{
+		system.SaveState(*state);
+		std::memcpy(file.data(), state.get(), file.size());
+
+		return static_cast<std::uint32_t>(file[sizeof(emu::SaveStateHeader)]);
+	});
+
+	auto load = Measure("LoadState", Iterations, [&]
+	{
+		std::memcpy(state.get(), file.data(), file.size());
+
+		return static_cast<std::uint32_t>(system.LoadState(*state));
+	});
+
+	std::println("");
+	std::println("Save + load : {:.2f} us", save + load);
+
+	return 0;
+}
@@ -0,0 +1,256 @@
+#include "emu/apu/apu.h"
+#include "emu/cartridge/cartridge.h"
+#include "emu/cpu6502/cpu.h"
+#include "emu/memory/memorymanager.h"
+#include "emu/ppu/ppu.h"
+#include "emu/ppu/tilecache.h"
+#include "emu/system/powerhandler.h"
+#include "emu/system/system.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <print>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// Compares frame rendering through the flat TileCache against the hash map of decoded tiles the PPU
+// used before. Nametable, attributes, palette and OAM are taken from a running game, so both renderers
+// draw the same real frame. Palette RAM is copied out once, only the tile lookup differs.
+
+constexpr std::uint64_t WarmupFrames = 300;
+constexpr std::uint32_t Iterations = 2000;
+
+
+struct LegacyTileData
+{
+	std::array<std::uint8_t, 64> PixelValues;
+};
+
+using LegacyTilemap = std::unordered_map<std::uint16_t, LegacyTileData>;
+
+static auto LegacyLoadTiles(emu::MemoryManager& memoryManager) -> LegacyTilemap
+{
+	LegacyTilemap tilemap;
+
+	for (std::uint16_t tileID = 0; tileID < 512; tileID++)
+	{
+		LegacyTileData newTileData;
+
+		std::vector<std::uint8_t> tileData(16);
+		std::uint16_t tileByteAddress = 0;
+
+		for (auto& tileByte : tileData)
+		{
+			tileByte = memoryManager.ReadCharROM(tileID * 16u + tileByteAddress++);
+		}
+
+		auto index{ 0u };
+
+		for (auto row = 0; row < 8; row++)
+		{
+			for (auto col = 0; col < 8; col++)
+			{
+				auto pixelValue{ 0u };
+
+				if (tileData.at(row) & 1 << (7 - col)) pixelValue += 1;
+				if (tileData.at(row + 8) & 1 << (7 - col)) pixelValue += 2;
+
+				newTileData.PixelValues[index++] = pixelValue;
+			}
+		}
+
+		tilemap[tileID] = newTileData;
+	}
+
+	return tilemap;
+}
+
+
+struct FrameState
+{
+	std::array<std::uint16_t, 32 * 30> Tiles{};
+	std::array<std::uint8_t, 32 * 30> Attributes{};
+	std::array<std::uint8_t, 0x100> OAM{};
+	std::array<std::uint8_t, 0x20> Palette{};
+	std::uint16_t SpriteBase{ 0 };
+};
+
+static auto CaptureFrameState(emu::MemoryManager& memoryManager) -> FrameState
+{
+	FrameState state{};
+
+	auto ppuCtrl = memoryManager.ReadPPUIO(0x2000);
+	std::uint16_t backgroundBase = ppuCtrl & 0x10 ? 0x100 : 0x000;
+	state.SpriteBase = ppuCtrl & 0x08 ? 0x100 : 0x000;
+
+	auto attributes = memoryManager.GetAttributeTable(0);
+
+	for (std::uint16_t y = 0; y < 30; y++)
+	{
+		std::array<std::uint8_t, 32> row;
+		memoryManager.ReadNametableRow(0, static_cast<std::uint8_t>(y), row);
+
+		for (std::uint16_t x = 0; x < 32; x++)
+		{
+			state.Tiles[y * 32 + x] = row[x] + backgroundBase;
+
+			auto attribute = attributes[(y / 4) * 8 + x / 4];
+			state.Attributes[y * 32 + x] = (attribute >> (((y & 2) << 1) | (x & 2))) & 0x3;
+		}
+	}
+
+	std::ranges::copy(memoryManager.GetMemoryMap().OAMRAM.Data, state.OAM.begin());
+	std::ranges::copy(memoryManager.GetPaletteRAM(), state.Palette.begin());
+
+	return state;
+}
+
+// Whole frame pixel path of the former PPU::GenerateImageData, with the tile lookup supplied by the caller
+template<typename GetPixel>
+static auto RenderFrame(const FrameState& state, std::vector<std::uint8_t>& image, GetPixel&& getPixel) -> void
+{
+	for (std::uint16_t y = 0; y < 30; y++)
+	{
+		for (std::uint16_t x = 0; x < 32; x++)
+		{
+			auto tileID = state.Tiles[y * 32 + x];
+			auto attribute = state.Attributes[y * 32 + x];
+
+			for (auto yIndex = 0; yIndex < 8; yIndex++)
+			{
+				for (auto xIndex = 0; xIndex < 8; xIndex++)
+				{
+					auto pixelValue = getPixel(tileID, yIndex * 8 + xIndex);
+					auto color = state.Palette[(attribute << 2) | pixelValue];
+
+					auto offset = ((y * 8 + yIndex) * 256 + x * 8 + xIndex) * 4;
+					image[offset + 0] = color;
+					image[offset + 1] = color;
+					image[offset + 2] = color;
+					image[offset + 3] = 255;
+				}
+			}
+		}
+	}
+
+	for (auto sprite = 0; sprite < 64; sprite++)
+	{
+		auto spriteY = state.OAM[sprite * 4];
+		auto tileID = static_cast<std::uint16_t>(state.OAM[sprite * 4 + 1] + state.SpriteBase);
+		auto attribute = state.OAM[sprite * 4 + 2];
+		auto spriteX = state.OAM[sprite * 4 + 3];
+
+		if (spriteY >= 0xEF || spriteX >= 0xF9)
+			continue;
+
+		for (auto yIndex = 0; yIndex < 8; yIndex++)
+		{
+			for (auto xIndex = 0; xIndex < 8; xIndex++)
+			{
+				auto pixelValue = getPixel(tileID, yIndex * 8 + xIndex);
+
+				if (pixelValue == 0 || spriteY + yIndex >= 240)
+					continue;
+
+				auto color = state.Palette[0x10 | ((attribute & 0x3) << 2) | pixelValue];
+
+				auto offset = ((spriteY + yIndex) * 256 + spriteX + xIndex) * 4;
+				image[offset + 0] = color;
+				image[offset + 1] = color;
+				image[offset + 2] = color;
+				image[offset + 3] = 255;
+			}
+		}
+	}
+}
+
+template<typename Fn>
+static auto Measure(std::string_view name, std::uint32_t iterations, Fn&& fn) -> double
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	std::uint32_t checksum{ 0 };
+
+	for (std::uint32_t i = 0; i < iterations; i++)
+		checksum += fn();
+
+	auto endTime = std::chrono::steady_clock::now();
+	auto microseconds = std::chrono::duration<double, std::micro>(endTime - startTime).count() / iterations;
+
+	std::println("{:<28}: {:8.2f} us  (checksum {:08x})", name, microseconds, checksum);
+
+	return microseconds;
+}
+
+
+auto main(int argc, char** argv) -> int
+{
+	std::string romPath = argc > 1 ? argv[1] : "rom/SuperMarioBros.nes";
+
+	emu::Cartridge cartridge(romPath);
+	emu::Controller controller;
+	emu::MemoryManager memoryManager(cartridge, controller);
+
+	emu::PowerHandler powerHandler{ emu::PowerState::Run };
+
+	emu::PPU ppu{ powerHandler, memoryManager, cartridge.GetAttributes().NametableMirroring };
+	emu::APU apu{ powerHandler, memoryManager };
+	emu::CPU cpu{ powerHandler, memoryManager };
+
+	emu::System system{ powerHandler, cpu, ppu, apu };
+
+	system.Reset();
+
+	for (std::uint64_t frame = 0; frame < WarmupFrames; frame++)
+		system.RunFrame();
+
+	auto state = CaptureFrameState(memoryManager);
+	std::vector<std::uint8_t> image(256 * 240 * 4);
+
+	std::println("");
+
+	auto legacyLoad = Measure("Tile decode (hash map, all)", 100, [&]
+	{
+		return static_cast<std::uint32_t>(LegacyLoadTiles(memoryManager).size());
+	});
+
+	auto cacheLoad = Measure("Tile decode (flat, all)", 100, [&]
+	{
+		emu::TileCache tileCache;
+		tileCache.SetPatternData(memoryManager.GetMemoryMap().CharROM.Data);
+
+		std::uint32_t checksum{ 0 };
+
+		for (std::uint16_t tileID = 0; tileID < emu::TileCache::TileCount; tileID++)
+			checksum += tileCache.GetTile(tileID).PixelValues[9];
+
+		return checksum;
+	});
+
+	auto tilemap = LegacyLoadTiles(memoryManager);
+	auto& tileCache = memoryManager.GetTileCache();
+
+	auto legacyFrame = Measure("Frame render (hash map)", Iterations, [&]
+	{
+		RenderFrame(state, image, [&](std::uint16_t tileID, int pixel) { return tilemap.at(tileID).PixelValues.at(pixel); });
+
+		return static_cast<std::uint32_t>(image[(120 * 256 + 128) * 4]);
+	});
+
+	auto cacheFrame = Measure("Frame render (flat cache)", Iterations, [&]
+	{
+		RenderFrame(state, image, [&](std::uint16_t tileID, int pixel) { return tileCache.GetTile(tileID).PixelValues[pixel]; });
+
+		return static_cast<std::uint32_t>(image[(120 * 256 + 128) * 4]);
+	});
+
+	std::println("");
+	std::println("Decode speedup : {:.2f}x", legacyLoad / cacheLoad);
+	std::println("Render speedup : {:.2f}x", legacyFrame / cacheFrame);
+
+	return 0;
+}
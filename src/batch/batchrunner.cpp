@@ -0,0 +1,256 @@
+#include "batch/batchrunner.h"
+
+#include "batch/threadpool.h"
+#include "emu/apu/apu.h"
+#include "emu/cpu6502/cpu.h"
+#include "emu/memory/memorymanager.h"
+#include "emu/ppu/ppu.h"
+#include "emu/system/hash.h"
+#include "emu/system/powerhandler.h"
+#include "emu/system/system.h"
+#include "input/controller.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <print>
+#include <sstream>
+#include <string_view>
+
+
+namespace emu
+{
+
+	static auto Trim(std::string_view text) -> std::string_view
+	{
+		auto first = text.find_first_not_of(" \t\r");
+
+		if (first == std::string_view::npos)
+			return {};
+
+		auto last = text.find_last_not_of(" \t\r");
+
+		return text.substr(first, last - first + 1);
+	}
+
+	static auto ResolvePath(const std::filesystem::path& basePath, std::string_view text) -> std::filesystem::path
+	{
+		std::filesystem::path path{ text };
+
+		if (path.empty() || path.is_absolute())
+			return path;
+
+		return basePath / path;
+	}
+
+
+	auto LoadManifest(const std::filesystem::path& manifestPath) -> std::vector<BatchJob>
+	{
+		std::vector<BatchJob> jobs;
+
+		std::ifstream fs(manifestPath);
+
+		if (!fs.is_open())
+		{
+			std::println("Failed to open manifest: {}", manifestPath.string());
+			return jobs;
+		}
+
+		auto basePath = manifestPath.parent_path();
+
+		std::string line;
+		std::uint32_t lineNumber{ 0 };
+
+		while (std::getline(fs, line))
+		{
+			lineNumber++;
+
+			auto text = Trim(line);
+
+			if (text.empty() || text.front() == '#')
+				continue;
+
+			std::vector<std::string_view> fields;
+
+			while (true)
+			{
+				auto separator = text.find(',');
+				fields.push_back(Trim(text.substr(0, separator)));
+
+				if (separator == std::string_view::npos)
+					break;
+
+				text.remove_prefix(separator + 1);
+			}
+
+			BatchJob job{};
+
+			if (fields.size() != 3 || std::from_chars(fields[2].data(), fields[2].data() + fields[2].size(), job.FrameCount).ec != std::errc{})
+			{
+				std::println("Manifest line {} skipped, expected: rom, input, frames", lineNumber);
+				continue;
+			}
+
+			job.ROMPath = ResolvePath(basePath, fields[0]);
+
+			if (fields[1] != "-")
+				job.InputPath = ResolvePath(basePath, fields[1]);
+
+			jobs.push_back(job);
+		}
+
+		return jobs;
+	}
+
+	auto LoadInputEvents(const std::filesystem::path& inputPath) -> std::vector<InputEvent>
+	{
+		std::vector<InputEvent> events;
+
+		std::ifstream fs(inputPath);
+
+		if (!fs.is_open())
+		{
+			std::println("Failed to open input file: {}", inputPath.string());
+			return events;
+		}
+
+		std::string line;
+
+		while (std::getline(fs, line))
+		{
+			auto text = Trim(line);
+
+			if (text.empty() || text.front() == '#')
+				continue;
+
+			std::istringstream stream{ std::string(text) };
+
+			std::uint64_t frame{};
+			std::uint32_t buttons{};
+
+			if (stream >> frame >> std::hex >> buttons)
+				events.push_back(InputEvent{ frame, static_cast<std::uint8_t>(buttons) });
+		}
+
+		std::ranges::stable_sort(events, {}, &InputEvent::Frame);
+
+		return events;
+	}
+
+
+	BatchRunner::BatchRunner(std::vector<BatchJob> jobs)
+		: m_Jobs(std::move(jobs))
+	{
+		m_Results.resize(m_Jobs.size());
+	}
+
+	auto BatchRunner::Run(std::size_t threadCount) -> void
+	{
+		// Every ROM is parsed once, all runs of the same ROM read its PRG/CHR data in place
+		for (auto& job : m_Jobs)
+		{
+			if (!m_Cartridges.contains(job.ROMPath) && std::filesystem::exists(job.ROMPath))
+				m_Cartridges[job.ROMPath] = std::make_unique<Cartridge>(job.ROMPath);
+
+			if (!job.InputPath.empty() && !m_InputEvents.contains(job.InputPath))
+				m_InputEvents[job.InputPath] = LoadInputEvents(job.InputPath);
+		}
+
+		static const std::vector<InputEvent> NoInput{};
+
+		ThreadPool threadPool(threadCount);
+
+		std::println("Running {} jobs on {} threads", m_Jobs.size(), threadPool.GetThreadCount());
+
+		for (std::size_t index = 0; index < m_Jobs.size(); index++)
+		{
+			auto& job = m_Jobs[index];
+
+			if (!m_Cartridges.contains(job.ROMPath))
+			{
+				std::println("ROM file not found: {}", job.ROMPath.string());
+				continue;
+			}
+
+			auto& cartridge = *m_Cartridges.at(job.ROMPath);
+			auto& inputEvents = job.InputPath.empty() ? NoInput : m_InputEvents.at(job.InputPath);
+
+			threadPool.Submit([this, index, &job, &cartridge, &inputEvents]
+				{
+					m_Results[index] = RunJob(job, cartridge, inputEvents);
+				});
+		}
+
+		threadPool.Wait();
+
+		std::println("Finished, {} jobs were stolen between workers", threadPool.GetStolenJobCount());
+	}
+
+	auto BatchRunner::RunJob(const BatchJob& job, const Cartridge& cartridge, const std::vector<InputEvent>& inputEvents) -> BatchResult
+	{
+		BatchResult result{};
+
+		Controller controller;
+		MemoryManager memoryManager(cartridge, controller);
+
+		PowerHandler powerHandler{ PowerState::Run };
+
+		PPU ppu{ powerHandler, memoryManager, cartridge.GetAttributes().NametableMirroring };
+		APU apu{ powerHandler, memoryManager };
+		CPU cpu{ powerHandler, memoryManager };
+
+		System system{ powerHandler, cpu, ppu, apu };
+
+		system.Reset();
+
+		auto nextEvent = inputEvents.begin();
+
+		auto startTime = std::chrono::steady_clock::now();
+
+		for (std::uint64_t frame = 0; frame < job.FrameCount; frame++)
+		{
+			while (nextEvent != inputEvents.end() && nextEvent->Frame <= frame)
+			{
+				controller.SetButtonBits(nextEvent->Buttons);
+				nextEvent++;
+			}
+
+			// Nothing resumes a suspended console here, the job ends as failed
+			if (!system.RunFrame())
+				break;
+
+			result.Frames++;
+		}
+
+		auto endTime = std::chrono::steady_clock::now();
+
+		auto& map = memoryManager.GetMemoryMap();
+
+		result.FramebufferHash = HashBytes(ppu.GetFrameExchange().AcquireLatest().Pixels);
+		result.RAMHash = HashBytes(map.ProgramRAM.Data, HashBytes(map.CPURAM.Data));
+		result.ElapsedMilliseconds = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+		result.Completed = result.Frames == job.FrameCount;
+
+		return result;
+	}
+
+	auto BatchRunner::WriteCSV(std::ostream& output) const -> void
+	{
+		output << "rom,input,frames,status,framebuffer_hash,ram_hash,elapsed_ms,fps\n";
+
+		for (std::size_t index = 0; index < m_Jobs.size(); index++)
+		{
+			auto& job = m_Jobs[index];
+			auto& result = m_Results[index];
+
+			auto fps = result.ElapsedMilliseconds > 0.0 ? result.Frames / (result.ElapsedMilliseconds / 1000.0) : 0.0;
+
+			output << std::format("\"{}\",\"{}\",{},{},{:016x},{:016x},{:.3f},{:.1f}\n",
+				job.ROMPath.string(), job.InputPath.string(), job.FrameCount, result.Completed ? "ok" : "failed",
+				result.FramebufferHash, result.RAMHash, result.ElapsedMilliseconds, fps);
+		}
+	}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "emu/cartridge/cartridge.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+namespace emu
+{
+
+	// One manifest line: "rom path, input path, frame count". The input path may be empty or "-".
+	struct BatchJob
+	{
+		std::filesystem::path ROMPath{};
+		std::filesystem::path InputPath{};
+		std::uint64_t FrameCount{ 0 };
+	};
+
+	struct BatchResult
+	{
+		std::uint64_t FramebufferHash{ 0 };
+		std::uint64_t RAMHash{ 0 };
+		double ElapsedMilliseconds{ 0.0 };
+		// Fewer than the job asked for when the CPU stopped on an invalid opcode
+		std::uint64_t Frames{ 0 };
+		bool Completed{ false };
+	};
+
+	// Controller state per frame, each entry holds until the next one. Input files contain
+	// "frame buttons" lines where buttons is a hex mask in Button order (bit 0 = A, bit 7 = Right).
+	struct InputEvent
+	{
+		std::uint64_t Frame{ 0 };
+		std::uint8_t Buttons{ 0 };
+	};
+
+	auto LoadManifest(const std::filesystem::path& manifestPath) -> std::vector<BatchJob>;
+	auto LoadInputEvents(const std::filesystem::path& inputPath) -> std::vector<InputEvent>;
+
+	class BatchRunner
+	{
+	public:
+		explicit BatchRunner(std::vector<BatchJob> jobs);
+
+		auto Run(std::size_t threadCount) -> void;
+		auto WriteCSV(std::ostream& output) const -> void;
+
+		auto GetResults() const -> const std::vector<BatchResult>& { return m_Results; }
+
+	private:
+		auto RunJob(const BatchJob& job, const Cartridge& cartridge, const std::vector<InputEvent>& inputEvents) -> BatchResult;
+
+	private:
+		std::vector<BatchJob> m_Jobs;
+		std::vector<BatchResult> m_Results;
+
+		// Loaded once per distinct file before any run starts, then only read
+		std::map<std::filesystem::path, std::unique_ptr<Cartridge>> m_Cartridges;
+		std::map<std::filesystem::path, std::vector<InputEvent>> m_InputEvents;
+	};
+
+}
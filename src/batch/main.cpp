@@ -0,0 +1,49 @@
+#include "batch/batchrunner.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <print>
+#include <string>
+#include <thread>
+
+
+// Runs every line of a manifest headless on a thread pool and writes one CSV row per run
+
+auto main(int argc, char** argv) -> int
+{
+	if (argc < 3)
+	{
+		std::println("Usage: rexxnes-batch <manifest> <output csv> [thread count]");
+		return -1;
+	}
+
+	std::filesystem::path manifestPath = argv[1];
+	std::filesystem::path outputPath = argv[2];
+	std::size_t threadCount = argc > 3 ? std::stoul(argv[3]) : std::thread::hardware_concurrency();
+
+	auto jobs = emu::LoadManifest(manifestPath);
+
+	if (jobs.empty())
+	{
+		std::println("No jobs in manifest: {}", manifestPath.string());
+		return -1;
+	}
+
+	emu::BatchRunner batchRunner(std::move(jobs));
+	batchRunner.Run(threadCount);
+
+	std::ofstream output(outputPath);
+
+	if (!output.is_open())
+	{
+		std::println("Failed to open output file: {}", outputPath.string());
+		return -1;
+	}
+
+	batchRunner.WriteCSV(output);
+
+	std::println("Results written to {}", outputPath.string());
+
+	return 0;
+}
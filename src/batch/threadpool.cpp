@@ -0,0 +1,138 @@
+#include "batch/threadpool.h"
+
+#include <algorithm>
+
+
+namespace emu
+{
+
+
+	ThreadPool::ThreadPool(std::size_t threadCount)
+	{
+		threadCount = std::max<std::size_t>(threadCount, 1);
+
+		for (std::size_t i = 0; i < threadCount; i++)
+		{
+			m_Queues.push_back(std::make_unique<WorkQueue>());
+		}
+
+		for (std::size_t i = 0; i < threadCount; i++)
+		{
+			m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stopping = true;
+		}
+
+		m_WorkCV.notify_all();
+
+		for (auto& worker : m_Workers)
+		{
+			worker.join();
+		}
+	}
+
+	auto ThreadPool::Submit(Job job) -> void
+	{
+		std::size_t index{};
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			index = m_NextQueue++ % m_Queues.size();
+			m_QueuedJobs++;
+			m_UnfinishedJobs++;
+		}
+
+		{
+			auto& queue = *m_Queues[index];
+
+			std::lock_guard<std::mutex> lock(queue.Mutex);
+			queue.Jobs.push_back(std::move(job));
+		}
+
+		m_WorkCV.notify_one();
+	}
+
+	auto ThreadPool::Wait() -> void
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_IdleCV.wait(lock, [this] { return m_UnfinishedJobs == 0; });
+	}
+
+	auto ThreadPool::TakeJob(std::size_t index, Job& job) -> bool
+	{
+		{
+			auto& queue = *m_Queues[index];
+
+			std::lock_guard<std::mutex> lock(queue.Mutex);
+
+			if (!queue.Jobs.empty())
+			{
+				job = std::move(queue.Jobs.back());
+				queue.Jobs.pop_back();
+
+				return true;
+			}
+		}
+
+		for (std::size_t offset = 1; offset < m_Queues.size(); offset++)
+		{
+			auto& queue = *m_Queues[(index + offset) % m_Queues.size()];
+
+			std::lock_guard<std::mutex> lock(queue.Mutex);
+
+			if (!queue.Jobs.empty())
+			{
+				job = std::move(queue.Jobs.front());
+				queue.Jobs.pop_front();
+
+				m_StolenJobs++;
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	auto ThreadPool::WorkerLoop(std::size_t index) -> void
+	{
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_WorkCV.wait(lock, [this] { return m_Stopping || m_QueuedJobs > 0; });
+
+				if (m_QueuedJobs == 0)
+					return;
+
+				// Claim a job before looking for it, so a queued job is never taken twice
+				m_QueuedJobs--;
+			}
+
+			Job job;
+
+			// The claimed job is either in a queue already or being pushed by Submit right now
+			while (!TakeJob(index, job))
+			{
+				std::this_thread::yield();
+			}
+
+			job();
+
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+
+				if (--m_UnfinishedJobs == 0)
+					m_IdleCV.notify_all();
+			}
+		}
+	}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace emu
+{
+
+	// Fixed size pool where every worker owns a queue. Workers take jobs from the back of their
+	// own queue and steal from the front of the others when it runs dry.
+	class ThreadPool
+	{
+	public:
+		using Job = std::function<void()>;
+
+		explicit ThreadPool(std::size_t threadCount = std::thread::hardware_concurrency());
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+		auto Submit(Job job) -> void;
+		auto Wait() -> void;
+
+		auto GetThreadCount() const -> std::size_t { return m_Workers.size(); }
+		auto GetStolenJobCount() const -> std::uint64_t { return m_StolenJobs.load(); }
+
+	private:
+		struct WorkQueue
+		{
+			std::mutex Mutex;
+			std::deque<Job> Jobs;
+		};
+
+		auto WorkerLoop(std::size_t index) -> void;
+		auto TakeJob(std::size_t index, Job& job) -> bool;
+
+	private:
+		std::vector<std::unique_ptr<WorkQueue>> m_Queues;
+		std::vector<std::thread> m_Workers;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_WorkCV;
+		std::condition_variable m_IdleCV;
+
+		std::size_t m_QueuedJobs{ 0 };
+		std::size_t m_UnfinishedJobs{ 0 };
+		bool m_Stopping{ false };
+
+		std::size_t m_NextQueue{ 0 };
+		std::atomic<std::uint64_t> m_StolenJobs{ 0 };
+	};
+
+}
@@ -0,0 +1,112 @@
+#include "display/memoryviewer.h"
+
+#include <algorithm>
+#include <format>
+#include <span>
+#include <string>
+
+#include "imgui.h"
+
+
+namespace emu
+{
+
+	static int SelectedMemory{ 0 };
+	static int MemoryPage{ 0 };
+
+	// Shown in place of memory the emulation thread writes while the viewer reads it
+	struct SnapshotView
+	{
+		std::span<const std::uint8_t> Data;
+		std::uint16_t StartAddress{ 0u };
+		std::uint32_t Size{ 0u };
+
+		std::string Name{};
+	};
+
+
+	static auto ViewPage(std::span<const std::uint8_t> memory, std::uint16_t address)
+	{
+		auto startAddress = MemoryPage * 0x100;
+
+		std::uint16_t count{ 0 };
+
+		for (auto row = 0; row < 16; row++)
+		{
+			std::string str = std::format("{:04x} : ", row * 16 + startAddress + address);
+
+			for (auto col = 0; col < 16; col++)
+			{
+				if ((row * 16 + startAddress + col) < memory.size())
+					str += std::format("{:02x} ", memory[row * 16 + startAddress + col]);
+			}
+
+			ImGui::Text("%s", str.c_str());
+		}
+	}
+
+	template<typename MemoryType>
+	static auto DrawMemory(const MemoryType& memory) -> void
+	{
+		// Chunk info block
+		{
+			ImGui::Text("Start address: %04x", memory.StartAddress);
+			ImGui::Text("Length: %04x", memory.Size);
+
+			ImGui::Separator();
+
+			ImGui::Text("%s", memory.Name.c_str());
+
+			ImGui::Separator();
+
+			if (ImGui::InputInt("Page", &MemoryPage))
+			{
+				if (MemoryPage < 0 || memory.Size <= 0x100) MemoryPage = 0;
+				if (MemoryPage > ((memory.Size / 256) - 1) && memory.Size > 0x100) MemoryPage = (memory.Size / 256) - 1;
+			}
+
+			ImGui::Separator();
+
+			ViewPage(memory.Data, memory.StartAddress);
+		}
+
+	}
+
+	auto ViewMemory(MemoryManager& memoryManager, const VRAMSnapshot& vram) -> void
+	{
+		ImGui::Begin("Memory");
+
+		if (ImGui::InputInt("Memory", &SelectedMemory))
+		{
+			if (SelectedMemory < 0) SelectedMemory = 0;
+			if (SelectedMemory >= 8) SelectedMemory = 8;
+		}
+
+		auto& map = memoryManager.GetMemoryMap();
+
+		switch (SelectedMemory)
+		{
+			case 0: DrawMemory(map.ProgramROM); break;
+			case 1:
+			{
+				auto size = std::min<std::uint32_t>(map.CharROM.Size, vram.PatternTables.size());
+				DrawMemory(SnapshotView{ std::span(vram.PatternTables).first(size), map.CharROM.StartAddress, size, map.CharROM.Name });
+				break;
+			}
+
+			case 2: DrawMemory(map.PPUIO); break;
+			case 3: DrawMemory(map.APUIO); break;
+			case 4: DrawMemory(map.APURAM); break;
+			case 5: DrawMemory(SnapshotView{ vram.Nametables, 0x2000, static_cast<std::uint32_t>(vram.Nametables.size()), "Nametables" }); break;
+			case 6: DrawMemory(map.CPURAM); break;
+			case 7: DrawMemory(map.OAMRAM); break;
+			case 8: DrawMemory(map.ProgramRAM); break;
+
+			default:
+				DrawMemory(map.CPURAM); break;
+		}
+
+		ImGui::End();
+	}
+
+}
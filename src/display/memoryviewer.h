@@ -0,0 +1,11 @@
+#pragma once
+
+#include "emu/memory/memorymanager.h"
+
+
+namespace emu
+{
+
+	auto ViewMemory(MemoryManager& memoryManager, const VRAMSnapshot& vram) -> void;
+
+}
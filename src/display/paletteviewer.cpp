@@ -0,0 +1,34 @@
+#include "display/paletteviewer.h"
+
+#include "imgui.h"
+
+
+namespace emu
+{
+
+	static constexpr float SwatchSize = 16.0f;
+
+
+	auto ViewPalette(std::span<const std::uint32_t, Palette::EntryCount> colors) -> void
+	{
+		ImGui::Begin("Palette");
+
+		auto* drawList = ImGui::GetWindowDrawList();
+		auto origin = ImGui::GetCursorScreenPos();
+
+		// Background palettes on the first row, sprite palettes on the second. The resolved
+		// colors are R, G, B, A in memory order, which is the byte order ImGui uses as well.
+		for (std::uint8_t index = 0; index < Palette::EntryCount; index++)
+		{
+			ImVec2 topLeft{ origin.x + (index % 16) * (SwatchSize + 2.0f), origin.y + (index / 16) * (SwatchSize + 2.0f) };
+			ImVec2 bottomRight{ topLeft.x + SwatchSize, topLeft.y + SwatchSize };
+
+			drawList->AddRectFilled(topLeft, bottomRight, colors[index]);
+		}
+
+		ImGui::Dummy(ImVec2{ 16 * (SwatchSize + 2.0f), 2 * (SwatchSize + 2.0f) });
+
+		ImGui::End();
+	}
+
+}
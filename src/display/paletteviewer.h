@@ -0,0 +1,14 @@
+#pragma once
+
+#include "emu/ppu/palette.h"
+
+#include <cstdint>
+#include <span>
+
+
+namespace emu
+{
+
+	auto ViewPalette(std::span<const std::uint32_t, Palette::EntryCount> colors) -> void;
+
+}
@@ -12,35 +12,19 @@ namespace emu
 	}
 
 
-	auto APU::Execute() -> void
+	auto APU::Clock(std::uint16_t cycles) -> void
 	{
-		m_Executing.store(true);
-
-		while (m_Executing.load())
-		{
-			if (m_PowerHandler.GetState() == PowerState::SingleStep || m_PowerHandler.GetState() == PowerState::Off)
-				m_PowerHandler.SetState(PowerState::Suspended);
-			{
-				std::unique_lock<std::mutex> lock(m_Mutex);
-				m_CV.wait(lock, [&] {
-					return m_PowerHandler.GetState() != PowerState::Suspended || m_Executing.load() == 0;
-					});
-
-
-			}
-		}
-
+		m_Cycles += cycles;
 	}
 
-	auto APU::Stop() -> void
+	auto APU::SaveState(APUState& state) const -> void
 	{
-		m_Executing.store(false);
-		m_CV.notify_all();
+		state.Cycles = m_Cycles;
 	}
 
-	auto APU::UpdatePowerState() -> void
+	auto APU::LoadState(const APUState& state) -> void
 	{
-		m_CV.notify_all();
+		m_Cycles = state.Cycles;
 	}
 
 }
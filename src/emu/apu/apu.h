@@ -3,9 +3,7 @@
 #include "emu/memory/memorymanager.h"
 #include "emu/system/powerhandler.h"
 
-#include <atomic>
-#include <condition_variable>
-#include <mutex>
+#include <cstdint>
 
 
 namespace emu
@@ -17,18 +15,16 @@ namespace emu
 		APU() = delete;
 		explicit APU(PowerHandler& powerHandler, MemoryManager& memoryManager);
 
-		auto Stop() -> void;
-		auto UpdatePowerState() -> void;
-		auto Execute() -> void;
+		auto Clock(std::uint16_t cycles) -> void;
+
+		auto SaveState(APUState& state) const -> void;
+		auto LoadState(const APUState& state) -> void;
 
 	private:
 		PowerHandler& m_PowerHandler;
 		MemoryManager& m_MemoryManager;
 
-		std::atomic<bool> m_Executing{ false };
-
-		std::condition_variable m_CV{};
-		std::mutex m_Mutex{};
+		std::uint64_t m_Cycles{ 0 };
 	};
 
 
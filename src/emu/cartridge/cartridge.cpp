@@ -1,71 +1,53 @@
 #include "emu/cartridge/cartridge.h"
 
+#include <algorithm>
 #include <cstdint>
-#include <fstream>
+#include <cstring>
 #include <print>
-#include <vector>
 
 
 namespace emu
 {
 
-	struct iNESHeader
+	auto Cartridge::ParseHeader() -> void
 	{
-		std::uint8_t Signature[4];
-		std::uint8_t ProgramROMSize;
-		std::uint8_t CharROMSize;
-		std::uint8_t Flags6;
-		std::uint8_t Flags7;
-		std::uint8_t Flags8;
-		std::uint8_t Flags9;
-		std::uint8_t Flags10;
-		std::uint8_t Padding[5];
-	};
-
-
-	static iNESHeader Header{};
-	static CartridgeAttributes s_Attributes{};
-
-
-	auto ParseHeader() -> void
-	{
-		if (std::strncmp((char*)&Header, "NES\x{1a}", 4))
+		if (std::strncmp((char*)&m_Header, "NES\x{1a}", 4))
 		{
-			std::println("Invalid cartridge file detected. (Signature: {:c}{:c}{:c}{:c})", Header.Signature[0], Header.Signature[1], Header.Signature[2], Header.Signature[3]);
+			std::println("Invalid cartridge file detected. (Signature: {:c}{:c}{:c}{:c})", m_Header.Signature[0], m_Header.Signature[1], m_Header.Signature[2], m_Header.Signature[3]);
 			return;
 		}
 
-		std::println(" * Program ROM size (KB) : {}", Header.ProgramROMSize * 16);
-		std::println(" * Char ROM size (KB)    : {}", Header.CharROMSize * 8);
+		std::println(" * Program ROM size (KB) : {}", m_Header.ProgramROMSize * 16);
+		std::println(" * Char ROM size (KB)    : {}", m_Header.CharROMSize * 8);
 
-		s_Attributes.NametableMirroring = Header.Flags6 & 0x01;
-		s_Attributes.AlternativeNametableLayout = Header.Flags6 & 0x08;
-		s_Attributes.ContainsTrainer = Header.Flags6 & 0x04;
-		s_Attributes.ContainsPRGRAM = Header.Flags6 & 0x02;
-		s_Attributes.MapperNumber = (Header.Flags7) & 0xF0;
-		s_Attributes.MapperNumber += (Header.Flags6 & 0xF0) >> 4;
+		m_Attributes.NametableMirroring = m_Header.Flags6 & 0x01;
+		m_Attributes.AlternativeNametableLayout = m_Header.Flags6 & 0x08;
+		m_Attributes.ContainsTrainer = m_Header.Flags6 & 0x04;
+		m_Attributes.ContainsPRGRAM = m_Header.Flags6 & 0x02;
+		m_Attributes.MapperNumber = (m_Header.Flags7) & 0xF0;
+		m_Attributes.MapperNumber += (m_Header.Flags6 & 0xF0) >> 4;
 
-		std::println(" * Nametable mirror      : {}", s_Attributes.NametableMirroring);
-		std::println(" * Alt. nametable layout : {}", s_Attributes.AlternativeNametableLayout);
-		std::println(" * Mapper number         : {}", s_Attributes.MapperNumber);
-		std::println(" * Contains trainer      : {}", s_Attributes.ContainsTrainer);
-		std::println(" * Contains PGM RAM      : {}", s_Attributes.ContainsPRGRAM);
+		std::println(" * Nametable mirror      : {}", m_Attributes.NametableMirroring);
+		std::println(" * Alt. nametable layout : {}", m_Attributes.AlternativeNametableLayout);
+		std::println(" * Mapper number         : {}", m_Attributes.MapperNumber);
+		std::println(" * Contains trainer      : {}", m_Attributes.ContainsTrainer);
+		std::println(" * Contains PGM RAM      : {}", m_Attributes.ContainsPRGRAM);
 
-		s_Attributes.NES2Format = Header.Flags7 & 0x40;
+		m_Attributes.NES2Format = m_Header.Flags7 & 0x40;
 
-		std::println(" * NES 2.0 format        : {}", s_Attributes.NES2Format);
+		std::println(" * NES 2.0 format        : {}", m_Attributes.NES2Format);
 
-		s_Attributes.TVSystem = Header.Flags9 & 0x01;
+		m_Attributes.TVSystem = m_Header.Flags9 & 0x01;
 
-		std::println(" * TV system             : {}", s_Attributes.TVSystem);
+		std::println(" * TV system             : {}", m_Attributes.TVSystem);
 	}
 
 
 	Cartridge::Cartridge(const std::filesystem::path& filePath)
 	{
-		std::ifstream fs(filePath, std::ios::in | std::ios::binary);
+		m_Image = ROMImage::Open(filePath);
 
-		if (!fs.is_open())
+		if (!m_Image || m_Image->GetData().size() < sizeof(iNESHeader))
 		{
 			std::println("Failed to load cartridge: {}", filePath.filename().string());
 			return;
@@ -73,42 +55,30 @@ namespace emu
 
 		std::println("Cartridge installed: {}", filePath.filename().string());
 
-		fs.seekg(0, fs.end);
-		auto filesize = fs.tellg();
-		fs.seekg(0, fs.beg);
+		auto data = m_Image->GetData();
 
-		fs.read((char*)&Header, sizeof(iNESHeader));
+		std::memcpy(&m_Header, data.data(), sizeof(iNESHeader));
+		data = data.subspan(sizeof(iNESHeader));
 
 		ParseHeader();
 
-		if (s_Attributes.ContainsTrainer)
-		{
-			m_Trainer.resize(512);
-			fs.read((char*)m_Trainer.data(), 512);
-		}
-
+		// PRG and CHR point straight into the mapping, a truncated file only exposes what is there
+		auto take = [&data](std::size_t size)
 		{
-			ROM newROM{};
-			auto romSize{ Header.ProgramROMSize * 0x4000 };
-			std::vector<std::uint8_t> programROM(romSize);
-			fs.read((char*)programROM.data(), romSize);
-
-			newROM.SetData(romSize, programROM);
-			m_ROMs[ROMType::Program] = newROM;
-		}
+			auto part = data.first(std::min(size, data.size()));
+			data = data.subspan(part.size());
 
-		{
-			ROM newROM{};
-			auto romSize{ Header.CharROMSize * 0x2000 };
-			std::vector<std::uint8_t> charROM(romSize);
-			fs.read((char*)charROM.data(), romSize);
+			return part;
+		};
 
-			newROM.SetData(romSize, charROM);
-			m_ROMs[ROMType::Character] = newROM;
-		}
+		if (m_Attributes.ContainsTrainer)
+			m_Trainer = take(512);
 
-		fs.close();
+		m_ProgramROM.SetData(take(m_Header.ProgramROMSize * 0x4000u));
+		m_CharROM.SetData(take(m_Header.CharROMSize * 0x2000u));
 
+		if (m_ProgramROM.GetSize() != m_Header.ProgramROMSize * 0x4000u || m_CharROM.GetSize() != m_Header.CharROMSize * 0x2000u)
+			std::println("Cartridge file is truncated: {}", filePath.filename().string());
 	}
 
 
@@ -119,7 +89,7 @@ namespace emu
 
 	auto Cartridge::GetAttributes() const -> const CartridgeAttributes&
 	{
-		return s_Attributes;
+		return m_Attributes;
 	}
 
 }
@@ -1,11 +1,12 @@
 #pragma once
 
+#include "emu/cartridge/romimage.h"
 #include "emu/memory/rom.h"
 
 #include <cstdint>
 #include <filesystem>
-#include <unordered_map>
-#include <vector>
+#include <memory>
+#include <span>
 
 
 namespace emu
@@ -24,6 +25,20 @@ namespace emu
 	};
 
 
+	struct iNESHeader
+	{
+		std::uint8_t Signature[4];
+		std::uint8_t ProgramROMSize;
+		std::uint8_t CharROMSize;
+		std::uint8_t Flags6;
+		std::uint8_t Flags7;
+		std::uint8_t Flags8;
+		std::uint8_t Flags9;
+		std::uint8_t Flags10;
+		std::uint8_t Padding[5];
+	};
+
+
 	class Cartridge
 	{
 	public:
@@ -32,16 +47,21 @@ namespace emu
 
 		auto GetAttributes() const -> const CartridgeAttributes&;
 
-		auto GetROM(ROMType type) { return m_ROMs[type]; }
-//		auto GetProgramROM() const -> auto { return m_ProgramROM; }
-//		auto GetCharROM() const -> auto { return m_CharROM; }
+		// Views into the mapped file, valid for the lifetime of the cartridge
+		auto GetROM(ROMType type) const -> const ROM& { return type == ROMType::Program ? m_ProgramROM : m_CharROM; }
 
 	private:
-//		ROM m_ProgramROM{};
-//		ROM m_CharROM{};
+		auto ParseHeader() -> void;
+
+	private:
+		std::shared_ptr<const ROMImage> m_Image{};
+
+		ROM m_ProgramROM{};
+		ROM m_CharROM{};
+		std::span<const std::uint8_t> m_Trainer{};
 
-		std::unordered_map<ROMType, ROM> m_ROMs{};
-		std::vector<std::uint8_t> m_Trainer{};
+		iNESHeader m_Header{};
+		CartridgeAttributes m_Attributes{};
 
 	};
 
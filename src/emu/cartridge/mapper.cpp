@@ -1,23 +1,32 @@
 #include "emu/cartridge/mapper.h"
 
+#include <print>
 
 
 namespace emu
 {
 
 
-	auto Mapper::CreateMemoryMap(Cartridge& cartridge) -> MemoryMap
+	auto Mapper::CreateMemoryMap(const Cartridge& cartridge) -> MemoryMap
 	{
 		MemoryMap newMap;
 		auto& attributes = cartridge.GetAttributes();
 
-		newMap.NametableMirroring = attributes.NametableMirroring;
+		if (attributes.AlternativeNametableLayout)
+			newMap.Mirroring = NametableMirroring::FourScreen;
+		else
+			newMap.Mirroring = attributes.NametableMirroring ? NametableMirroring::Vertical : NametableMirroring::Horizontal;
 
 		newMap.CPURAM.StartAddress = 0x0000;
 		newMap.CPURAM.Size = 0x800;
 		newMap.CPURAM.Data.resize(newMap.CPURAM.Size);
 		newMap.CPURAM.Name = "CPU RAM";
 
+		newMap.ProgramRAM.StartAddress = 0x6000;
+		newMap.ProgramRAM.Size = 0x2000;
+		newMap.ProgramRAM.Data.resize(newMap.ProgramRAM.Size);
+		newMap.ProgramRAM.Name = "Program RAM";
+
 		newMap.PPUIO.StartAddress = 0x2000;
 		newMap.PPUIO.Size = 0x8;
 		newMap.PPUIO.Data.resize(newMap.PPUIO.Size);
@@ -28,10 +37,10 @@ namespace emu
 		newMap.APUIO.Data.resize(newMap.APUIO.Size);
 		newMap.APUIO.Name = "APU & IO";
 
-		newMap.PPURAM.StartAddress = 0x2000;
-		newMap.PPURAM.Size = 0x2000;
-		newMap.PPURAM.Data.resize(newMap.PPURAM.Size);
-		newMap.PPURAM.Name = "PPU RAM";
+		newMap.NametableRAM.StartAddress = 0x0000;
+		newMap.NametableRAM.Size = newMap.Mirroring == NametableMirroring::FourScreen ? 0x1000 : 0x800;
+		newMap.NametableRAM.Data.resize(newMap.NametableRAM.Size);
+		newMap.NametableRAM.Name = "Nametable RAM";
 
 		newMap.OAMRAM.StartAddress = 0x0000;
 		newMap.OAMRAM.Size = 0x100;
@@ -43,31 +52,47 @@ namespace emu
 		newMap.APURAM.Data.resize(newMap.APURAM.Size);
 		newMap.APURAM.Name = "APU RAM";
 
-		switch (attributes.MapperNumber)
-		{
-			case 0:
-			{
-				newMap.ProgramROM.StartAddress = 0x8000;
-				newMap.ProgramROM.Size = cartridge.GetROM(ROMType::Program).GetSize();
-				newMap.ProgramROM.Data = cartridge.GetROM(ROMType::Program).GetData();
-				newMap.ProgramROM.ReadOnly = true;
-				newMap.ProgramROM.Name = "Program ROM";
-
-				newMap.CharROM.StartAddress = 0x0000;
-				newMap.CharROM.Size = cartridge.GetROM(ROMType::Character).GetSize();
-				newMap.CharROM.Data = cartridge.GetROM(ROMType::Character).GetData();
-				newMap.CharROM.ReadOnly = true;
-				newMap.CharROM.Name = "Char ROM";
-
-				break;
-			}
+		// The whole images stay in the cartridge, the board maps windows of them into the address space
+		newMap.ProgramROM.StartAddress = 0x8000;
+		newMap.ProgramROM.Size = cartridge.GetROM(ROMType::Program).GetSize();
+		newMap.ProgramROM.Data = cartridge.GetROM(ROMType::Program).GetData();
+		newMap.ProgramROM.Name = "Program ROM";
 
-			default:
-				break;
+		newMap.CharROM.StartAddress = 0x0000;
+		newMap.CharROM.Size = cartridge.GetROM(ROMType::Character).GetSize();
+		newMap.CharROM.Data = cartridge.GetROM(ROMType::Character).GetData();
+		newMap.CharROM.Name = "Char ROM";
+
+		// Cartridges without CHR ROM have 8KB of CHR RAM in its place
+		if (newMap.CharROM.Data.empty())
+		{
+			newMap.CharRAM.StartAddress = 0x0000;
+			newMap.CharRAM.Size = 0x2000;
+			newMap.CharRAM.Data.resize(newMap.CharRAM.Size);
+			newMap.CharRAM.Name = "Char RAM";
 		}
 
 		return newMap;
 	}
 
+	auto Mapper::CreateBoard(const Cartridge& cartridge) -> MapperBoard
+	{
+		switch (cartridge.GetAttributes().MapperNumber)
+		{
+			case NROM::Number: return NROM{};
+			case MMC1::Number: return MMC1{};
+			case UxROM::Number: return UxROM{};
+			case CNROM::Number: return CNROM{};
+			case MMC3::Number: return MMC3{};
+			case AxROM::Number: return AxROM{};
+
+			default:
+			{
+				std::println("Unsupported mapper {}, running as NROM", cartridge.GetAttributes().MapperNumber);
+				return NROM{};
+			}
+		}
+	}
+
 
 }
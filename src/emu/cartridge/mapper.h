@@ -1,9 +1,12 @@
 #pragma once
 
 #include "emu/cartridge/cartridge.h"
+#include "emu/cartridge/mappers.h"
 
 #include <cstdint>
+#include <span>
 #include <string>
+#include <vector>
 
 
 namespace emu
@@ -19,13 +22,36 @@ namespace emu
 		std::string Name{};
 	};
 
+	// Read-only view into cartridge ROM, shared by every console running the same cartridge
+	struct ROMMemory
+	{
+		std::span<const std::uint8_t> Data;
+		std::uint16_t StartAddress{ 0u };
+		std::uint32_t Size{ 0u };
+
+		std::string Name{};
+	};
+
+	// Which 1KB of nametable RAM each of the four nametables at $2000, $2400, $2800 and $2C00 uses
+	enum class NametableMirroring : std::uint8_t
+	{
+		Horizontal,
+		Vertical,
+		SingleScreenLower,
+		SingleScreenUpper,
+		FourScreen,
+	};
+
 	struct MemoryMap
 	{
-		Memory ProgramROM;
+		ROMMemory ProgramROM;
+		Memory ProgramRAM;
 		Memory CPURAM;
 
-		Memory CharROM;
-		Memory PPURAM;
+		ROMMemory CharROM;
+		Memory CharRAM;
+		// 2KB console CIRAM, four-screen cartridges add 2KB of their own behind it
+		Memory NametableRAM;
 
 		Memory OAMRAM;
 		Memory APURAM;
@@ -33,13 +59,16 @@ namespace emu
 		Memory PPUIO;
 		Memory APUIO;
 
-		std::uint8_t NametableMirroring{ 0u };
+		NametableMirroring Mirroring{ NametableMirroring::Horizontal };
 	};
 
 	class Mapper
 	{
 	public:
-		static auto CreateMemoryMap(Cartridge& cartridge) -> MemoryMap;
+		static auto CreateMemoryMap(const Cartridge& cartridge) -> MemoryMap;
+
+		// Board for the iNES mapper number, unsupported mappers fall back to NROM
+		static auto CreateBoard(const Cartridge& cartridge) -> MapperBoard;
 	};
 
 
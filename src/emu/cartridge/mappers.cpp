@@ -0,0 +1,334 @@
+#include "emu/cartridge/mappers.h"
+#include "emu/memory/memorymanager.h"
+
+#include <algorithm>
+
+
+namespace emu
+{
+
+	// PRG windows are 8KB and CHR windows 1KB, larger banks are set as runs of consecutive windows
+	static auto SetPRGBanks(MemoryManager& memoryManager, std::uint8_t firstWindow, std::uint8_t windowCount, std::uint32_t firstBank) -> void
+	{
+		for (std::uint8_t window = 0; window < windowCount; window++)
+			memoryManager.SetPRGBank(firstWindow + window, firstBank + window);
+	}
+
+	static auto SetCHRBanks(MemoryManager& memoryManager, std::uint8_t firstWindow, std::uint8_t windowCount, std::uint32_t firstBank) -> void
+	{
+		for (std::uint8_t window = 0; window < windowCount; window++)
+			memoryManager.SetCHRBank(firstWindow + window, firstBank + window);
+	}
+
+
+	auto NROM::Reset(MemoryManager& memoryManager) -> void
+	{
+		// 16KB images show up twice, the PRG bank number wraps at the image size
+		SetPRGBanks(memoryManager, 0, 4, 0);
+		SetCHRBanks(memoryManager, 0, 8, 0);
+	}
+
+	auto NROM::WriteRegister([[maybe_unused]] MemoryManager& memoryManager, [[maybe_unused]] std::uint16_t address, [[maybe_unused]] std::uint8_t value) -> void
+	{
+	}
+
+
+	auto MMC1::Reset(MemoryManager& memoryManager) -> void
+	{
+		m_ShiftRegister = 0x10;
+		m_Control = 0x0C;
+		m_CHRBank0 = 0;
+		m_CHRBank1 = 0;
+		m_PRGBank = 0;
+
+		Apply(memoryManager);
+	}
+
+	auto MMC1::WriteRegister(MemoryManager& memoryManager, std::uint16_t address, std::uint8_t value) -> void
+	{
+		// Bit 7 clears the shift register and locks the last PRG bank at $C000
+		if (value & 0x80)
+		{
+			m_ShiftRegister = 0x10;
+			m_Control |= 0x0C;
+
+			Apply(memoryManager);
+			return;
+		}
+
+		bool complete = m_ShiftRegister & 0x01;
+		m_ShiftRegister = (m_ShiftRegister >> 1) | ((value & 0x01) << 4);
+
+		if (!complete)
+			return;
+
+		switch ((address >> 13) & 0x03)
+		{
+			case 0: m_Control = m_ShiftRegister; break;
+			case 1: m_CHRBank0 = m_ShiftRegister; break;
+			case 2: m_CHRBank1 = m_ShiftRegister; break;
+			case 3: m_PRGBank = m_ShiftRegister & 0x0F; break;
+		}
+
+		m_ShiftRegister = 0x10;
+
+		Apply(memoryManager);
+	}
+
+	auto MMC1::SaveState(MapperState& state) const -> void
+	{
+		state.Registers[0] = m_ShiftRegister;
+		state.Registers[1] = m_Control;
+		state.Registers[2] = m_CHRBank0;
+		state.Registers[3] = m_CHRBank1;
+		state.Registers[4] = m_PRGBank;
+	}
+
+	auto MMC1::LoadState(const MapperState& state) -> void
+	{
+		m_ShiftRegister = state.Registers[0];
+		m_Control = state.Registers[1];
+		m_CHRBank0 = state.Registers[2];
+		m_CHRBank1 = state.Registers[3];
+		m_PRGBank = state.Registers[4];
+	}
+
+	auto MMC1::Apply(MemoryManager& memoryManager) -> void
+	{
+		static constexpr std::array<NametableMirroring, 4> Mirroring{
+			NametableMirroring::SingleScreenLower,
+			NametableMirroring::SingleScreenUpper,
+			NametableMirroring::Vertical,
+			NametableMirroring::Horizontal,
+		};
+
+		memoryManager.SetNametableMirroring(Mirroring[m_Control & 0x03]);
+
+		switch ((m_Control >> 2) & 0x03)
+		{
+			// 32KB at $8000, the low bit of the bank number is ignored
+			case 0:
+			case 1:
+			{
+				SetPRGBanks(memoryManager, 0, 4, (m_PRGBank & 0x0E) * 2);
+				break;
+			}
+
+			// First bank fixed at $8000, 16KB switched at $C000
+			case 2:
+			{
+				SetPRGBanks(memoryManager, 0, 2, 0);
+				SetPRGBanks(memoryManager, 2, 2, m_PRGBank * 2);
+				break;
+			}
+
+			// 16KB switched at $8000, last bank fixed at $C000
+			case 3:
+			{
+				SetPRGBanks(memoryManager, 0, 2, m_PRGBank * 2);
+				SetPRGBanks(memoryManager, 2, 2, memoryManager.GetPRGBankCount() - 2);
+				break;
+			}
+		}
+
+		// Two 4KB CHR banks or one 8KB bank
+		if (m_Control & 0x10)
+		{
+			SetCHRBanks(memoryManager, 0, 4, m_CHRBank0 * 4);
+			SetCHRBanks(memoryManager, 4, 4, m_CHRBank1 * 4);
+		}
+		else
+		{
+			SetCHRBanks(memoryManager, 0, 8, (m_CHRBank0 & 0x1E) * 4);
+		}
+	}
+
+
+	auto UxROM::Reset(MemoryManager& memoryManager) -> void
+	{
+		SetPRGBanks(memoryManager, 0, 2, 0);
+		SetPRGBanks(memoryManager, 2, 2, memoryManager.GetPRGBankCount() - 2);
+		SetCHRBanks(memoryManager, 0, 8, 0);
+	}
+
+	auto UxROM::WriteRegister(MemoryManager& memoryManager, [[maybe_unused]] std::uint16_t address, std::uint8_t value) -> void
+	{
+		SetPRGBanks(memoryManager, 0, 2, value * 2);
+	}
+
+
+	auto CNROM::Reset(MemoryManager& memoryManager) -> void
+	{
+		SetPRGBanks(memoryManager, 0, 4, 0);
+		SetCHRBanks(memoryManager, 0, 8, 0);
+	}
+
+	auto CNROM::WriteRegister(MemoryManager& memoryManager, [[maybe_unused]] std::uint16_t address, std::uint8_t value) -> void
+	{
+		SetCHRBanks(memoryManager, 0, 8, value * 8);
+	}
+
+
+	auto AxROM::Reset(MemoryManager& memoryManager) -> void
+	{
+		WriteRegister(memoryManager, 0x8000, 0x00);
+		SetCHRBanks(memoryManager, 0, 8, 0);
+	}
+
+	auto AxROM::WriteRegister(MemoryManager& memoryManager, [[maybe_unused]] std::uint16_t address, std::uint8_t value) -> void
+	{
+		SetPRGBanks(memoryManager, 0, 4, (value & 0x07) * 4);
+
+		memoryManager.SetNametableMirroring(value & 0x10 ? NametableMirroring::SingleScreenUpper : NametableMirroring::SingleScreenLower);
+	}
+
+
+	auto MMC3::Reset(MemoryManager& memoryManager) -> void
+	{
+		m_BankSelect = 0;
+		m_Registers = { 0, 2, 4, 5, 6, 7, 0, 1 };
+
+		m_FourScreen = memoryManager.GetNametableMirroring() == NametableMirroring::FourScreen;
+
+		m_IRQLatch = 0;
+		m_IRQCounter = 0;
+		m_IRQReload = false;
+		m_IRQEnabled = false;
+
+		Apply(memoryManager);
+	}
+
+	auto MMC3::WriteRegister(MemoryManager& memoryManager, std::uint16_t address, std::uint8_t value) -> void
+	{
+		// Registers are selected by the address range and whether the address is even or odd
+		switch (address & 0xE001)
+		{
+			case 0x8000:
+			{
+				m_BankSelect = value;
+				Apply(memoryManager);
+
+				break;
+			}
+
+			case 0x8001:
+			{
+				m_Registers[m_BankSelect & 0x07] = value;
+				Apply(memoryManager);
+
+				break;
+			}
+
+			case 0xA000:
+			{
+				if (!m_FourScreen)
+					memoryManager.SetNametableMirroring(value & 0x01 ? NametableMirroring::Horizontal : NametableMirroring::Vertical);
+
+				break;
+			}
+
+			case 0xC000:
+			{
+				m_IRQLatch = value;
+				break;
+			}
+
+			case 0xC001:
+			{
+				m_IRQReload = true;
+				break;
+			}
+
+			// Disabling also acknowledges a pending IRQ
+			case 0xE000:
+			{
+				m_IRQEnabled = false;
+				memoryManager.SetIRQLine(IRQSource::Mapper, false);
+
+				break;
+			}
+
+			case 0xE001:
+			{
+				m_IRQEnabled = true;
+				break;
+			}
+
+			// $A001 PRG RAM protect is not emulated, PRG RAM is always enabled
+			default:
+			{
+				break;
+			}
+		}
+	}
+
+	auto MMC3::ClockA12(MemoryManager& memoryManager) -> void
+	{
+		if (m_IRQCounter == 0 || m_IRQReload)
+		{
+			m_IRQCounter = m_IRQLatch;
+			m_IRQReload = false;
+		}
+		else
+		{
+			m_IRQCounter--;
+		}
+
+		if (m_IRQCounter == 0 && m_IRQEnabled)
+			memoryManager.SetIRQLine(IRQSource::Mapper, true);
+	}
+
+	auto MMC3::SaveState(MapperState& state) const -> void
+	{
+		state.Registers[0] = m_BankSelect;
+		std::ranges::copy(m_Registers, state.Registers.begin() + 1);
+
+		state.Registers[9] = m_FourScreen;
+		state.Registers[10] = m_IRQLatch;
+		state.Registers[11] = m_IRQCounter;
+		state.Registers[12] = m_IRQReload;
+		state.Registers[13] = m_IRQEnabled;
+	}
+
+	auto MMC3::LoadState(const MapperState& state) -> void
+	{
+		m_BankSelect = state.Registers[0];
+		std::copy_n(state.Registers.begin() + 1, m_Registers.size(), m_Registers.begin());
+
+		m_FourScreen = state.Registers[9];
+		m_IRQLatch = state.Registers[10];
+		m_IRQCounter = state.Registers[11];
+		m_IRQReload = state.Registers[12];
+		m_IRQEnabled = state.Registers[13];
+	}
+
+	auto MMC3::Apply(MemoryManager& memoryManager) -> void
+	{
+		auto secondToLast = memoryManager.GetPRGBankCount() - 2;
+
+		// Bit 6 swaps $8000 and $C000, the second to last bank takes the other one
+		if (m_BankSelect & 0x40)
+		{
+			memoryManager.SetPRGBank(0, secondToLast);
+			memoryManager.SetPRGBank(2, m_Registers[6]);
+		}
+		else
+		{
+			memoryManager.SetPRGBank(0, m_Registers[6]);
+			memoryManager.SetPRGBank(2, secondToLast);
+		}
+
+		memoryManager.SetPRGBank(1, m_Registers[7]);
+		memoryManager.SetPRGBank(3, secondToLast + 1);
+
+		// R0/R1 are 2KB banks, R2 - R5 1KB banks. Bit 7 swaps the two pattern tables.
+		std::uint8_t inversion = m_BankSelect & 0x80 ? 4 : 0;
+
+		SetCHRBanks(memoryManager, 0 ^ inversion, 2, m_Registers[0] & 0xFE);
+		SetCHRBanks(memoryManager, 2 ^ inversion, 2, m_Registers[1] & 0xFE);
+
+		for (std::uint8_t index = 0; index < 4; index++)
+			memoryManager.SetCHRBank((4 + index) ^ inversion, m_Registers[2 + index]);
+	}
+
+}
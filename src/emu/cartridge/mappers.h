@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <variant>
+
+
+namespace emu
+{
+
+	class MemoryManager;
+
+	// Board registers in a save state. Registers is laid out by each board, boards whose banks are
+	// all held by MemoryManager leave it zeroed.
+	struct MapperState
+	{
+		std::uint8_t MapperNumber{};
+		std::array<std::uint8_t, 15> Registers{};
+	};
+
+	// Cartridge boards. Each one keeps its registers and reacts to CPU writes to $8000 - $FFFF by
+	// pointing the 8KB PRG windows, the 1KB CHR windows and the nametables at other banks through
+	// MemoryManager. Reset sets up the power-on banks.
+
+	// Mapper 0, fixed 16/32KB PRG and 8KB CHR
+	class NROM
+	{
+	public:
+		static constexpr std::uint8_t Number = 0;
+
+		auto Reset(MemoryManager& memoryManager) -> void;
+		auto WriteRegister(MemoryManager& memoryManager, std::uint16_t address, std::uint8_t value) -> void;
+	};
+
+	// Mapper 1, five serial writes load one of four registers
+	class MMC1
+	{
+	public:
+		static constexpr std::uint8_t Number = 1;
+
+		auto Reset(MemoryManager& memoryManager) -> void;
+		auto WriteRegister(MemoryManager& memoryManager, std::uint16_t address, std::uint8_t value) -> void;
+
+		auto SaveState(MapperState& state) const -> void;
+		auto LoadState(const MapperState& state) -> void;
+
+	private:
+		auto Apply(MemoryManager& memoryManager) -> void;
+
+	private:
+		// Bit 4 marks the first written bit, it reaches bit 0 once four more bits are in
+		std::uint8_t m_ShiftRegister{ 0x10 };
+
+		std::uint8_t m_Control{ 0x0C };
+		std::uint8_t m_CHRBank0{ 0 };
+		std::uint8_t m_CHRBank1{ 0 };
+		std::uint8_t m_PRGBank{ 0 };
+	};
+
+	// Mapper 2, switchable 16KB PRG at $8000, last 16KB fixed at $C000
+	class UxROM
+	{
+	public:
+		static constexpr std::uint8_t Number = 2;
+
+		auto Reset(MemoryManager& memoryManager) -> void;
+		auto WriteRegister(MemoryManager& memoryManager, std::uint16_t address, std::uint8_t value) -> void;
+	};
+
+	// Mapper 3, switchable 8KB CHR
+	class CNROM
+	{
+	public:
+		static constexpr std::uint8_t Number = 3;
+
+		auto Reset(MemoryManager& memoryManager) -> void;
+		auto WriteRegister(MemoryManager& memoryManager, std::uint16_t address, std::uint8_t value) -> void;
+	};
+
+	// Mapper 7, switchable 32KB PRG and single-screen mirroring
+	class AxROM
+	{
+	public:
+		static constexpr std::uint8_t Number = 7;
+
+		auto Reset(MemoryManager& memoryManager) -> void;
+		auto WriteRegister(MemoryManager& memoryManager, std::uint16_t address, std::uint8_t value) -> void;
+	};
+
+	// Mapper 4, two 8KB PRG and six 1/2KB CHR registers. The IRQ registers are latched here.
+	class MMC3
+	{
+	public:
+		static constexpr std::uint8_t Number = 4;
+
+		auto Reset(MemoryManager& memoryManager) -> void;
+		auto WriteRegister(MemoryManager& memoryManager, std::uint16_t address, std::uint8_t value) -> void;
+
+		// Scanline counter, clocked by each filtered rising edge of PPU A12
+		auto ClockA12(MemoryManager& memoryManager) -> void;
+
+		auto SaveState(MapperState& state) const -> void;
+		auto LoadState(const MapperState& state) -> void;
+
+	private:
+		auto Apply(MemoryManager& memoryManager) -> void;
+
+	private:
+		std::uint8_t m_BankSelect{ 0 };
+		std::array<std::uint8_t, 8> m_Registers{};
+
+		bool m_FourScreen{ false };
+
+		std::uint8_t m_IRQLatch{ 0 };
+		std::uint8_t m_IRQCounter{ 0 };
+		bool m_IRQReload{ false };
+		bool m_IRQEnabled{ false };
+	};
+
+
+	// Resolved once when the cartridge is loaded, register writes dispatch through std::visit
+	using MapperBoard = std::variant<NROM, MMC1, UxROM, CNROM, AxROM, MMC3>;
+
+}
@@ -0,0 +1,118 @@
+#include "emu/cartridge/romimage.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+
+namespace emu
+{
+
+	// Images stay mapped as long as any cartridge holds them, the cache only remembers them
+	static std::mutex s_ImagesMutex;
+	static std::unordered_map<std::string, std::weak_ptr<const ROMImage>> s_Images;
+
+
+	static auto MapFile(const std::filesystem::path& filePath) -> std::span<const std::uint8_t>
+	{
+#if defined(_WIN32)
+		auto file = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		if (file == INVALID_HANDLE_VALUE)
+			return {};
+
+		LARGE_INTEGER fileSize{};
+		const void* view{ nullptr };
+
+		if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+		{
+			// The view keeps the mapping alive, both handles can be closed right away
+			auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+			if (mapping)
+			{
+				view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				CloseHandle(mapping);
+			}
+		}
+
+		CloseHandle(file);
+
+		if (!view)
+			return {};
+
+		return { static_cast<const std::uint8_t*>(view), static_cast<std::size_t>(fileSize.QuadPart) };
+#else
+		auto file = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+
+		if (file < 0)
+			return {};
+
+		struct stat fileStatus{};
+		void* view{ MAP_FAILED };
+
+		// The mapping outlives the descriptor
+		if (fstat(file, &fileStatus) == 0 && fileStatus.st_size > 0)
+			view = mmap(nullptr, static_cast<std::size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+		close(file);
+
+		if (view == MAP_FAILED)
+			return {};
+
+		return { static_cast<const std::uint8_t*>(view), static_cast<std::size_t>(fileStatus.st_size) };
+#endif
+	}
+
+
+	auto ROMImage::Open(const std::filesystem::path& filePath) -> std::shared_ptr<const ROMImage>
+	{
+		std::error_code error;
+		auto canonicalPath = std::filesystem::weakly_canonical(filePath, error);
+		auto key = (error ? filePath : canonicalPath).string();
+
+		std::lock_guard lock(s_ImagesMutex);
+
+		if (auto found = s_Images.find(key); found != s_Images.end())
+		{
+			if (auto image = found->second.lock())
+				return image;
+		}
+
+		auto data = MapFile(filePath);
+
+		if (data.empty())
+			return nullptr;
+
+		std::shared_ptr<const ROMImage> image(new ROMImage(data.data(), data.size()));
+		s_Images[key] = image;
+
+		return image;
+	}
+
+	ROMImage::ROMImage(const std::uint8_t* data, std::size_t size)
+		: m_Data(data), m_Size(size)
+	{
+	}
+
+	ROMImage::~ROMImage()
+	{
+#if defined(_WIN32)
+		UnmapViewOfFile(m_Data);
+#else
+		munmap(const_cast<std::uint8_t*>(m_Data), m_Size);
+#endif
+	}
+
+
+}
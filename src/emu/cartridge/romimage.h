@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+
+namespace emu
+{
+
+	// Read-only memory mapping of a cartridge file. Opening a file that is already mapped returns the
+	// existing image, so every console running the same cartridge shares one copy of its pages.
+	class ROMImage
+	{
+	public:
+		// nullptr when the file cannot be opened or is empty
+		static auto Open(const std::filesystem::path& filePath) -> std::shared_ptr<const ROMImage>;
+
+		ROMImage(const ROMImage&) = delete;
+		auto operator=(const ROMImage&) -> ROMImage& = delete;
+		~ROMImage();
+
+		auto GetData() const -> std::span<const std::uint8_t> { return { m_Data, m_Size }; }
+
+	private:
+		ROMImage(const std::uint8_t* data, std::size_t size);
+
+	private:
+		const std::uint8_t* m_Data{ nullptr };
+		std::size_t m_Size{ 0 };
+	};
+
+
+}
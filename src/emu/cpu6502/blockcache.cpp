@@ -0,0 +1,151 @@
+#include "emu/cpu6502/blockcache.h"
+
+#include <algorithm>
+
+
+namespace emu
+{
+
+	// Reads that return the same value however often they repeat until the PPU catches up: internal
+	// RAM, PPU status once its first read cleared vblank, and PRG RAM and ROM
+	static constexpr auto IsPollable(std::uint16_t address) -> bool
+	{
+		return address < 0x2000 || (address < 0x4000 && (address & 0x07) == 0x02) || address >= 0x6000;
+	}
+
+	BlockCache::BlockCache(MemoryManager& memoryManager, std::span<const OpCodeInfo, 0x100> opCodes)
+		: m_MemoryManager(memoryManager), m_OpCodes(opCodes)
+	{
+	}
+
+	auto BlockCache::Lookup(std::uint16_t pc) -> Block*
+	{
+		if (m_MemoryManager.GetCodeWrites() != m_CodeWrites)
+		{
+			m_CodeWrites = m_MemoryManager.GetCodeWrites();
+			DropRAMBlocks();
+		}
+
+		// Blocks end at the region they start in: a PRG window, internal RAM or PRG RAM
+		const std::uint8_t* bank{ nullptr };
+		std::uint32_t regionEnd{ 0 };
+
+		if (pc >= 0x8000)
+		{
+			bank = m_MemoryManager.GetPRGBankData(static_cast<std::uint8_t>((pc - 0x8000) / MemoryManager::PRGBankSize));
+
+			if (!bank)
+				return nullptr;
+
+			regionEnd = (pc | (MemoryManager::PRGBankSize - 1)) + 1u;
+		}
+		else if (pc < 0x2000)
+		{
+			regionEnd = 0x2000;
+		}
+		else if (pc >= 0x6000)
+		{
+			regionEnd = 0x8000;
+		}
+		else
+		{
+			return nullptr;
+		}
+
+		for (auto index = m_Heads[pc]; index != 0; index = m_Blocks[index - 1].Next)
+		{
+			if (m_Blocks[index - 1].Bank == bank)
+				return &m_Blocks[index - 1];
+		}
+
+		return Decode(pc, bank, regionEnd);
+	}
+
+	auto BlockCache::Clear() -> void
+	{
+		m_Instructions.clear();
+		m_Blocks.clear();
+		m_RAMBlockPCs.clear();
+
+		std::ranges::fill(m_Heads, 0u);
+
+		m_Flushes++;
+	}
+
+	auto BlockCache::Decode(std::uint16_t pc, const std::uint8_t* bank, std::uint32_t regionEnd) -> Block*
+	{
+		if (m_Blocks.size() >= MaxBlocks)
+			Clear();
+
+		Block block{ bank, static_cast<std::uint32_t>(m_Instructions.size()), 0, m_Heads[pc], pc };
+		std::uint32_t address = pc;
+
+		bool readsOnly{ true };
+		std::uint32_t target{ 0x10000 };
+
+		while (block.Count < MaxBlockInstructions)
+		{
+			auto opCodeByte = m_MemoryManager.PeekBus(static_cast<std::uint16_t>(address));
+			auto& opCode = m_OpCodes[opCodeByte];
+
+			if (opCode.Length == 0 || address + opCode.Length > regionEnd)
+				break;
+
+			Instruction instruction{ opCode.Execute, 0, opCodeByte, opCode.Length };
+
+			if (opCode.Length > 1)
+				instruction.Operand = m_MemoryManager.PeekBus(static_cast<std::uint16_t>(address + 1));
+
+			if (opCode.Length > 2)
+				instruction.Operand |= m_MemoryManager.PeekBus(static_cast<std::uint16_t>(address + 2)) << 8;
+
+			m_Instructions.push_back(instruction);
+			block.Count++;
+
+			// Absolute operands are read every pass, only ones reading the same value each time qualify
+			readsOnly = readsOnly && opCode.ReadsOnly && (opCode.Length < 3 || IsPollable(instruction.Operand));
+
+			if ((opCodeByte & 0x1F) == 0x10)
+				target = static_cast<std::uint16_t>(address + 2 + static_cast<std::int8_t>(instruction.Operand));
+			else if (opCodeByte == 0x4c)
+				target = instruction.Operand;
+
+			address += opCode.Length;
+
+			if (opCode.EndsBlock)
+				break;
+		}
+
+		if (block.Count == 0)
+			return nullptr;
+
+		block.IdleLoop = readsOnly && target == pc;
+
+		// RAM code can be overwritten, the pages it came from report writes from now on
+		if (!bank)
+		{
+			for (std::uint32_t page = pc >> 8; page <= (address - 1) >> 8; page++)
+				m_MemoryManager.WatchCodePage(static_cast<std::uint8_t>(page));
+
+			m_RAMBlockPCs.push_back(pc);
+		}
+
+		m_Blocks.push_back(block);
+		m_Heads[pc] = static_cast<std::uint32_t>(m_Blocks.size());
+
+		return &m_Blocks.back();
+	}
+
+	auto BlockCache::DropRAMBlocks() -> void
+	{
+		// RAM addresses never hold ROM blocks, unlinking their heads is enough. The storage is reused
+		// once the cache fills up.
+		for (auto pc : m_RAMBlockPCs)
+			m_Heads[pc] = 0;
+
+		m_RAMBlockPCs.clear();
+		m_Flushes++;
+	}
+
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "emu/memory/memorymanager.h"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+namespace emu
+{
+
+	class CPU;
+	struct JitFrame;
+
+	struct OpValue
+	{
+		std::uint8_t Size{ 0 };
+		std::uint8_t ClockCycles{ 0 };
+	};
+
+	using OpCodeFn = auto (*)(CPU&) -> OpValue;
+	using NativeBlock = auto (*)(JitFrame*) -> void;
+
+	// Decoder view of an opcode. Length 0 marks opcodes the interpreter does not implement, EndsBlock
+	// the ones that may continue anywhere but at the next instruction. ReadsOnly ones change nothing
+	// but registers and flags, reading at most the address in their operand.
+	struct OpCodeInfo
+	{
+		OpCodeFn Execute{ nullptr };
+		std::uint8_t Length{ 0 };
+		bool EndsBlock{ false };
+		bool ReadsOnly{ false };
+	};
+
+
+	// Straight-line runs of decoded instructions, keyed by the PC they start at and the PRG bank mapped
+	// there when they were decoded. A block never crosses a PRG window, so switching a bank in leaves the
+	// blocks of the old one waiting for it to come back. Blocks decoded from RAM have the pages they were
+	// read from watched by the MemoryManager, a write there drops every RAM block.
+	class BlockCache
+	{
+	public:
+		static constexpr std::uint32_t MaxBlockInstructions = 32;
+		static constexpr std::size_t MaxBlocks = 0x4000;
+
+		// Handler and operand bytes of one instruction. The cycle cost stays with the handler, page
+		// crossings and taken branches are only known when it runs.
+		struct Instruction
+		{
+			OpCodeFn Execute{ nullptr };
+			std::uint16_t Operand{ 0 };
+			std::uint8_t OpCode{ 0 };
+			std::uint8_t Size{ 0 };
+		};
+
+		struct Block
+		{
+			const std::uint8_t* Bank{ nullptr };
+			std::uint32_t First{ 0 };
+			std::uint32_t Count{ 0 };
+			std::uint32_t Next{ 0 };
+			std::uint16_t PC{ 0 };
+
+			// Runs so far and the compiled code once the recompiler took it
+			std::uint32_t Executions{ 0 };
+			NativeBlock Native{ nullptr };
+
+			// Branches or jumps back to its own start and only reads RAM, PRG space or PPU status on
+			// the way, what CPU idle loop skipping looks for
+			bool IdleLoop{ false };
+		};
+
+		explicit BlockCache(MemoryManager& memoryManager, std::span<const OpCodeInfo, 0x100> opCodes);
+
+		// Block starting at pc, decoded on the first visit. nullptr when pc is outside RAM and PRG ROM or
+		// its first instruction can not be decoded, the interpreter takes those.
+		auto Lookup(std::uint16_t pc) -> Block*;
+		auto GetInstructions(const Block& block) const -> std::span<const Instruction> { return { m_Instructions.data() + block.First, block.Count }; }
+
+		auto Clear() -> void;
+
+		auto GetBlockCount() const -> std::size_t { return m_Blocks.size(); }
+		auto GetFlushCount() const -> std::uint64_t { return m_Flushes; }
+
+	private:
+		auto Decode(std::uint16_t pc, const std::uint8_t* bank, std::uint32_t regionEnd) -> Block*;
+		auto DropRAMBlocks() -> void;
+
+	private:
+		MemoryManager& m_MemoryManager;
+		std::span<const OpCodeInfo, 0x100> m_OpCodes;
+
+		std::vector<Instruction> m_Instructions{};
+		std::vector<Block> m_Blocks{};
+
+		// Index + 1 of the newest block per PC, older ones for other banks follow through Block::Next
+		std::vector<std::uint32_t> m_Heads = std::vector<std::uint32_t>(0x10000, 0);
+		std::vector<std::uint16_t> m_RAMBlockPCs{};
+
+		std::uint32_t m_CodeWrites{ 0 };
+		std::uint64_t m_Flushes{ 0 };
+	};
+
+
+}
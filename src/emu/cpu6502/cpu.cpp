@@ -1,130 +1,64 @@
 #include "emu/cpu6502/cpu.h"
 #include "input/controller.h"
 
-#include <atomic>
 #include <array>
-#include <bitset>
-#include <chrono>
-#include <functional>
-#include <optional>
 #include <print>
 #include <string>
 #include <string_view>
-#include <thread>
 #include <vector>
 
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
-
-
-using namespace std::chrono_literals;
 
 namespace emu
 {
 
 
-	constexpr std::uint8_t FlagCarry = 0;
-	constexpr std::uint8_t FlagZero = 1;
-	constexpr std::uint8_t FlagInterrupt = 2;
-	constexpr std::uint8_t FlagDecimal = 3;
-	constexpr std::uint8_t FlagBreak = 4;
-	constexpr std::uint8_t FlagOverflow = 6;
-	constexpr std::uint8_t FlagNegative = 7;
-
 	constexpr std::uint16_t StackLocation = 0x0100;
 
-	static Registers s_Registers{};
-	static std::bitset<8> s_Flags{};
-
-	static std::atomic<bool> s_NMI{ false };
-	static std::atomic<bool> s_NMIRunning{ false };
-	static std::atomic<bool> s_IRQ{ false };
-	static std::atomic<bool> s_StepToRTS{ false };
-
-	static std::uint8_t s_DMACycles{ 0 };
-
-	struct OpValue
+	struct OpCodeDescriptor
 	{
-		std::uint8_t Size{ 0 };
-		std::uint8_t ClockCycles{ 0 };
+		std::uint8_t OpCode{ 0 };
+		std::string_view Mnemonic{};
+		OpCodeFn Execute{ nullptr };
 	};
 
-	using OpCodeFn = std::function<std::optional<OpValue>(CPU&)>;
-	static std::array<OpCodeFn, 0xFF> s_OpCodes;
 
-	enum class FrequencyType
-	{
-		PAL,
-		NTSC,
-		Dendy,
-	};
-
-	static std::unordered_map<FrequencyType, std::uint32_t> s_Frequency
-	{
-		{ FrequencyType::PAL, 1'662'607 },
-		{ FrequencyType::NTSC, 1'789'773 },
-		{ FrequencyType::Dendy, 1'773'448 },
-	};
 
-	static auto PrintRegisters() -> void
-	{
-		std::println("Flags:\n        NVxB DIZC");
-		std::print("        ");
 
-		s_Flags[FlagNegative] ? std::print("x") : std::print("-");
-		s_Flags[FlagOverflow] ? std::print("x-") : std::print("--");
-		s_Flags[FlagBreak] ? std::print("x ") : std::print("- ");
-		s_Flags[FlagDecimal] ? std::print("x") : std::print("-");
-		s_Flags[FlagInterrupt] ? std::print("x") : std::print("-");
-		s_Flags[FlagZero] ? std::print("x") : std::print("-");
-		s_Flags[FlagCarry] ? std::print("x") : std::print("-");
 
-		std::println("\nRegisters:\n        A : {:02x}", s_Registers.A);
-		std::println("        X : {:02x}", s_Registers.X);
-		std::println("        Y : {:02x}", s_Registers.Y);
-		std::println("        PC: {:04x}", s_Registers.PC);
-		std::println("        SP: {:02x}", s_Registers.SP);
+	auto CPU::FetchImmediate() -> std::uint8_t
+	{
+		return static_cast<std::uint8_t>(m_Operand);
 	}
 
-
-
-
-
 	auto CPU::FetchAbsoluteAddress() -> std::uint16_t
 	{
-		auto memoryLow = ReadAddress(s_Registers.PC + 1);
-		auto memoryHigh = ReadAddress(s_Registers.PC + 2);
-		std::uint16_t address = (memoryHigh << 8) + memoryLow;
-
-		return address;
+		return m_Operand;
 	}
 
 	auto CPU::FetchAbsluteAddressRegister(std::uint8_t Registers::* reg) -> std::uint16_t
 	{
-		auto memoryLow = ReadAddress(s_Registers.PC + 1);
-		auto memoryHigh = ReadAddress(s_Registers.PC + 2);
-		std::uint16_t address = (memoryHigh << 8) + memoryLow + s_Registers.*reg;
+		std::uint16_t address = m_Operand + m_Registers.*reg;
 
 		return address;
 	}
 
 	auto CPU::FetchIndirectIndexedAddress() -> std::uint16_t
 	{
-//		auto zeropageAddress = m_MemoryManager.ReadMemory(MemoryOwner::CPU, s_Registers.PC + 1);
-		auto zeropageAddress = m_MemoryManager.ReadProgramROM(s_Registers.PC + 1);
+//		auto zeropageAddress = m_MemoryManager.ReadMemory(MemoryOwner::CPU, m_Registers.PC + 1);
+		auto zeropageAddress = FetchImmediate();
 
 		auto addressLow = ReadAddress(zeropageAddress);
 		auto addressHigh = ReadAddress(zeropageAddress + 1);
 		std::uint16_t address = (addressHigh << 8) + addressLow;
 
-		address += s_Registers.Y;
+		address += m_Registers.Y;
 
 		return address;
 	}
 
 	auto CPU::FetchZeropageAddress() -> std::uint16_t
 	{
-		auto memoryLow = ReadAddress(s_Registers.PC + 1);
+		auto memoryLow = FetchImmediate();
 		std::uint16_t address = (0x00 << 8) + memoryLow;
 
 		return address;
@@ -132,22 +66,15 @@ namespace emu
 
 	auto CPU::FetchZeropageAddressRegister(std::uint8_t Registers::*offset) -> std::uint16_t
 	{
-		auto memoryLow = ReadAddress(s_Registers.PC + 1);
-		std::uint16_t address = (0x00 << 8) + memoryLow + s_Registers.*offset;
+		auto memoryLow = FetchImmediate();
+		std::uint16_t address = (0x00 << 8) + memoryLow + m_Registers.*offset;
 
 		return address;
 	}
 
 	auto CPU::ReadAddress(std::uint16_t address) -> std::uint8_t
 	{
-		if (address >= 0x2000 && address < 0x2008)
-			return m_MemoryManager.ReadPPUIO(address);
-		else if (address >= 0x4000 && address < 0x4018)
-			return m_MemoryManager.ReadAPUIO(address);
-		else if (address < 0x8000)
-			return m_MemoryManager.ReadCPURAM(address);
-
-		return m_MemoryManager.ReadProgramROM(address);
+		return m_MemoryManager.ReadBus(address);
 	}
 
 	auto CPU::ReadAbsoluteAddress() -> std::uint8_t
@@ -177,33 +104,7 @@ namespace emu
 
 	auto CPU::WriteAddress(std::uint16_t address, std::uint8_t value) -> void
 	{
-
-		if (address >= 0x2000 && address < 0x2008)
-		{
-			m_MemoryManager.WritePPUIO(address, value);
-			return;
-		}
-
-		if (address >= 0x4000 && address < 0x4018)
-		{
-			// Check for OAM DMA write
-			if (address == 0x4014)
-			{
-				m_MemoryManager.DMATransfer(MemoryOwner::PPU, value);
-				s_DMACycles = 514;
-			}
-
-			if (address == 0x4015)
-			{
-				m_MemoryManager.DMATransfer(MemoryOwner::ASU, value);
-				s_DMACycles = 4;
-			}
-
-			m_MemoryManager.WriteAPUIO(address, value);
-			return;
-		}
-
-		m_MemoryManager.WriteCPURAM(address, value);
+		m_MemoryManager.WriteBus(address, value);
 	}
 
 	auto CPU::WriteAbsoluteAddress(const std::uint8_t value) -> void
@@ -236,907 +137,1037 @@ namespace emu
 
 
 
-	auto AddWithCarry(std::uint8_t value) -> void
+	auto AddWithCarry(CPU& cpu, std::uint8_t value) -> void
 	{
+		auto& registers = cpu.GetRegisters();
 //		bool bit7 = value & 0x40;
-		std::uint16_t result = s_Registers.A + value + s_Flags[FlagCarry];
-		s_Registers.A = static_cast<std::uint8_t>(result);
+		std::uint16_t result = registers.A + value + (registers.P & FlagCarry);
+		registers.A = static_cast<std::uint8_t>(result);
 
-		s_Flags[FlagCarry] = result & 0x100;
-		s_Flags[FlagNegative] = s_Registers.A & 0b1000'0000;
-//		s_Flags[FlagOverflow] = (s_Registers.A & 0b0100'0000) ^ bit7;
-		s_Flags[FlagZero] = s_Registers.A == 0;
+		bool overflow = ((registers.A & 0x80) && !(value & 0x80)) || (!(registers.A & 0x80) && (value & 0x80));
 
-		s_Flags[FlagOverflow] = ((s_Registers.A & 0x80) && !(value & 0x80)) || (!(s_Registers.A & 0x80) && (value & 0x80));
+		// C and V in one write of P, N and Z are left to the lookup
+		registers.P = static_cast<std::uint8_t>((registers.P & ~(FlagCarry | FlagOverflow)) | (result >> 8) | (overflow ? FlagOverflow : 0));
+		registers.NZ = registers.A;
 	}
 
-	static auto AddWithCarryAbsolute(CPU& cpu) -> std::optional<OpValue>
+	static auto AddWithCarryAbsolute(CPU& cpu) -> OpValue
 	{
-		AddWithCarry(cpu.ReadAbsoluteAddress());
+		AddWithCarry(cpu, cpu.ReadAbsoluteAddress());
 
 		return OpValue{ 3, 4 };
 	}
 	
-	static auto AddWithCarryAbsoluteIndexed(CPU& cpu, std::uint8_t Registers::*reg) -> std::optional<OpValue>
+	static auto AddWithCarryAbsoluteIndexed(CPU& cpu, std::uint8_t Registers::*reg) -> OpValue
 	{
-		AddWithCarry(cpu.ReadAbsoluteAddressRegister(reg));
+		AddWithCarry(cpu, cpu.ReadAbsoluteAddressRegister(reg));
 
 		return OpValue{ 3, 4 };
 	}
 
-	static auto AddWithCarryImmediate(CPU& cpu) -> std::optional<OpValue>
+	static auto AddWithCarryImmediate(CPU& cpu) -> OpValue
 	{
-		AddWithCarry(cpu.ReadAddress(s_Registers.PC + 1));
+		AddWithCarry(cpu, cpu.FetchImmediate());
 
 		return OpValue{ 2, 2 };
 	}
 
-	static auto AddWithCarryZeropage(CPU& cpu) -> std::optional<OpValue>
+	static auto AddWithCarryZeropage(CPU& cpu) -> OpValue
 	{
-		AddWithCarry(cpu.ReadZeropageAddress());
+		AddWithCarry(cpu, cpu.ReadZeropageAddress());
 
 		return OpValue{ 2, 3 };
 	}
 
-	static auto AddWithCarryZeropageReg(CPU& cpu, std::uint8_t Registers::*reg) -> std::optional<OpValue>
+	static auto AddWithCarryZeropageReg(CPU& cpu, std::uint8_t Registers::*reg) -> OpValue
 	{
-		AddWithCarry(cpu.ReadZeropageAddressRegister(reg));
+		AddWithCarry(cpu, cpu.ReadZeropageAddressRegister(reg));
 
 		return OpValue{ 2, 4 };
 	}
 
-	auto And(std::uint8_t value) -> void
+	auto And(CPU& cpu, std::uint8_t value) -> void
 	{
-		s_Registers.A = s_Registers.A & value;
+		auto& registers = cpu.GetRegisters();
+		registers.A = registers.A & value;
 
-		s_Flags[FlagNegative] = s_Registers.A & 0b1000'0000;
-		s_Flags[FlagZero] = s_Registers.A == 0;
+		registers.NZ = registers.A;
 	}
 
-	static auto AndAbsolute(CPU& cpu) -> std::optional<OpValue>
+	static auto AndAbsolute(CPU& cpu) -> OpValue
 	{
-		And(cpu.ReadAbsoluteAddress());
+		And(cpu, cpu.ReadAbsoluteAddress());
 
 		return OpValue{ 3, 4 };
 	}
 
-	static auto AndAbsoluteOffset(CPU& cpu, std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto AndAbsoluteOffset(CPU& cpu, std::uint8_t Registers::* reg) -> OpValue
 	{
-		And(cpu.ReadAbsoluteAddressRegister(reg));
+		And(cpu, cpu.ReadAbsoluteAddressRegister(reg));
 
 		return OpValue{ 3, 4 };
 	}
 
-	static auto AndImmediate(CPU& cpu) -> std::optional<OpValue>
+	static auto AndImmediate(CPU& cpu) -> OpValue
 	{
-		And(cpu.ReadAddress(s_Registers.PC + 1));
+		And(cpu, cpu.FetchImmediate());
 
 		return OpValue{ 2, 2 };
 	}
 
-	static auto AndZeropage(CPU& cpu) -> std::optional<OpValue>
+	static auto AndZeropage(CPU& cpu) -> OpValue
 	{
-		And(cpu.ReadZeropageAddress());
+		And(cpu, cpu.ReadZeropageAddress());
 
 		return OpValue{ 2, 3 };
 	}
 
-	auto ArithmeticShiftLeft(std::uint8_t& value) -> void
+	auto ArithmeticShiftLeft(CPU& cpu, std::uint8_t& value) -> void
 	{
-		s_Flags[FlagCarry] = value & 0x80;
+		auto& registers = cpu.GetRegisters();
+
+		registers.SetFlag(FlagCarry, value & 0x80);
 		value <<= 1;
 
-		s_Flags[FlagNegative] = value & 0b1000'0000;
-		s_Flags[FlagZero] = value == 0;
+		registers.NZ = value;
 	}
 
-	static auto AslAccumulator(CPU& cpu) -> std::optional<OpValue>
+	static auto AslAccumulator(CPU& cpu) -> OpValue
 	{
-		ArithmeticShiftLeft(s_Registers.A);
+		auto& registers = cpu.GetRegisters();
+
+		ArithmeticShiftLeft(cpu, registers.A);
 
 		return OpValue{ 1, 2 };
 	}
 
-	static auto AslAbsolute(CPU& cpu) -> std::optional<OpValue>
+	static auto AslAbsolute(CPU& cpu) -> OpValue
 	{
 		auto address = cpu.FetchAbsoluteAddress();
 		auto value = cpu.ReadAbsoluteAddress();
 
-		ArithmeticShiftLeft(value);
+		ArithmeticShiftLeft(cpu, value);
 
 		cpu.WriteAddress(address, value);
 
 		return OpValue{ 3, 6 };
 	}
 
-	auto Bit(std::uint8_t value) -> void
+	auto Bit(CPU& cpu, std::uint8_t value) -> void
 	{
-		s_Flags[FlagZero] = (s_Registers.A & value) == 0;
-//		s_Flags[FlagOverflow] = value & 0b0100'0000;
-		s_Flags[FlagNegative] = value & 0b1000'0000;
+		auto& registers = cpu.GetRegisters();
+		// Z from A & value, N from bit 7 of value through bit 8 of NZ
+		registers.NZ = static_cast<std::uint16_t>((registers.A & value) | ((value & 0x80) << 1));
 
-		s_Flags[FlagOverflow] = ((s_Registers.A & 0x80) && !(value & 0x80)) || (!(s_Registers.A & 0x80) && (value & 0x80));
+		registers.SetFlag(FlagOverflow, ((registers.A & 0x80) && !(value & 0x80)) || (!(registers.A & 0x80) && (value & 0x80)));
 	}
 
-	static auto BitAbsolute(CPU& cpu) -> std::optional<OpValue>
+	static auto BitAbsolute(CPU& cpu) -> OpValue
 	{
-		Bit(cpu.ReadAbsoluteAddress());
+		Bit(cpu, cpu.ReadAbsoluteAddress());
 
 		return OpValue{ 3, 4 };
 	}
 
-	static auto BitZeropage(CPU& cpu) -> std::optional<OpValue>
+	static auto BitZeropage(CPU& cpu) -> OpValue
 	{
-		Bit(cpu.ReadZeropageAddress());
+		Bit(cpu, cpu.ReadZeropageAddress());
 
 		return OpValue{ 2, 3 };
 	}
 
-	static auto Branch(CPU& cpu, const std::uint8_t flag, bool condition) -> std::optional<OpValue>
+	static auto Branch(CPU& cpu, const std::uint8_t flag, bool condition) -> OpValue
 	{
-		std::int8_t relativePosition = cpu.ReadAddress(s_Registers.PC + 1);
+		auto& registers = cpu.GetRegisters();
+		std::int8_t relativePosition = cpu.FetchImmediate();
 
-		s_Registers.PC += 2;
+		registers.PC += 2;
 
-		bool boundaryCrossed = ((s_Registers.PC + relativePosition) & 0xFF00) != (s_Registers.PC & 0xFF00);
+		bool boundaryCrossed = ((registers.PC + relativePosition) & 0xFF00) != (registers.PC & 0xFF00);
 
-		if (s_Flags[flag] == condition)
+		if (registers.GetFlag(flag) == condition)
 		{
-			s_Registers.PC += relativePosition;
+			registers.PC += relativePosition;
 		}
 
 		return OpValue{ 0, static_cast<std::uint8_t>(2 + (boundaryCrossed ? 2 : 1)) };
 	}
 
-	static auto Break(CPU& cpu) -> std::optional<OpValue>
+	static auto Break(CPU& cpu) -> OpValue
 	{
-		cpu.WriteAddress(StackLocation + s_Registers.SP--, static_cast<std::uint8_t>(((s_Registers.PC) & 0xFF00) >> 8));
-		cpu.WriteAddress(StackLocation + s_Registers.SP--, static_cast<std::uint8_t>((s_Registers.PC) & 0xFF));
+		auto& registers = cpu.GetRegisters();
+		cpu.WriteAddress(StackLocation + registers.SP--, static_cast<std::uint8_t>(((registers.PC) & 0xFF00) >> 8));
+		cpu.WriteAddress(StackLocation + registers.SP--, static_cast<std::uint8_t>((registers.PC) & 0xFF));
 
-		s_Flags[FlagInterrupt] = true;
+		registers.P |= FlagInterrupt;
 
-		cpu.WriteAddress(StackLocation + s_Registers.SP--, static_cast<std::uint8_t>(s_Flags.to_ulong()));
+		cpu.WriteAddress(StackLocation + registers.SP--, registers.GetP());
 
-		s_Flags[FlagBreak] = true;
+		registers.P |= FlagBreak;
 
 		return OpValue{ 1, 7 };
 	}
 
-	auto Compare(std::uint8_t Registers::* reg, std::uint8_t value) -> void
+	// Hardware interrupt entry, the status byte is pushed with B clear so RTI restores the I flag
+	static auto Interrupt(CPU& cpu, std::uint16_t vector) -> OpValue
+	{
+		auto& registers = cpu.GetRegisters();
+		cpu.WriteAddress(StackLocation + registers.SP--, static_cast<std::uint8_t>(((registers.PC) & 0xFF00) >> 8));
+		cpu.WriteAddress(StackLocation + registers.SP--, static_cast<std::uint8_t>((registers.PC) & 0xFF));
+		cpu.WriteAddress(StackLocation + registers.SP--, static_cast<std::uint8_t>((registers.GetP() & ~FlagBreak) | 0x20));
+
+		registers.P |= FlagInterrupt;
+
+		registers.PC = static_cast<std::uint16_t>((cpu.ReadAddress(vector + 1) << 8) | cpu.ReadAddress(vector));
+
+		return OpValue{ 0, 7 };
+	}
+
+	auto Compare(CPU& cpu, std::uint8_t Registers::* reg, std::uint8_t value) -> void
 	{
-		std::uint8_t result = s_Registers.*reg - value;
-		s_Flags[FlagNegative] = result & 0b1000'0000;
-		s_Flags[FlagZero] = result == 0;
-//		s_Flags[FlagCarry] = result >= 0;
-		s_Flags[FlagCarry] = s_Registers.*reg >= value;
+		auto& registers = cpu.GetRegisters();
+		std::uint8_t result = registers.*reg - value;
+		registers.NZ = result;
+		registers.SetFlag(FlagCarry, registers.*reg >= value);
 	}
 
-	static auto CmpAbsolute(CPU& cpu, std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto CmpAbsolute(CPU& cpu, std::uint8_t Registers::* reg) -> OpValue
 	{
-		Compare(reg, cpu.ReadAbsoluteAddress());
+		Compare(cpu, reg, cpu.ReadAbsoluteAddress());
 
 		return OpValue{ 3, 4 };
 	}
 
-	static auto CmpAbsoluteIndexed(CPU& cpu, std::uint8_t Registers::* reg, std::uint8_t Registers::* offset) -> std::optional<OpValue>
+	static auto CmpAbsoluteIndexed(CPU& cpu, std::uint8_t Registers::* reg, std::uint8_t Registers::* offset) -> OpValue
 	{
-		Compare(reg, cpu.ReadAbsoluteAddressRegister(offset));
+		Compare(cpu, reg, cpu.ReadAbsoluteAddressRegister(offset));
 
 		return OpValue{ 3, 4 };
 	}
 
-	static auto CmpImmediate(CPU& cpu, std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto CmpImmediate(CPU& cpu, std::uint8_t Registers::* reg) -> OpValue
 	{
-		Compare(reg, cpu.ReadAddress(s_Registers.PC + 1));
+		Compare(cpu, reg, cpu.FetchImmediate());
 
 		return OpValue{ 2, 2 };
 	}
 
-	static auto CmpZeropage(CPU& cpu, std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto CmpZeropage(CPU& cpu, std::uint8_t Registers::* reg) -> OpValue
 	{
-		Compare(reg, cpu.ReadZeropageAddress());
+		Compare(cpu, reg, cpu.ReadZeropageAddress());
 
 		return OpValue{ 2, 3 };
 	}
 
-	static auto CmpZeropageReg(CPU& cpu, std::uint8_t Registers::* reg, std::uint8_t Registers::* offset) -> std::optional<OpValue>
+	static auto CmpZeropageReg(CPU& cpu, std::uint8_t Registers::* reg, std::uint8_t Registers::* offset) -> OpValue
 	{
-		Compare(reg, cpu.ReadZeropageAddressRegister(offset));
+		Compare(cpu, reg, cpu.ReadZeropageAddressRegister(offset));
 
 		return OpValue{ 2, 4 };
 	}
 
-	auto DecreaseRegister(std::uint8_t Registers::* reg) -> void
+	auto DecreaseRegister(CPU& cpu, std::uint8_t Registers::* reg) -> void
 	{
-		s_Registers.*reg = s_Registers.*reg - 1;
+		auto& registers = cpu.GetRegisters();
+		registers.*reg = registers.*reg - 1;
 
-		s_Flags[FlagNegative] = s_Registers.*reg & 0b1000'0000;
-		s_Flags[FlagZero] = s_Registers.*reg == 0;
+		registers.NZ = registers.*reg;
 	}
 
-	auto DecreaseValue(std::uint8_t value) -> std::uint8_t
+	auto DecreaseValue(CPU& cpu, std::uint8_t value) -> std::uint8_t
 	{
+		auto& registers = cpu.GetRegisters();
+
 		value = value - 1;
 
-		s_Flags[FlagNegative] = value & 0b1000'0000;
-		s_Flags[FlagZero] = value == 0;
+		registers.NZ = value;
 
 		return value;
 	}
 
-	static auto Dec(std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto Dec(CPU& cpu, std::uint8_t Registers::* reg) -> OpValue
 	{
-		DecreaseRegister(reg);
+		DecreaseRegister(cpu, reg);
 
 		return OpValue{ 1, 2 };
 	}
 
-	static auto DecAbsolute(CPU& cpu) -> std::optional<OpValue>
+	static auto DecAbsolute(CPU& cpu) -> OpValue
 	{
 		auto address = cpu.FetchAbsoluteAddress();
 		auto value = cpu.ReadAddress(address);
 
-		value = DecreaseValue(value);
+		value = DecreaseValue(cpu, value);
 
 		cpu.WriteAddress(address, value);
 
 		return OpValue{ 3, 6 };
 	}
 
-	static auto DecAbsoluteRegister(CPU& cpu, std::uint8_t Registers::*reg) -> std::optional<OpValue>
+	static auto DecAbsoluteRegister(CPU& cpu, std::uint8_t Registers::*reg) -> OpValue
 	{
 		auto address = cpu.FetchAbsluteAddressRegister(reg);
 		auto value = cpu.ReadAbsoluteAddressRegister(reg);
 
-		value = DecreaseValue(value);
+		value = DecreaseValue(cpu, value);
 
 		cpu.WriteAddress(address, value);
 
 		return OpValue{ 3, 7 };
 	}
 
-	static auto DecZeropage(CPU& cpu) -> std::optional<OpValue>
+	static auto DecZeropage(CPU& cpu) -> OpValue
 	{
 		auto address = cpu.FetchZeropageAddress();
 		auto value = cpu.ReadZeropageAddress();
 
-		value = DecreaseValue(value);
+		value = DecreaseValue(cpu, value);
 
 		cpu.WriteAddress(address, value);
 
 		return OpValue{ 2, 5 };
 	}
 
-	static auto DecZeropageReg(CPU& cpu, std::uint8_t Registers::*reg) -> std::optional<OpValue>
+	static auto DecZeropageReg(CPU& cpu, std::uint8_t Registers::*reg) -> OpValue
 	{
 		auto address = cpu.FetchZeropageAddressRegister(reg);
 		auto value = cpu.ReadZeropageAddressRegister(reg);
 
-		value = DecreaseValue(value);
+		value = DecreaseValue(cpu, value);
 
 		cpu.WriteAddress(address, value);
 
 		return OpValue{ 2, 6 };
 	}
 
-	auto ExclusiveOr(std::uint8_t value) -> void
+	auto ExclusiveOr(CPU& cpu, std::uint8_t value) -> void
 	{
-		s_Registers.A = s_Registers.A ^ value;
+		auto& registers = cpu.GetRegisters();
+		registers.A = registers.A ^ value;
 
-		s_Flags[FlagNegative] = s_Registers.A & 0b1000'0000;
-		s_Flags[FlagZero] = s_Registers.A == 0;
+		registers.NZ = registers.A;
 	}
 
-	static auto EorImmediate(CPU& cpu) -> std::optional<OpValue>
+	static auto EorImmediate(CPU& cpu) -> OpValue
 	{
-		ExclusiveOr(cpu.ReadAddress(s_Registers.PC + 1));
+		ExclusiveOr(cpu, cpu.FetchImmediate());
 
 		return OpValue{ 2, 2 };
 	}
 
-	static auto EorZeropage(CPU& cpu) -> std::optional<OpValue>
+	static auto EorZeropage(CPU& cpu) -> OpValue
 	{
-		ExclusiveOr(cpu.ReadZeropageAddress());
+		ExclusiveOr(cpu, cpu.ReadZeropageAddress());
 
 		return OpValue{ 2, 3 };
 	}
 
-	auto IncreaseRegister(std::uint8_t Registers::* reg) -> void
+	auto IncreaseRegister(CPU& cpu, std::uint8_t Registers::* reg) -> void
 	{
-		s_Registers.*reg = s_Registers.*reg + 1;
+		auto& registers = cpu.GetRegisters();
+		registers.*reg = registers.*reg + 1;
 
-		s_Flags[FlagNegative] = s_Registers.*reg & 0b1000'0000;
-		s_Flags[FlagZero] = s_Registers.*reg == 0;
+		registers.NZ = registers.*reg;
 	}
 
-	auto IncreaseValue(std::uint8_t value) -> std::uint8_t
+	auto IncreaseValue(CPU& cpu, std::uint8_t value) -> std::uint8_t
 	{
+		auto& registers = cpu.GetRegisters();
+
 		value = value + 1;
 
-		s_Flags[FlagNegative] = value & 0b1000'0000;
-		s_Flags[FlagZero] = value == 0;
+		registers.NZ = value;
 
 		return value;
 	}
 
-	static auto Inc(std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto Inc(CPU& cpu, std::uint8_t Registers::* reg) -> OpValue
 	{
-		IncreaseRegister(reg);
+		IncreaseRegister(cpu, reg);
 
 		return OpValue{ 1, 2 };
 	}
 
-	static auto IncAbsolute(CPU& cpu) -> std::optional<OpValue>
+	static auto IncAbsolute(CPU& cpu) -> OpValue
 	{
 		std::uint16_t address = cpu.FetchAbsoluteAddress();
 		auto value = cpu.ReadAddress(address);
 
-		value = IncreaseValue(value);
+		value = IncreaseValue(cpu, value);
 
 		cpu.WriteAddress(address, value);
 
 		return OpValue{ 3, 6 };
 	}
 
-	static auto IncZeropage(CPU& cpu) -> std::optional<OpValue>
+	static auto IncZeropage(CPU& cpu) -> OpValue
 	{
 		auto address = cpu.FetchZeropageAddress();
 		auto value = cpu.ReadZeropageAddress();
 
-		value = IncreaseValue(value);
+		value = IncreaseValue(cpu, value);
 
 		cpu.WriteAddress(address, value);
 
 		return OpValue{ 2, 5 };
 	}
 
-	static auto JmpAbsolute(CPU& cpu) -> std::optional<OpValue>
+	static auto JmpAbsolute(CPU& cpu) -> OpValue
 	{
-		auto addressLow = cpu.ReadAddress(s_Registers.PC + 1);
-		auto addressHigh = cpu.ReadAddress(s_Registers.PC + 2);
-		std::uint16_t address = (addressHigh << 8) + addressLow;
+		auto& registers = cpu.GetRegisters();
+
+		std::uint16_t address = cpu.FetchAbsoluteAddress();
 
-		s_Registers.PC = address;
+		registers.PC = address;
 
 		return OpValue{ 0, 3 };
 	}
 
-	static auto JmpIndirect(CPU& cpu) -> std::optional<OpValue>
+	static auto JmpIndirect(CPU& cpu) -> OpValue
 	{
-		auto addressZeroPage = cpu.ReadAddress(s_Registers.PC + 1);
+		auto& registers = cpu.GetRegisters();
+
+		auto addressZeroPage = cpu.FetchImmediate();
 
 		auto jumpAddressLow = cpu.ReadAddress(addressZeroPage);
 		auto jumpAddressHigh = cpu.ReadAddress(addressZeroPage + 1);
 		std::uint16_t jumpAddress = (jumpAddressHigh << 8) + jumpAddressLow;
 
-		s_Registers.PC = jumpAddress;
+		registers.PC = jumpAddress;
 
 		// TODO: fix cycles
 		return OpValue{ 0, 5 };
 	}
 
-	static auto JsrAbsolute(CPU& cpu) -> std::optional<OpValue>
+	static auto JsrAbsolute(CPU& cpu) -> OpValue
 	{
-		cpu.WriteAddress(StackLocation + s_Registers.SP--, static_cast<std::uint8_t>(((s_Registers.PC + 2) & 0xFF00) >> 8));
-		cpu.WriteAddress(StackLocation + s_Registers.SP--, static_cast<std::uint8_t>((s_Registers.PC + 2) & 0xFF));
+		auto& registers = cpu.GetRegisters();
 
-		auto addressLow = cpu.ReadAddress(s_Registers.PC + 1);
-		auto addressHigh = cpu.ReadAddress(s_Registers.PC + 2);
-		std::uint16_t address = (addressHigh << 8) + addressLow;
+		cpu.WriteAddress(StackLocation + registers.SP--, static_cast<std::uint8_t>(((registers.PC + 2) & 0xFF00) >> 8));
+		cpu.WriteAddress(StackLocation + registers.SP--, static_cast<std::uint8_t>((registers.PC + 2) & 0xFF));
 
-		s_Registers.PC = address;
+		std::uint16_t address = cpu.FetchAbsoluteAddress();
+
+		registers.PC = address;
 
 		return OpValue{ 0, 3 };
 	}
 
-	auto LoadRegister(std::uint8_t Registers::* reg, std::uint8_t value) -> void
+	auto LoadRegister(CPU& cpu, std::uint8_t Registers::* reg, std::uint8_t value) -> void
 	{
-		s_Registers.*reg = value;
+		auto& registers = cpu.GetRegisters();
+		registers.*reg = value;
 
-		s_Flags[FlagNegative] = value & 0b1000'0000;
-		s_Flags[FlagZero] = value == 0;
+		registers.NZ = value;
 	}
 
-	static auto LdAbsolute(CPU& cpu, std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto LdAbsolute(CPU& cpu, std::uint8_t Registers::* reg) -> OpValue
 	{
-		LoadRegister(reg, cpu.ReadAbsoluteAddress());
+		LoadRegister(cpu, reg, cpu.ReadAbsoluteAddress());
 
 		return OpValue{ 3, 4 };
 	}
 
-	static auto LdAbsoluteReg(CPU& cpu, std::uint8_t Registers::* reg, std::uint8_t Registers::* offsetReg) -> std::optional<OpValue>
+	static auto LdAbsoluteReg(CPU& cpu, std::uint8_t Registers::* reg, std::uint8_t Registers::* offsetReg) -> OpValue
 	{
-		LoadRegister(reg, cpu.ReadAbsoluteAddressRegister(offsetReg));
+		auto& registers = cpu.GetRegisters();
+
+		LoadRegister(cpu, reg, cpu.ReadAbsoluteAddressRegister(offsetReg));
 
-		bool boundaryCrossed = (((s_Registers.PC + s_Registers.*offsetReg) & 0xFF00) != (s_Registers.PC & 0xFF00));
+		bool boundaryCrossed = (((registers.PC + registers.*offsetReg) & 0xFF00) != (registers.PC & 0xFF00));
 
 		return OpValue{ 3, static_cast<std::uint8_t>(4 + boundaryCrossed ? 1 : 0) };
 	}
 
-	static auto LdImmediate(CPU& cpu, std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto LdImmediate(CPU& cpu, std::uint8_t Registers::* reg) -> OpValue
 	{
-		LoadRegister(reg, cpu.ReadAddress(s_Registers.PC + 1));
+		LoadRegister(cpu, reg, cpu.FetchImmediate());
 
 		return OpValue{ 2, 2 };
 	}
 
-	static auto LdaIndirectIndex(CPU& cpu) -> std::optional<OpValue>
+	static auto LdaIndirectIndex(CPU& cpu) -> OpValue
 	{
-		LoadRegister(&Registers::A, cpu.ReadIndirectIndexed());
+		auto& registers = cpu.GetRegisters();
+
+		LoadRegister(cpu, &Registers::A, cpu.ReadIndirectIndexed());
 
-		bool boundaryCrossed = (((s_Registers.PC + s_Registers.A) & 0xFF00) != (s_Registers.PC & 0xFF00));
+		bool boundaryCrossed = (((registers.PC + registers.A) & 0xFF00) != (registers.PC & 0xFF00));
 
 		return OpValue{ 2, static_cast<std::uint8_t>(5 + (boundaryCrossed == true) ? 1 : 0) };
 	}
 
-	static auto LdZeropage(CPU& cpu, std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto LdZeropage(CPU& cpu, std::uint8_t Registers::* reg) -> OpValue
 	{
-		LoadRegister(reg, cpu.ReadZeropageAddress());
+		LoadRegister(cpu, reg, cpu.ReadZeropageAddress());
 
 		return OpValue{ 2, 3 };
 	}
 
-	static auto LdZeropageReg(CPU& cpu, std::uint8_t Registers::* reg, std::uint8_t Registers::* offsetReg) -> std::optional<OpValue>
+	static auto LdZeropageReg(CPU& cpu, std::uint8_t Registers::* reg, std::uint8_t Registers::* offsetReg) -> OpValue
 	{
-		LoadRegister(reg, cpu.ReadZeropageAddressRegister(offsetReg));
+		LoadRegister(cpu, reg, cpu.ReadZeropageAddressRegister(offsetReg));
 
 		return OpValue{ 2, 4 };
 	}
 
-	auto LogicalShiftRight(std::uint8_t value) -> std::uint8_t
+	auto LogicalShiftRight(CPU& cpu, std::uint8_t value) -> std::uint8_t
 	{
-		s_Flags[FlagCarry] = value & 0x01;
+		auto& registers = cpu.GetRegisters();
+
+		registers.SetFlag(FlagCarry, value & 0x01);
 
 		value = value >> 1;
 
-		s_Flags[FlagNegative] = false;
-		s_Flags[FlagZero] = value == 0;
+		// Bit 7 is clear after the shift, so N is too
+		registers.NZ = value;
 
 		return value;
 	}
 
-	static auto LogicalShiftRightAccumulator(CPU& cpu) -> std::optional<OpValue>
+	static auto LogicalShiftRightAccumulator(CPU& cpu) -> OpValue
 	{
-		s_Registers.A = LogicalShiftRight(s_Registers.A);
+		auto& registers = cpu.GetRegisters();
+
+		registers.A = LogicalShiftRight(cpu, registers.A);
 
 		return OpValue{ 1, 2 };
 	}
 
-	static auto LogicalShiftRightAbsolute(CPU& cpu) -> std::optional<OpValue>
+	static auto LogicalShiftRightAbsolute(CPU& cpu) -> OpValue
 	{
 		auto address = cpu.FetchAbsoluteAddress();
 		auto value = cpu.ReadAbsoluteAddress();
 
-		value = LogicalShiftRight(value);
+		value = LogicalShiftRight(cpu, value);
 
 		cpu.WriteAddress(address, value);
 
 		return OpValue{ 3, 6 };
 	}
 
-	static auto LogicalShiftRightZeropage(CPU& cpu) -> std::optional<OpValue>
+	static auto LogicalShiftRightZeropage(CPU& cpu) -> OpValue
 	{
 		auto address = cpu.FetchZeropageAddress();
 		auto value = cpu.ReadZeropageAddress();
 
-		value = LogicalShiftRight(value);
+		value = LogicalShiftRight(cpu, value);
 
 		cpu.WriteAddress(address, value);
 
 		return OpValue{ 2, 5 };
 	}
 
-	auto Or(std::uint8_t value) -> void
+	auto Or(CPU& cpu, std::uint8_t value) -> void
 	{
-		s_Registers.A = s_Registers.A | value;
+		auto& registers = cpu.GetRegisters();
+		registers.A = registers.A | value;
 
-		s_Flags[FlagNegative] = s_Registers.A & 0b1000'0000;
-		s_Flags[FlagZero] = s_Registers.A == 0;
+		registers.NZ = registers.A;
 	}
 
-	static auto OrAbsolute(CPU& cpu) -> std::optional<OpValue>
+	static auto OrAbsolute(CPU& cpu) -> OpValue
 	{
-		Or(cpu.ReadAbsoluteAddress());
+		Or(cpu, cpu.ReadAbsoluteAddress());
 
 		return OpValue{ 3, 4 };
 	}
 
-	static auto OrAbsoluteRegister(CPU& cpu, std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto OrAbsoluteRegister(CPU& cpu, std::uint8_t Registers::* reg) -> OpValue
 	{
-		Or(cpu.ReadAbsoluteAddressRegister(reg));
+		Or(cpu, cpu.ReadAbsoluteAddressRegister(reg));
 
 		// TODO: Page boundary check and cycle correction
 		return OpValue{ 3, 4 };
 	}
 
-	static auto OrImmediate(CPU& cpu) -> std::optional<OpValue>
+	static auto OrImmediate(CPU& cpu) -> OpValue
 	{
-		Or(cpu.ReadAddress(s_Registers.PC + 1));
+		Or(cpu, cpu.FetchImmediate());
 
 		return OpValue{ 2, 2 };
 	}
 
-	static auto OrIndirectIndexed(CPU& cpu, std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto OrIndirectIndexed(CPU& cpu) -> OpValue
 	{
-		Or(cpu.ReadIndirectIndexed());
+		Or(cpu, cpu.ReadIndirectIndexed());
 
 		return OpValue{ 2, 6 };
 	}
 
-	static auto OrZeropage(CPU& cpu) -> std::optional<OpValue>
+	static auto OrZeropage(CPU& cpu) -> OpValue
 	{
-		Or(cpu.ReadZeropageAddress());
+		Or(cpu, cpu.ReadZeropageAddress());
 
 		return OpValue{ 2, 3 };
 	}
 
-	static auto OrZeropageOffset(CPU& cpu, std::uint8_t Registers::*offset) -> std::optional<OpValue>
+	static auto OrZeropageOffset(CPU& cpu, std::uint8_t Registers::*offset) -> OpValue
 	{
-		Or(cpu.ReadZeropageAddressRegister(offset));
+		Or(cpu, cpu.ReadZeropageAddressRegister(offset));
 
 		return OpValue{ 2, 4 };
 	}
 
-	static auto PullFromStack(CPU& cpu, std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto PullFromStack(CPU& cpu, std::uint8_t Registers::* reg) -> OpValue
 	{
-		s_Registers.*reg = cpu.ReadAddress(StackLocation + ++s_Registers.SP);
+		auto& registers = cpu.GetRegisters();
+
+		registers.*reg = cpu.ReadAddress(StackLocation + ++registers.SP);
 
 		return OpValue{ 1, 4 };
 	}
 
-	static auto PullSRFromStack(CPU& cpu) -> std::optional<OpValue>
+	static auto PullSRFromStack(CPU& cpu) -> OpValue
 	{
-		s_Flags = cpu.ReadAddress(StackLocation + ++s_Registers.SP);
+		auto& registers = cpu.GetRegisters();
+		registers.SetP(cpu.ReadAddress(StackLocation + ++registers.SP));
 
 		return OpValue{ 1, 4 };
 	}
 
-	static auto PushSRToStack(CPU& cpu) -> std::optional<OpValue>
+	static auto PushSRToStack(CPU& cpu) -> OpValue
 	{
-		cpu.WriteAddress(StackLocation + s_Registers.SP--, static_cast<std::uint8_t>(s_Flags.to_ulong()));
+		auto& registers = cpu.GetRegisters();
+		cpu.WriteAddress(StackLocation + registers.SP--, registers.GetP());
 
-		s_Flags[FlagBreak] = true;
+		registers.P |= FlagBreak;
 
 		return OpValue{ 1, 3 };
 	}
 
-	static auto PushToStack(CPU& cpu, std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto PushToStack(CPU& cpu, std::uint8_t Registers::* reg) -> OpValue
 	{
-		cpu.WriteAddress(StackLocation + s_Registers.SP--, s_Registers.*reg);
+		auto& registers = cpu.GetRegisters();
+
+		cpu.WriteAddress(StackLocation + registers.SP--, registers.*reg);
 
 		return OpValue{ 1, 3 };
 	}
 
-	static auto ReturnFromInterrupt(CPU& cpu) -> std::optional<OpValue>
+	static auto ReturnFromInterrupt(CPU& cpu) -> OpValue
 	{
+		auto& registers = cpu.GetRegisters();
+
 		PullSRFromStack(cpu);
-		auto addressLow = cpu.ReadAddress(StackLocation + ++s_Registers.SP);
-		auto addressHigh = cpu.ReadAddress(StackLocation + ++s_Registers.SP);
+		auto addressLow = cpu.ReadAddress(StackLocation + ++registers.SP);
+		auto addressHigh = cpu.ReadAddress(StackLocation + ++registers.SP);
 		std::uint16_t address = (addressHigh << 8) + addressLow;
 
-		s_Registers.PC = address;
+		registers.PC = address;
 
-		s_NMIRunning.store(false);
+		cpu.SetNMIRunning(false);
 
 		return OpValue{ 0, 6 };
 	}
 
-	static auto ReturnFromSubroutine(CPU& cpu) -> std::optional<OpValue>
+	static auto ReturnFromSubroutine(CPU& cpu) -> OpValue
 	{
-		auto addressLow = cpu.ReadAddress(StackLocation + ++s_Registers.SP);
-		auto addressHigh = cpu.ReadAddress(StackLocation + ++s_Registers.SP);
+		auto& registers = cpu.GetRegisters();
+
+		auto addressLow = cpu.ReadAddress(StackLocation + ++registers.SP);
+		auto addressHigh = cpu.ReadAddress(StackLocation + ++registers.SP);
 		std::uint16_t address = (addressHigh << 8) + addressLow;
 
-		s_Registers.PC = address + 1;
+		registers.PC = address + 1;
 
 		return OpValue{ 0, 6 };
 	}
 
-	auto RotateLeft(std::uint8_t value) -> std::uint8_t
+	auto RotateLeft(CPU& cpu, std::uint8_t value) -> std::uint8_t
 	{
+		auto& registers = cpu.GetRegisters();
+
 		bool carryFlag = (value & 0x80);
 		value <<= 1;
-		value += s_Flags[FlagCarry];
+		value += registers.P & FlagCarry;
 
-		s_Flags[FlagCarry] = carryFlag;
-		s_Flags[FlagNegative] = value & 0b1000'0000;
-		s_Flags[FlagZero] = value == 0;
+		registers.SetFlag(FlagCarry, carryFlag);
+		registers.NZ = value;
 
 		return value;
 	}
 
-	static auto RotateLeftAccumulator(CPU& cpu) -> std::optional<OpValue>
+	static auto RotateLeftAccumulator(CPU& cpu) -> OpValue
 	{
-		s_Registers.A = RotateLeft(s_Registers.A);
+		auto& registers = cpu.GetRegisters();
+
+		registers.A = RotateLeft(cpu, registers.A);
 
 		return OpValue{ 1, 2 };
 	}
 
-	static auto RotateLeftZeropage(CPU& cpu) -> std::optional<OpValue>
+	static auto RotateLeftZeropage(CPU& cpu) -> OpValue
 	{
 		auto address = cpu.FetchZeropageAddress();
 		auto value = cpu.ReadZeropageAddress();
 
-		value = RotateLeft(value);
+		value = RotateLeft(cpu, value);
 
 		cpu.WriteAddress(address, value);
 
 		return OpValue{ 2, 5 };
 	}
 
-	static auto RotateLeftAbsolute(CPU& cpu) -> std::optional<OpValue>
+	static auto RotateLeftAbsolute(CPU& cpu) -> OpValue
 	{
 		auto address = cpu.FetchAbsoluteAddress();
 		std::uint8_t value = cpu.ReadAddress(address);
 
-		value = RotateLeft(value);
+		value = RotateLeft(cpu, value);
 
 		cpu.WriteAddress(address, value);
 
 		return OpValue{ 3, 7 };
 	}
 
-	static auto RotateLeftAbsoluteX(CPU& cpu) -> std::optional<OpValue>
+	static auto RotateLeftAbsoluteX(CPU& cpu) -> OpValue
 	{
 		auto address = cpu.FetchAbsluteAddressRegister(&Registers::X);
 		std::uint8_t value = cpu.ReadAddress(address);
 
-		value = RotateLeft(value);
+		value = RotateLeft(cpu, value);
 
 		cpu.WriteAddress(address, value);
 
 		return OpValue{ 3, 7 };
 	}
 
-	auto RotateRight(std::uint8_t value) -> std::uint8_t
+	auto RotateRight(CPU& cpu, std::uint8_t value) -> std::uint8_t
 	{
+		auto& registers = cpu.GetRegisters();
+
 		bool carryFlag = value & 0x01;
-		value = (value >> 1) | (s_Flags[FlagCarry] ? 0x80 : 0x00);
+		value = (value >> 1) | ((registers.P & FlagCarry) ? 0x80 : 0x00);
 
-		s_Flags[FlagCarry] = carryFlag;
-		s_Flags[FlagNegative] = value & 0b1000'0000;
-		s_Flags[FlagZero] = value == 0;
+		registers.SetFlag(FlagCarry, carryFlag);
+		registers.NZ = value;
 
 		return value;
 	}
 
-	static auto RotateRightAccumulator(CPU& cpu) -> std::optional<OpValue>
+	static auto RotateRightAccumulator(CPU& cpu) -> OpValue
 	{
-		s_Registers.A = RotateRight(s_Registers.A);
+		auto& registers = cpu.GetRegisters();
+
+		registers.A = RotateRight(cpu, registers.A);
 
 		return OpValue{ 1, 2 };
 	}
 
-	static auto RotateRightAbsoluteX(CPU& cpu) -> std::optional<OpValue>
+	static auto RotateRightAbsoluteX(CPU& cpu) -> OpValue
 	{
 		auto address = cpu.FetchAbsluteAddressRegister(&Registers::X);
 		auto value = cpu.ReadAddress(address);
 
-		value = RotateRight(value);
+		value = RotateRight(cpu, value);
 
 		cpu.WriteAddress(address, value);
 
 		return OpValue{ 3, 7 };
 	}
 
-	static auto SbcAbsolute(CPU& cpu) -> std::optional<OpValue>
+	static auto SbcAbsolute(CPU& cpu) -> OpValue
 	{
-		AddWithCarry(~cpu.ReadAbsoluteAddress());
+		AddWithCarry(cpu, ~cpu.ReadAbsoluteAddress());
 
 		return OpValue{ 3, 4 };
 	}
 
-	static auto SbcAbsoluteOffset(CPU& cpu, std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto SbcAbsoluteOffset(CPU& cpu, std::uint8_t Registers::* reg) -> OpValue
 	{
-		AddWithCarry(~cpu.ReadAbsoluteAddressRegister(reg));
+		auto& registers = cpu.GetRegisters();
+
+		AddWithCarry(cpu, ~cpu.ReadAbsoluteAddressRegister(reg));
 		
-		bool boundaryCrossed = (((s_Registers.PC + s_Registers.*reg) & 0xFF00) != (s_Registers.PC & 0xFF00));
+		bool boundaryCrossed = (((registers.PC + registers.*reg) & 0xFF00) != (registers.PC & 0xFF00));
 
 		return OpValue{ 3, static_cast<std::uint8_t>(4 + boundaryCrossed ? 1 : 0) };
 	}
 
-	static auto SbcImmediate(CPU& cpu) -> std::optional<OpValue>
+	static auto SbcImmediate(CPU& cpu) -> OpValue
 	{
-		AddWithCarry(~cpu.ReadAddress(s_Registers.PC + 1));
+		AddWithCarry(cpu, ~cpu.FetchImmediate());
 
 		return OpValue{ 2, 2 };
 	}
 
-	static auto SbcZeropage(CPU& cpu) -> std::optional<OpValue>
+	static auto SbcZeropage(CPU& cpu) -> OpValue
 	{
-		AddWithCarry(~cpu.ReadZeropageAddress());
+		AddWithCarry(cpu, ~cpu.ReadZeropageAddress());
 
 		return OpValue{ 2, 3 };
 	}
 
-	static auto SbcZeropageOffset(CPU& cpu, std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto SbcZeropageOffset(CPU& cpu, std::uint8_t Registers::* reg) -> OpValue
 	{
-		AddWithCarry(~cpu.ReadZeropageAddressRegister(reg));
+		AddWithCarry(cpu, ~cpu.ReadZeropageAddressRegister(reg));
 
 		return OpValue{ 2, 4 };
 	}
 
-	static auto StAbsolute(CPU& cpu, std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto StAbsolute(CPU& cpu, std::uint8_t Registers::* reg) -> OpValue
 	{
-		cpu.WriteAbsoluteAddress(s_Registers.*reg);
+		auto& registers = cpu.GetRegisters();
+
+		cpu.WriteAbsoluteAddress(registers.*reg);
 
 		return OpValue{ 3, 4 };
 	}
 
-	static auto StZeropage(CPU& cpu, std::uint8_t Registers::* reg) -> std::optional<OpValue>
+	static auto StZeropage(CPU& cpu, std::uint8_t Registers::* reg) -> OpValue
 	{
-		cpu.WriteZeropageAddress(s_Registers.*reg);
+		auto& registers = cpu.GetRegisters();
+
+		cpu.WriteZeropageAddress(registers.*reg);
 
 		return OpValue{ 2, 3 };
 	}
 
-	static auto StZeropageReg(CPU& cpu, std::uint8_t Registers::* reg, std::uint8_t Registers::* offset) -> std::optional<OpValue>
+	static auto StZeropageReg(CPU& cpu, std::uint8_t Registers::* reg, std::uint8_t Registers::* offset) -> OpValue
 	{
-		cpu.WriteZeropageAddressRegister(offset, s_Registers.*reg);
+		auto& registers = cpu.GetRegisters();
+
+		cpu.WriteZeropageAddressRegister(offset, registers.*reg);
 
 		return OpValue{ 2, 4 };
 	}
 
-	static auto StaAbsoluteReg(CPU& cpu, std::uint8_t Registers::* offset) -> std::optional<OpValue>
+	static auto StaAbsoluteReg(CPU& cpu, std::uint8_t Registers::* offset) -> OpValue
 	{
-		cpu.WriteAbsoluteAddressRegister(offset, s_Registers.A);
+		auto& registers = cpu.GetRegisters();
+
+		cpu.WriteAbsoluteAddressRegister(offset, registers.A);
 
 		return OpValue{ 3, 5 };
 	}
 
-	static auto StaIndirectIndexed(CPU& cpu) -> std::optional<OpValue>
+	static auto StaIndirectIndexed(CPU& cpu) -> OpValue
 	{
-		cpu.WriteIndirectIndexed(s_Registers.A);
+		auto& registers = cpu.GetRegisters();
+
+		cpu.WriteIndirectIndexed(registers.A);
 
 		return OpValue{ 2, 6 };
 	}
 
-	static auto Transfer(std::uint8_t Registers::* from, std::uint8_t Registers::* to) -> std::optional<OpValue>
+	static auto Transfer(CPU& cpu, std::uint8_t Registers::* from, std::uint8_t Registers::* to) -> OpValue
 	{
-		s_Registers.*to = s_Registers.*from;
+		auto& registers = cpu.GetRegisters();
+		registers.*to = registers.*from;
 
-		s_Flags[FlagNegative] = s_Registers.*to & 0b1000'0000;
-		s_Flags[FlagZero] = s_Registers.*to == 0;
+		registers.NZ = registers.*to;
 
 		return OpValue{ 1, 2 };
 	}
 
-	static auto NOP(CPU& cpu) -> std::optional<OpValue> { return OpValue{ 0, 0 }; }
-
-	static auto SetupOpCodeArray() -> void
-	{
-		s_OpCodes[0x00] = []([[maybe_unused]] CPU& cpu) { return Break(cpu); };
-		s_OpCodes[0x05] = []([[maybe_unused]] CPU& cpu) { return OrZeropage(cpu); };
-		s_OpCodes[0x08] = []([[maybe_unused]] CPU& cpu) { return PushSRToStack(cpu); };
-		s_OpCodes[0x08] = []([[maybe_unused]] CPU& cpu) { return PushSRToStack(cpu); };
-		s_OpCodes[0x09] = []([[maybe_unused]] CPU& cpu) { return OrImmediate(cpu); };
-		s_OpCodes[0x0a] = []([[maybe_unused]] CPU& cpu) { return AslAccumulator(cpu); };
-		s_OpCodes[0x0d] = []([[maybe_unused]] CPU& cpu) { return OrAbsolute(cpu); };
-		s_OpCodes[0x0e] = []([[maybe_unused]] CPU& cpu) { return AslAbsolute(cpu); };
-		s_OpCodes[0x10] = []([[maybe_unused]] CPU& cpu) { return Branch(cpu, FlagNegative, false); };
-		s_OpCodes[0x11] = []([[maybe_unused]] CPU& cpu) { return OrIndirectIndexed(cpu, &Registers::A); };
-		s_OpCodes[0x15] = []([[maybe_unused]] CPU& cpu) { return OrZeropageOffset(cpu, &Registers::X); };
-		s_OpCodes[0x18] = []([[maybe_unused]] CPU& cpu) { s_Flags[FlagCarry] = false; return OpValue{ 1, 2 }; };
-		s_OpCodes[0x19] = []([[maybe_unused]] CPU& cpu) { return OrAbsoluteRegister(cpu, &Registers::Y); };
-		s_OpCodes[0x1D] = []([[maybe_unused]] CPU& cpu) { return OrAbsoluteRegister(cpu, &Registers::X); };
-		s_OpCodes[0x20] = []([[maybe_unused]] CPU& cpu) { return JsrAbsolute(cpu); };
-		s_OpCodes[0x24] = []([[maybe_unused]] CPU& cpu) { return BitZeropage(cpu); };
-		s_OpCodes[0x25] = []([[maybe_unused]] CPU& cpu) { return AndZeropage(cpu); };
-		s_OpCodes[0x26] = []([[maybe_unused]] CPU& cpu) { return RotateLeftZeropage(cpu); };
-		s_OpCodes[0x28] = []([[maybe_unused]] CPU& cpu) { return PullSRFromStack(cpu); };
-		s_OpCodes[0x29] = []([[maybe_unused]] CPU& cpu) { return AndImmediate(cpu); };
-		s_OpCodes[0x2a] = []([[maybe_unused]] CPU& cpu) { return RotateLeftAccumulator(cpu); };
-		s_OpCodes[0x2c] = []([[maybe_unused]] CPU& cpu) { return BitAbsolute(cpu); };
-		s_OpCodes[0x2d] = []([[maybe_unused]] CPU& cpu) { return AndAbsolute(cpu); };
-		s_OpCodes[0x2e] = []([[maybe_unused]] CPU& cpu) { return RotateLeftAbsolute(cpu); };
-		s_OpCodes[0x30] = []([[maybe_unused]] CPU& cpu) { return Branch(cpu, FlagNegative, true); };
-		s_OpCodes[0x38] = []([[maybe_unused]] CPU& cpu) { s_Flags[FlagCarry] = true; return OpValue{ 1, 2 }; };
-		s_OpCodes[0x39] = []([[maybe_unused]] CPU& cpu) { return AndAbsoluteOffset(cpu, &Registers::Y); };
-		s_OpCodes[0x3d] = []([[maybe_unused]] CPU& cpu) { return AndAbsoluteOffset(cpu, &Registers::X); };
-		s_OpCodes[0x3e] = []([[maybe_unused]] CPU& cpu) { return RotateLeftAbsoluteX(cpu); };
-		s_OpCodes[0x40] = []([[maybe_unused]] CPU& cpu) { return ReturnFromInterrupt(cpu); };
-		s_OpCodes[0x45] = []([[maybe_unused]] CPU& cpu) { return EorZeropage(cpu); };
-		s_OpCodes[0x46] = []([[maybe_unused]] CPU& cpu) { return LogicalShiftRightZeropage(cpu); };
-		s_OpCodes[0x48] = []([[maybe_unused]] CPU& cpu) { return PushToStack(cpu, &Registers::A); };
-		s_OpCodes[0x49] = []([[maybe_unused]] CPU& cpu) { return EorImmediate(cpu); };
-		s_OpCodes[0x4a] = []([[maybe_unused]] CPU& cpu) { return LogicalShiftRightAccumulator(cpu); };
-		s_OpCodes[0x4c] = []([[maybe_unused]] CPU& cpu) { return JmpAbsolute(cpu); };
-		s_OpCodes[0x4e] = []([[maybe_unused]] CPU& cpu) { return LogicalShiftRightAbsolute(cpu); };
-		s_OpCodes[0x60] = []([[maybe_unused]] CPU& cpu) { return ReturnFromSubroutine(cpu); };
-		s_OpCodes[0x65] = []([[maybe_unused]] CPU& cpu) { return AddWithCarryZeropage(cpu); };
-		s_OpCodes[0x68] = []([[maybe_unused]] CPU& cpu) { return PullFromStack(cpu, &Registers::A); };
-		s_OpCodes[0x69] = []([[maybe_unused]] CPU& cpu) { return AddWithCarryImmediate(cpu); };
-		s_OpCodes[0x6a] = []([[maybe_unused]] CPU& cpu) { return RotateRightAccumulator(cpu); };
-		s_OpCodes[0x6c] = []([[maybe_unused]] CPU& cpu) { return JmpIndirect(cpu); };
-		s_OpCodes[0x6d] = []([[maybe_unused]] CPU& cpu) { return AddWithCarryAbsolute(cpu); };
-		s_OpCodes[0x75] = []([[maybe_unused]] CPU& cpu) { return AddWithCarryZeropageReg(cpu, &Registers::X); };
-		s_OpCodes[0x78] = []([[maybe_unused]] CPU& cpu) { s_Flags[FlagInterrupt] = true;  return OpValue{ 1, 2 }; };
-		s_OpCodes[0x79] = []([[maybe_unused]] CPU& cpu) { return AddWithCarryAbsoluteIndexed(cpu, &Registers::Y); };
-		s_OpCodes[0x7d] = []([[maybe_unused]] CPU& cpu) { return AddWithCarryAbsoluteIndexed(cpu, &Registers::X); };
-		s_OpCodes[0x7e] = []([[maybe_unused]] CPU& cpu) { return RotateRightAbsoluteX(cpu); };
-		s_OpCodes[0x84] = []([[maybe_unused]] CPU& cpu) { return StZeropage(cpu, &Registers::Y); };
-		s_OpCodes[0x85] = []([[maybe_unused]] CPU& cpu) { return StZeropage(cpu, &Registers::A); };
-		s_OpCodes[0x86] = []([[maybe_unused]] CPU& cpu) { return StZeropage(cpu, &Registers::X); };
-		s_OpCodes[0x88] = []([[maybe_unused]] CPU& cpu) { return Dec(&Registers::Y); };
-		s_OpCodes[0x8a] = []([[maybe_unused]] CPU& cpu) { return Transfer(&Registers::X, &Registers::A); };
-		s_OpCodes[0x8c] = []([[maybe_unused]] CPU& cpu) { return StAbsolute(cpu, &Registers::Y); };
-		s_OpCodes[0x8d] = []([[maybe_unused]] CPU& cpu) { return StAbsolute(cpu, &Registers::A); };
-		s_OpCodes[0x8e] = []([[maybe_unused]] CPU& cpu) { return StAbsolute(cpu, &Registers::X); };
-		s_OpCodes[0x90] = []([[maybe_unused]] CPU& cpu) { return Branch(cpu, FlagCarry, false); };
-		s_OpCodes[0x91] = []([[maybe_unused]] CPU& cpu) { return StaIndirectIndexed(cpu); };
-		s_OpCodes[0x94] = []([[maybe_unused]] CPU& cpu) { return StZeropageReg(cpu, &Registers::Y, &Registers::X); };
-		s_OpCodes[0x95] = []([[maybe_unused]] CPU& cpu) { return StZeropageReg(cpu, &Registers::A, &Registers::X); };
-		s_OpCodes[0x96] = []([[maybe_unused]] CPU& cpu) { return StZeropageReg(cpu, &Registers::X, &Registers::Y); };
-		s_OpCodes[0x98] = []([[maybe_unused]] CPU& cpu) { return Transfer(&Registers::Y, &Registers::A); };
-		s_OpCodes[0x99] = []([[maybe_unused]] CPU& cpu) { return StaAbsoluteReg(cpu, &Registers::Y); };
-		s_OpCodes[0x9a] = []([[maybe_unused]] CPU& cpu) { s_Registers.SP = s_Registers.X; return OpValue{ 1, 2 }; };
-		s_OpCodes[0x9d] = []([[maybe_unused]] CPU& cpu) { return StaAbsoluteReg(cpu, &Registers::X); };
-		s_OpCodes[0xa0] = []([[maybe_unused]] CPU& cpu) { return LdImmediate(cpu, &Registers::Y); };
-		s_OpCodes[0xa2] = []([[maybe_unused]] CPU& cpu) { return LdImmediate(cpu, &Registers::X); };
-		s_OpCodes[0xa4] = []([[maybe_unused]] CPU& cpu) { return LdZeropage(cpu, &Registers::Y); };
-		s_OpCodes[0xa5] = []([[maybe_unused]] CPU& cpu) { return LdZeropage(cpu, &Registers::A); };
-		s_OpCodes[0xa6] = []([[maybe_unused]] CPU& cpu) { return LdZeropage(cpu, &Registers::X); };
-		s_OpCodes[0xa8] = []([[maybe_unused]] CPU& cpu) { return Transfer(&Registers::A, &Registers::Y); };
-		s_OpCodes[0xa9] = []([[maybe_unused]] CPU& cpu) { return LdImmediate(cpu, &Registers::A); };
-		s_OpCodes[0xaa] = []([[maybe_unused]] CPU& cpu) { return Transfer(&Registers::A, &Registers::X); };
-		s_OpCodes[0xac] = []([[maybe_unused]] CPU& cpu) { return LdAbsolute(cpu, &Registers::Y); };
-		s_OpCodes[0xad] = []([[maybe_unused]] CPU& cpu) { return LdAbsolute(cpu, &Registers::A); };
-		s_OpCodes[0xae] = []([[maybe_unused]] CPU& cpu) { return LdAbsolute(cpu, &Registers::X); };
-		s_OpCodes[0xb0] = []([[maybe_unused]] CPU& cpu) { return Branch(cpu, FlagCarry, true); };
-		s_OpCodes[0xb1] = []([[maybe_unused]] CPU& cpu) { return LdaIndirectIndex(cpu); };
-		s_OpCodes[0xb4] = []([[maybe_unused]] CPU& cpu) { return LdZeropageReg(cpu, &Registers::Y, &Registers::X); };
-		s_OpCodes[0xb5] = []([[maybe_unused]] CPU& cpu) { return LdZeropageReg(cpu, &Registers::A, &Registers::X); };
-		s_OpCodes[0xb6] = []([[maybe_unused]] CPU& cpu) { return LdZeropageReg(cpu, &Registers::X, &Registers::Y); };
-		s_OpCodes[0xbd] = []([[maybe_unused]] CPU& cpu) { return LdAbsoluteReg(cpu, &Registers::A, &Registers::X); };
-		s_OpCodes[0xbe] = []([[maybe_unused]] CPU& cpu) { return LdAbsoluteReg(cpu, &Registers::X, &Registers::Y); };
-		s_OpCodes[0xb9] = []([[maybe_unused]] CPU& cpu) { return LdAbsoluteReg(cpu, &Registers::A, &Registers::Y); };
-		s_OpCodes[0xbc] = []([[maybe_unused]] CPU& cpu) { return LdAbsoluteReg(cpu, &Registers::Y, &Registers::X); };
-		s_OpCodes[0xc0] = []([[maybe_unused]] CPU& cpu) { return CmpImmediate(cpu, &Registers::Y); };
-		s_OpCodes[0xc5] = []([[maybe_unused]] CPU& cpu) { return CmpZeropage(cpu, &Registers::A); };
-		s_OpCodes[0xc6] = []([[maybe_unused]] CPU& cpu) { return DecZeropage(cpu); };
-		s_OpCodes[0xc8] = []([[maybe_unused]] CPU& cpu) { return Inc(&Registers::Y); };
-		s_OpCodes[0xc9] = []([[maybe_unused]] CPU& cpu) { return CmpImmediate(cpu, &Registers::A); };
-		s_OpCodes[0xca] = []([[maybe_unused]] CPU& cpu) { return Dec(&Registers::X); };
-		s_OpCodes[0xcc] = []([[maybe_unused]] CPU& cpu) { return CmpAbsolute(cpu, &Registers::Y); };
-		s_OpCodes[0xcd] = []([[maybe_unused]] CPU& cpu) { return CmpAbsolute(cpu, &Registers::A); };
-		s_OpCodes[0xce] = []([[maybe_unused]] CPU& cpu) { return DecAbsolute(cpu); };
-		s_OpCodes[0xd0] = []([[maybe_unused]] CPU& cpu) { return Branch(cpu, FlagZero, false); };
-		s_OpCodes[0xd5] = []([[maybe_unused]] CPU& cpu) { return CmpZeropageReg(cpu, &Registers::A, &Registers::X); };
-		s_OpCodes[0xd6] = []([[maybe_unused]] CPU& cpu) { return DecZeropageReg(cpu, &Registers::X); };
-		s_OpCodes[0xd8] = []([[maybe_unused]] CPU& cpu) { s_Flags[FlagDecimal] = false; return OpValue{ 1, 2 }; };
-		s_OpCodes[0xd9] = []([[maybe_unused]] CPU& cpu) { return CmpAbsoluteIndexed(cpu, &Registers::A, &Registers::Y); };
-		s_OpCodes[0xdd] = []([[maybe_unused]] CPU& cpu) { return CmpAbsoluteIndexed(cpu, &Registers::A, &Registers::X); };
-		s_OpCodes[0xde] = []([[maybe_unused]] CPU& cpu) { return DecAbsoluteRegister(cpu, &Registers::X); };
-		s_OpCodes[0xe0] = []([[maybe_unused]] CPU& cpu) { return CmpImmediate(cpu, &Registers::X); };
-		s_OpCodes[0xe5] = []([[maybe_unused]] CPU& cpu) { return SbcZeropage(cpu); };
-		s_OpCodes[0xe6] = []([[maybe_unused]] CPU& cpu) { return IncZeropage(cpu); };
-		s_OpCodes[0xe8] = []([[maybe_unused]] CPU& cpu) { return Inc(&Registers::X); };
-		s_OpCodes[0xe9] = []([[maybe_unused]] CPU& cpu) { return SbcImmediate(cpu); };
-		s_OpCodes[0xed] = []([[maybe_unused]] CPU& cpu) { return SbcAbsolute(cpu); };
-		s_OpCodes[0xee] = []([[maybe_unused]] CPU& cpu) { return IncAbsolute(cpu); };
-		s_OpCodes[0xf0] = []([[maybe_unused]] CPU& cpu) { return Branch(cpu, FlagZero, true); };
-		s_OpCodes[0xf5] = []([[maybe_unused]] CPU& cpu) { return SbcZeropageOffset(cpu, &Registers::X); };
-		s_OpCodes[0xf9] = []([[maybe_unused]] CPU& cpu) { return SbcAbsoluteOffset(cpu, &Registers::Y); };
+	static auto NOP(CPU&) -> OpValue { return OpValue{ 1, 2 }; }
+
+	// Opcodes the table does not implement, 0 cycles make ExecuteInstruction report them and suspend
+	static auto InvalidOpCode(CPU&) -> OpValue { return OpValue{ 0, 0 }; }
+
+	// All implemented opcodes, the dispatch table below is generated from this list at compile time
+	static constexpr std::array s_OpCodeList
+	{
+		OpCodeDescriptor{ 0x00, "BRK", [](CPU& cpu) { return Break(cpu); } },
+		OpCodeDescriptor{ 0x05, "ORA", [](CPU& cpu) { return OrZeropage(cpu); } },
+		OpCodeDescriptor{ 0x08, "PHP", [](CPU& cpu) { return PushSRToStack(cpu); } },
+		OpCodeDescriptor{ 0x09, "ORA", [](CPU& cpu) { return OrImmediate(cpu); } },
+		OpCodeDescriptor{ 0x0a, "ASL", [](CPU& cpu) { return AslAccumulator(cpu); } },
+		OpCodeDescriptor{ 0x0d, "ORA", [](CPU& cpu) { return OrAbsolute(cpu); } },
+		OpCodeDescriptor{ 0x0e, "ASL", [](CPU& cpu) { return AslAbsolute(cpu); } },
+		OpCodeDescriptor{ 0x10, "BPL", [](CPU& cpu) { return Branch(cpu, FlagNegative, false); } },
+		OpCodeDescriptor{ 0x11, "ORA", [](CPU& cpu) { return OrIndirectIndexed(cpu); } },
+		OpCodeDescriptor{ 0x15, "ORA", [](CPU& cpu) { return OrZeropageOffset(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0x18, "CLC", [](CPU& cpu) { cpu.GetRegisters().P &= ~FlagCarry; return OpValue{ 1, 2 }; } },
+		OpCodeDescriptor{ 0x19, "ORA", [](CPU& cpu) { return OrAbsoluteRegister(cpu, &Registers::Y); } },
+		OpCodeDescriptor{ 0x1d, "ORA", [](CPU& cpu) { return OrAbsoluteRegister(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0x20, "JSR", [](CPU& cpu) { return JsrAbsolute(cpu); } },
+		OpCodeDescriptor{ 0x24, "BIT", [](CPU& cpu) { return BitZeropage(cpu); } },
+		OpCodeDescriptor{ 0x25, "AND", [](CPU& cpu) { return AndZeropage(cpu); } },
+		OpCodeDescriptor{ 0x26, "ROL", [](CPU& cpu) { return RotateLeftZeropage(cpu); } },
+		OpCodeDescriptor{ 0x28, "PLP", [](CPU& cpu) { return PullSRFromStack(cpu); } },
+		OpCodeDescriptor{ 0x29, "AND", [](CPU& cpu) { return AndImmediate(cpu); } },
+		OpCodeDescriptor{ 0x2a, "ROL", [](CPU& cpu) { return RotateLeftAccumulator(cpu); } },
+		OpCodeDescriptor{ 0x2c, "BIT", [](CPU& cpu) { return BitAbsolute(cpu); } },
+		OpCodeDescriptor{ 0x2d, "AND", [](CPU& cpu) { return AndAbsolute(cpu); } },
+		OpCodeDescriptor{ 0x2e, "ROL", [](CPU& cpu) { return RotateLeftAbsolute(cpu); } },
+		OpCodeDescriptor{ 0x30, "BMI", [](CPU& cpu) { return Branch(cpu, FlagNegative, true); } },
+		OpCodeDescriptor{ 0x38, "SEC", [](CPU& cpu) { cpu.GetRegisters().P |= FlagCarry; return OpValue{ 1, 2 }; } },
+		OpCodeDescriptor{ 0x39, "AND", [](CPU& cpu) { return AndAbsoluteOffset(cpu, &Registers::Y); } },
+		OpCodeDescriptor{ 0x3d, "AND", [](CPU& cpu) { return AndAbsoluteOffset(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0x3e, "ROL", [](CPU& cpu) { return RotateLeftAbsoluteX(cpu); } },
+		OpCodeDescriptor{ 0x40, "RTI", [](CPU& cpu) { return ReturnFromInterrupt(cpu); } },
+		OpCodeDescriptor{ 0x45, "EOR", [](CPU& cpu) { return EorZeropage(cpu); } },
+		OpCodeDescriptor{ 0x46, "LSR", [](CPU& cpu) { return LogicalShiftRightZeropage(cpu); } },
+		OpCodeDescriptor{ 0x48, "PHA", [](CPU& cpu) { return PushToStack(cpu, &Registers::A); } },
+		OpCodeDescriptor{ 0x49, "EOR", [](CPU& cpu) { return EorImmediate(cpu); } },
+		OpCodeDescriptor{ 0x4a, "LSR", [](CPU& cpu) { return LogicalShiftRightAccumulator(cpu); } },
+		OpCodeDescriptor{ 0x4c, "JMP", [](CPU& cpu) { return JmpAbsolute(cpu); } },
+		OpCodeDescriptor{ 0x4e, "LSR", [](CPU& cpu) { return LogicalShiftRightAbsolute(cpu); } },
+		OpCodeDescriptor{ 0x60, "RTS", [](CPU& cpu) { return ReturnFromSubroutine(cpu); } },
+		OpCodeDescriptor{ 0x65, "ADC", [](CPU& cpu) { return AddWithCarryZeropage(cpu); } },
+		OpCodeDescriptor{ 0x68, "PLA", [](CPU& cpu) { return PullFromStack(cpu, &Registers::A); } },
+		OpCodeDescriptor{ 0x69, "ADC", [](CPU& cpu) { return AddWithCarryImmediate(cpu); } },
+		OpCodeDescriptor{ 0x6a, "ROR", [](CPU& cpu) { return RotateRightAccumulator(cpu); } },
+		OpCodeDescriptor{ 0x6c, "JMP", [](CPU& cpu) { return JmpIndirect(cpu); } },
+		OpCodeDescriptor{ 0x6d, "ADC", [](CPU& cpu) { return AddWithCarryAbsolute(cpu); } },
+		OpCodeDescriptor{ 0x75, "ADC", [](CPU& cpu) { return AddWithCarryZeropageReg(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0x78, "SEI", [](CPU& cpu) { cpu.GetRegisters().P |= FlagInterrupt;  return OpValue{ 1, 2 }; } },
+		OpCodeDescriptor{ 0x79, "ADC", [](CPU& cpu) { return AddWithCarryAbsoluteIndexed(cpu, &Registers::Y); } },
+		OpCodeDescriptor{ 0x7d, "ADC", [](CPU& cpu) { return AddWithCarryAbsoluteIndexed(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0x7e, "ROR", [](CPU& cpu) { return RotateRightAbsoluteX(cpu); } },
+		OpCodeDescriptor{ 0x84, "STY", [](CPU& cpu) { return StZeropage(cpu, &Registers::Y); } },
+		OpCodeDescriptor{ 0x85, "STA", [](CPU& cpu) { return StZeropage(cpu, &Registers::A); } },
+		OpCodeDescriptor{ 0x86, "STX", [](CPU& cpu) { return StZeropage(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0x88, "DEY", [](CPU& cpu) { return Dec(cpu, &Registers::Y); } },
+		OpCodeDescriptor{ 0x8a, "TXA", [](CPU& cpu) { return Transfer(cpu, &Registers::X, &Registers::A); } },
+		OpCodeDescriptor{ 0x8c, "STY", [](CPU& cpu) { return StAbsolute(cpu, &Registers::Y); } },
+		OpCodeDescriptor{ 0x8d, "STA", [](CPU& cpu) { return StAbsolute(cpu, &Registers::A); } },
+		OpCodeDescriptor{ 0x8e, "STX", [](CPU& cpu) { return StAbsolute(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0x90, "BCC", [](CPU& cpu) { return Branch(cpu, FlagCarry, false); } },
+		OpCodeDescriptor{ 0x91, "STA", [](CPU& cpu) { return StaIndirectIndexed(cpu); } },
+		OpCodeDescriptor{ 0x94, "STY", [](CPU& cpu) { return StZeropageReg(cpu, &Registers::Y, &Registers::X); } },
+		OpCodeDescriptor{ 0x95, "STA", [](CPU& cpu) { return StZeropageReg(cpu, &Registers::A, &Registers::X); } },
+		OpCodeDescriptor{ 0x96, "STX", [](CPU& cpu) { return StZeropageReg(cpu, &Registers::X, &Registers::Y); } },
+		OpCodeDescriptor{ 0x98, "TYA", [](CPU& cpu) { return Transfer(cpu, &Registers::Y, &Registers::A); } },
+		OpCodeDescriptor{ 0x99, "STA", [](CPU& cpu) { return StaAbsoluteReg(cpu, &Registers::Y); } },
+		OpCodeDescriptor{ 0x9a, "TXS", [](CPU& cpu) { cpu.GetRegisters().SP = cpu.GetRegisters().X; return OpValue{ 1, 2 }; } },
+		OpCodeDescriptor{ 0x9d, "STA", [](CPU& cpu) { return StaAbsoluteReg(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0xa0, "LDY", [](CPU& cpu) { return LdImmediate(cpu, &Registers::Y); } },
+		OpCodeDescriptor{ 0xa2, "LDX", [](CPU& cpu) { return LdImmediate(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0xa4, "LDY", [](CPU& cpu) { return LdZeropage(cpu, &Registers::Y); } },
+		OpCodeDescriptor{ 0xa5, "LDA", [](CPU& cpu) { return LdZeropage(cpu, &Registers::A); } },
+		OpCodeDescriptor{ 0xa6, "LDX", [](CPU& cpu) { return LdZeropage(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0xa8, "TAY", [](CPU& cpu) { return Transfer(cpu, &Registers::A, &Registers::Y); } },
+		OpCodeDescriptor{ 0xa9, "LDA", [](CPU& cpu) { return LdImmediate(cpu, &Registers::A); } },
+		OpCodeDescriptor{ 0xaa, "TAX", [](CPU& cpu) { return Transfer(cpu, &Registers::A, &Registers::X); } },
+		OpCodeDescriptor{ 0xac, "LDY", [](CPU& cpu) { return LdAbsolute(cpu, &Registers::Y); } },
+		OpCodeDescriptor{ 0xad, "LDA", [](CPU& cpu) { return LdAbsolute(cpu, &Registers::A); } },
+		OpCodeDescriptor{ 0xae, "LDX", [](CPU& cpu) { return LdAbsolute(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0xb0, "BCS", [](CPU& cpu) { return Branch(cpu, FlagCarry, true); } },
+		OpCodeDescriptor{ 0xb1, "LDA", [](CPU& cpu) { return LdaIndirectIndex(cpu); } },
+		OpCodeDescriptor{ 0xb4, "LDY", [](CPU& cpu) { return LdZeropageReg(cpu, &Registers::Y, &Registers::X); } },
+		OpCodeDescriptor{ 0xb5, "LDA", [](CPU& cpu) { return LdZeropageReg(cpu, &Registers::A, &Registers::X); } },
+		OpCodeDescriptor{ 0xb6, "LDX", [](CPU& cpu) { return LdZeropageReg(cpu, &Registers::X, &Registers::Y); } },
+		OpCodeDescriptor{ 0xb9, "LDA", [](CPU& cpu) { return LdAbsoluteReg(cpu, &Registers::A, &Registers::Y); } },
+		OpCodeDescriptor{ 0xbc, "LDY", [](CPU& cpu) { return LdAbsoluteReg(cpu, &Registers::Y, &Registers::X); } },
+		OpCodeDescriptor{ 0xbd, "LDA", [](CPU& cpu) { return LdAbsoluteReg(cpu, &Registers::A, &Registers::X); } },
+		OpCodeDescriptor{ 0xbe, "LDX", [](CPU& cpu) { return LdAbsoluteReg(cpu, &Registers::X, &Registers::Y); } },
+		OpCodeDescriptor{ 0xc0, "CPY", [](CPU& cpu) { return CmpImmediate(cpu, &Registers::Y); } },
+		OpCodeDescriptor{ 0xc5, "CMP", [](CPU& cpu) { return CmpZeropage(cpu, &Registers::A); } },
+		OpCodeDescriptor{ 0xc6, "DEC", [](CPU& cpu) { return DecZeropage(cpu); } },
+		OpCodeDescriptor{ 0xc8, "INY", [](CPU& cpu) { return Inc(cpu, &Registers::Y); } },
+		OpCodeDescriptor{ 0xc9, "CMP", [](CPU& cpu) { return CmpImmediate(cpu, &Registers::A); } },
+		OpCodeDescriptor{ 0xca, "DEX", [](CPU& cpu) { return Dec(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0xcc, "CPY", [](CPU& cpu) { return CmpAbsolute(cpu, &Registers::Y); } },
+		OpCodeDescriptor{ 0xcd, "CMP", [](CPU& cpu) { return CmpAbsolute(cpu, &Registers::A); } },
+		OpCodeDescriptor{ 0xce, "DEC", [](CPU& cpu) { return DecAbsolute(cpu); } },
+		OpCodeDescriptor{ 0xd0, "BNE", [](CPU& cpu) { return Branch(cpu, FlagZero, false); } },
+		OpCodeDescriptor{ 0xd5, "CMP", [](CPU& cpu) { return CmpZeropageReg(cpu, &Registers::A, &Registers::X); } },
+		OpCodeDescriptor{ 0xd6, "DEC", [](CPU& cpu) { return DecZeropageReg(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0xd8, "CLD", [](CPU& cpu) { cpu.GetRegisters().P &= ~FlagDecimal; return OpValue{ 1, 2 }; } },
+		OpCodeDescriptor{ 0xd9, "CMP", [](CPU& cpu) { return CmpAbsoluteIndexed(cpu, &Registers::A, &Registers::Y); } },
+		OpCodeDescriptor{ 0xdd, "CMP", [](CPU& cpu) { return CmpAbsoluteIndexed(cpu, &Registers::A, &Registers::X); } },
+		OpCodeDescriptor{ 0xde, "DEC", [](CPU& cpu) { return DecAbsoluteRegister(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0xe0, "CPX", [](CPU& cpu) { return CmpImmediate(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0xe5, "SBC", [](CPU& cpu) { return SbcZeropage(cpu); } },
+		OpCodeDescriptor{ 0xe6, "INC", [](CPU& cpu) { return IncZeropage(cpu); } },
+		OpCodeDescriptor{ 0xe8, "INX", [](CPU& cpu) { return Inc(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0xe9, "SBC", [](CPU& cpu) { return SbcImmediate(cpu); } },
+		OpCodeDescriptor{ 0xea, "NOP", [](CPU& cpu) { return NOP(cpu); } },
+		OpCodeDescriptor{ 0xed, "SBC", [](CPU& cpu) { return SbcAbsolute(cpu); } },
+		OpCodeDescriptor{ 0xee, "INC", [](CPU& cpu) { return IncAbsolute(cpu); } },
+		OpCodeDescriptor{ 0xf0, "BEQ", [](CPU& cpu) { return Branch(cpu, FlagZero, true); } },
+		OpCodeDescriptor{ 0xf5, "SBC", [](CPU& cpu) { return SbcZeropageOffset(cpu, &Registers::X); } },
+		OpCodeDescriptor{ 0xf9, "SBC", [](CPU& cpu) { return SbcAbsoluteOffset(cpu, &Registers::Y); } },
+	};
+
+	static constexpr auto s_OpCodes = []
+	{
+		std::array<OpCodeFn, 0x100> opCodes{};
+		opCodes.fill([](CPU& cpu) { return InvalidOpCode(cpu); });
+
+		for (auto& descriptor : s_OpCodeList)
+		{
+			opCodes[descriptor.OpCode] = descriptor.Execute;
+		}
+
+		return opCodes;
+	}();
+
+	// Bytes taken by an opcode, from the addressing mode columns of the 6502 opcode matrix
+	static constexpr auto InstructionLength(std::uint8_t opCode) -> std::uint8_t
+	{
+		if (opCode == 0x20)
+			return 3;
+
+		if (opCode == 0x00 || opCode == 0x40 || opCode == 0x60)
+			return 1;
+
+		auto mode = (opCode >> 2) & 0x07;
+
+		if (opCode & 0x01)
+			return (mode == 3 || mode == 6 || mode == 7) ? 3 : 2;
+
+		return (mode == 2 || mode == 6) ? 1 : (mode == 3 || mode == 7) ? 3 : 2;
 	}
 
+	// Branches, jumps, calls, returns and BRK
+	static constexpr auto EndsBlock(std::uint8_t opCode) -> bool
+	{
+		return (opCode & 0x1F) == 0x10 || opCode == 0x00 || opCode == 0x20 || opCode == 0x40 || opCode == 0x4c || opCode == 0x60 || opCode == 0x6c;
+	}
 
-	CPU::CPU(PowerHandler& powerHandler, MemoryManager& memoryManager)
-		: m_PowerHandler(powerHandler), m_MemoryManager(memoryManager)
+	// Loads, compares, BIT, logic and arithmetic on immediate, zero page or absolute operands, register
+	// only instructions, branches and JMP
+	static constexpr auto ReadsOnly(std::uint8_t opCode) -> bool
 	{
-		for (auto& fn : s_OpCodes)
+		constexpr std::uint8_t opCodes[]
 		{
-			fn = [](CPU& cpu) { return NOP(cpu); };
+			0xa9, 0xa5, 0xad, 0xa2, 0xa6, 0xae, 0xa0, 0xa4, 0xac,
+			0xc9, 0xc5, 0xcd, 0xe0, 0xe4, 0xec, 0xc0, 0xc4, 0xcc, 0x24, 0x2c,
+			0x29, 0x25, 0x2d, 0x09, 0x05, 0x0d, 0x49, 0x45, 0x4d, 0x69, 0x65, 0x6d, 0xe9, 0xe5, 0xed,
+			0x0a, 0x4a, 0x2a, 0x6a, 0xaa, 0xa8, 0x8a, 0x98, 0xba, 0x9a, 0xe8, 0xca, 0xc8, 0x88,
+			0x18, 0x38, 0x58, 0x78, 0xb8, 0xd8, 0xf8, 0xea, 0x4c,
+		};
+
+		for (auto readOnly : opCodes)
+		{
+			if (opCode == readOnly)
+				return true;
 		}
 
-		SetupOpCodeArray();
+		return (opCode & 0x1F) == 0x10;
 	}
 
+	static constexpr auto s_OpCodeInfo = []
+	{
+		std::array<OpCodeInfo, 0x100> opCodes{};
+
+		for (std::uint32_t opCode = 0; opCode < opCodes.size(); opCode++)
+			opCodes[opCode].Execute = s_OpCodes[opCode];
+
+		for (auto& descriptor : s_OpCodeList)
+		{
+			opCodes[descriptor.OpCode].Length = InstructionLength(descriptor.OpCode);
+			opCodes[descriptor.OpCode].EndsBlock = EndsBlock(descriptor.OpCode);
+			opCodes[descriptor.OpCode].ReadsOnly = ReadsOnly(descriptor.OpCode);
+		}
+
+		return opCodes;
+	}();
+
 
-	auto CPU::Execute(std::uint16_t startVector) -> void
+	CPU::CPU(PowerHandler& powerHandler, MemoryManager& memoryManager)
+		: m_MemoryManager(memoryManager), m_PowerHandler(powerHandler), m_BlockCache(memoryManager, s_OpCodeInfo)
 	{
-		m_Executing.store(true);
+	}
 
-		s_Flags[FlagInterrupt] = false;
+
+	auto CPU::Reset(std::uint16_t startVector) -> void
+	{
+		m_Registers.P &= ~FlagInterrupt;
 
 		auto resetVector = 0xFFFC;
 
@@ -1145,175 +1176,287 @@ namespace emu
 			resetVector = startVector;
 		}
 
-		s_Registers.PC = m_MemoryManager.ReadProgramROM(resetVector + 1) << 8 + m_MemoryManager.ReadProgramROM(resetVector);
+		m_Registers.PC = (ReadAddress(resetVector + 1) << 8) + ReadAddress(resetVector);
+
+		m_Cycles = 0;
+	}
+
+	auto CPU::Step() -> std::uint16_t
+	{
+		auto interruptCycles = ServiceInterrupts();
+		m_Cycles += interruptCycles;
 
-		// Sets VBLANK flag - keep it static for debugging until PPU is implemented :-)
-//		m_Memory.Write(0x2002, 0x80);
+		return interruptCycles + ExecuteInstruction();
+	}
+
+	auto CPU::Run(std::uint32_t cycles) -> std::uint32_t
+	{
+		std::uint32_t executed{ 0 };
+		bool blockCache = m_BlockCacheEnabled.load(std::memory_order_relaxed);
+		bool recompiler = blockCache && m_Recompiler.IsAvailable() && m_RecompilerEnabled.load(std::memory_order_relaxed);
+		bool idleSkip = blockCache && m_IdleSkipEnabled.load(std::memory_order_relaxed);
 
-		const auto frequency = s_Frequency[FrequencyType::NTSC];
-		const auto cycleTime = 1'000'000'000 / frequency;
+		// What a loop reads may have changed since the last run, the PPU caught up in between
+		m_IdleLoop = {};
 
-		LARGE_INTEGER li{};
-		if (!QueryPerformanceFrequency(&li))
+		while (executed < cycles)
 		{
-			std::println("QueryPerformanceFrequency failed");
-		}
+			auto interruptCycles = ServiceInterrupts();
+			m_Cycles += interruptCycles;
+			executed += interruptCycles;
 
-		auto freq = li.QuadPart; //  / 1'000.0;
-		auto frequencyDivider = static_cast<double>(freq) / frequency;
+			auto block = blockCache ? m_BlockCache.Lookup(m_Registers.PC) : nullptr;
 
-		std::println("CPU frequency: {} Hz, PerformanceCounterFrequency = {} Hz, frequencyDivider = {}", frequency, freq, frequencyDivider);
+			if (block && recompiler && !block->Native && ++block->Executions >= m_Recompiler.GetHotThreshold())
+			{
+				block->Native = m_Recompiler.Compile(m_BlockCache.GetInstructions(*block), block->PC);
 
-		std::uint64_t cycles{ 0 };
-		std::uint64_t failedExecute{ 0 };
-		std::uint64_t failedCycles{ 0 };
+				// A full arena is emptied at once, the blocks compiled into it are decoded again
+				if (!block->Native)
+				{
+					m_Recompiler.Reset();
+					m_BlockCache.Clear();
 
-		auto startTime = std::chrono::steady_clock::now();
-		auto endTime = std::chrono::steady_clock::now();
+					block = m_BlockCache.Lookup(m_Registers.PC);
+				}
+			}
 
-		while (m_Executing.load())
-		{
-			LARGE_INTEGER startCount{};
-			QueryPerformanceCounter(&startCount);
+			auto remaining = executed < cycles ? cycles - executed : 0;
 
-			if (m_PowerHandler.GetState() == PowerState::SingleStep || m_PowerHandler.GetState() == PowerState::Off)
-				m_PowerHandler.SetState(PowerState::Suspended);
+			if (idleSkip)
 			{
-				std::unique_lock<std::mutex> lock(m_Mutex);
-				m_CV.wait(lock, [&] { 
-					return m_PowerHandler.GetState() != PowerState::Suspended || m_Executing.load() == 0;
-				});
+				auto skipped = SkipIdleLoop(block, remaining);
+				executed += skipped;
+				remaining -= skipped;
 			}
 
+			// Idle loops stay interpreted while skipping, compiled code would spin through the budget itself
+			std::uint32_t ran{ 0 };
 
-			uint16_t frameCycles{ 0 };
+			if (block && block->Native && recompiler && !(idleSkip && block->IdleLoop))
+				ran = RunNative(*block, remaining);
+			else if (block)
+				ran = RunBlock(*block, remaining);
+			else
+				ran = ExecuteInstruction();
 
-			if (s_NMI.load() && s_NMIRunning.load() == false && cycles > 500)
-			{
-				s_NMI.store(false);
-				s_NMIRunning.store(true);
-				Break(*this);
-				// PC = 0xFFFA - 1
-//					s_Registers.PC = startVector - 4;
-				s_Registers.PC = 0xFFF9;
+			executed += ran;
+
+			// An invalid opcode takes no cycles and suspends, the frontend may suspend too
+			if (ran == 0 || m_PowerHandler.GetState() == PowerState::Suspended)
+				break;
+		}
+
+		return executed;
+	}
+
+	auto CPU::ServiceInterrupts() -> std::uint16_t
+	{
+		std::uint16_t interruptCycles{ 0 };
+
+		// An NMI raised while the previous handler is still running is dropped
+		if (m_MemoryManager.IsNMIPending() && m_NMIRunning)
+		{
+			m_MemoryManager.ClearNMI();
+		}
+		else if (m_MemoryManager.IsNMIPending() && m_Cycles > 500)
+		{
+			m_MemoryManager.ClearNMI();
+			m_NMIRunning = true;
+			Break(*this);
+			// PC = 0xFFFA - 1
+//				m_Registers.PC = startVector - 4;
+			m_Registers.PC = 0xFFF9;
 
 // Comment out this to enable stepping on NMI
-//					m_PowerHandler.SetState(PowerState::SingleStep);
+//				m_PowerHandler.SetState(PowerState::SingleStep);
 
-					startTime = std::chrono::steady_clock::now();
+			m_Operand = static_cast<std::uint16_t>((m_MemoryManager.PeekBus(0xFFFB) << 8) | m_MemoryManager.PeekBus(0xFFFA));
+			JmpAbsolute(*this);
+		}
+		else if (m_MemoryManager.IsIRQAsserted() && !(m_Registers.P & FlagInterrupt))
+		{
+			interruptCycles = Interrupt(*this, 0xFFFE).ClockCycles;
+		}
 
-				JmpAbsolute(*this);
-			}
-			else if (s_IRQ.load() && !s_Flags[FlagInterrupt])
-			{
-				s_IRQ.store(false);
-				std::println("IRQ vector is unused in NES");
-			}
+		return interruptCycles;
+	}
+
+	auto CPU::InterruptPending() const -> bool
+	{
+		return m_MemoryManager.IsNMIPending() || (m_MemoryManager.IsIRQAsserted() && !(m_Registers.P & FlagInterrupt));
+	}
 
+	auto CPU::ExecuteInstruction() -> std::uint16_t
+	{
+		auto opCode = ReadAddress(m_Registers.PC);
+		m_Operand = static_cast<std::uint16_t>((m_MemoryManager.PeekBus(m_Registers.PC + 2) << 8) | m_MemoryManager.PeekBus(m_Registers.PC + 1));
 
-//				auto opCode = m_MemoryManager.ReadMemory(MemoryOwner::CPU, s_Registers.PC);
-			auto opCode = m_MemoryManager.ReadProgramROM(s_Registers.PC);
-			auto maybeExecuted = s_OpCodes[opCode](*this);
+		auto executed = s_OpCodes[opCode](*this);
 
-//				if (!maybeExecuted)
-//					break;
+		if (executed.ClockCycles == 0)
+		{
+			std::println("Invalid opcode: {:02x}", opCode);
+			m_PowerHandler.SetState(PowerState::Suspended);
+		}
 
-			if (maybeExecuted->ClockCycles == 0)
-			{
-				std::println("Invalid opcode: {:02x}", opCode);
-				m_PowerHandler.SetState(PowerState::Suspended);
-			}
+		m_Registers.PC += executed.Size;
 
-			s_Registers.PC += maybeExecuted->Size;
-
-//				if (opCode == 0x40)
-//				{
-//					endTime = std::chrono::steady_clock::now();
-
-//					std::println("Elapsed time: {}", std::chrono::duration<double>(endTime - startTime).count());
-//				}
-//				if (opCode == 0x60)
-//				if (s_Registers.PC == 0x8e04)
-//				if (s_Registers.PC == 0x9012)
-//				if (s_Registers.PC == 0x8ebb)
-//				if (s_Registers.PC == 0x8745)
-//				if (s_Registers.PC == 0x8175)  // OperModeExecutionTree
-//				if (s_Registers.PC == 0x9595)  // DecodeAreaData
-//				if (s_Registers.PC == 0x88ae || s_Registers.PC == 0x8e4d)  // RenderAreaGraphics | InitializeNameTables
-//				if (s_Registers.PC == 0x8e92) //  || s_Registers.PC == 0x896a)  // ScreenRoutines | DecodeAreaData
-//					m_PowerHandler.SetState(PowerState::Suspended);
-//				if (s_StepToRTS.load() && (opCode == 0x60 || opCode == 0x4c || opCode == 0x6c || opCode == 0x20 || opCode == 0x40))
-//				{
-//					m_PowerHandler.SetState(PowerState::Suspended);
-//					s_StepToRTS.store(false);
-//				}
-
-			cycles += maybeExecuted->ClockCycles + s_DMACycles;
-			frameCycles += maybeExecuted->ClockCycles + s_DMACycles;
-
-			s_DMACycles = 0;
-
-			std::int64_t countsElapsed{};
-
-			// Cycle sync
-			do
-			{
-				LARGE_INTEGER endCount;
-				QueryPerformanceCounter(&endCount);
+//			if (opCode == 0x60)
+//			if (m_Registers.PC == 0x8e04)
+//			if (m_Registers.PC == 0x9012)
+//			if (m_Registers.PC == 0x8ebb)
+//			if (m_Registers.PC == 0x8745)
+//			if (m_Registers.PC == 0x8175)  // OperModeExecutionTree
+//			if (m_Registers.PC == 0x9595)  // DecodeAreaData
+//			if (m_Registers.PC == 0x88ae || m_Registers.PC == 0x8e4d)  // RenderAreaGraphics | InitializeNameTables
+//			if (m_Registers.PC == 0x8e92) //  || m_Registers.PC == 0x896a)  // ScreenRoutines | DecodeAreaData
+//				m_PowerHandler.SetState(PowerState::Suspended);
+//			if (m_StepToRTS.load() && (opCode == 0x60 || opCode == 0x4c || opCode == 0x6c || opCode == 0x20 || opCode == 0x40))
+//			{
+//				m_PowerHandler.SetState(PowerState::Suspended);
+//				m_StepToRTS.store(false);
+//			}
 
-				countsElapsed = endCount.QuadPart - startCount.QuadPart;
+		std::uint16_t cycles = executed.ClockCycles + m_MemoryManager.ConsumeDMACycles();
 
-				if (countsElapsed > (frameCycles * frequencyDivider))
-				{
-					failedExecute++;
-					failedCycles += countsElapsed - (frameCycles * frequencyDivider);
-				}
+		m_Cycles += cycles;
+
+		return cycles;
+	}
 
-			} while (static_cast<double>(countsElapsed) < (frameCycles * frequencyDivider));
+	auto CPU::RunBlock(const BlockCache::Block& block, std::uint32_t cycles) -> std::uint32_t
+	{
+		// A bank switch or a write to watched RAM may replace the rest of the block
+		auto codeGeneration = m_MemoryManager.GetCodeGeneration();
+		auto pc = block.PC;
+
+		std::uint32_t executed{ 0 };
+
+		for (auto& instruction : m_BlockCache.GetInstructions(block))
+		{
+			m_Operand = instruction.Operand;
+
+			auto result = instruction.Execute(*this);
+			m_Registers.PC += result.Size;
+
+			std::uint16_t instructionCycles = result.ClockCycles + m_MemoryManager.ConsumeDMACycles();
+			m_Cycles += instructionCycles;
+			executed += instructionCycles;
 
+			pc += instruction.Size;
+
+			if (m_Registers.PC != pc || executed >= cycles || InterruptPending() || m_MemoryManager.GetCodeGeneration() != codeGeneration)
+				break;
 		}
 
-		std::println("Cycles: {}", cycles);
-		std::println("Failed to execute in time count: {} - average miss: {} cycles", failedExecute, failedCycles / static_cast<float>(failedExecute));
+		return executed;
 	}
 
-	auto CPU::GetRegisters() -> Registers&
+	auto CPU::RunNative(const BlockCache::Block& block, std::uint32_t cycles) -> std::uint32_t
 	{
-		return s_Registers;
+		JitFrame frame{ this, &m_Registers, m_MemoryManager.GetMemoryMap().CPURAM.Data.data(), m_MemoryManager.GetBusPages() };
+		frame.Budget = cycles;
+		frame.CodeGeneration = m_MemoryManager.GetCodeGeneration();
+
+		block.Native(&frame);
+
+		m_Cycles += frame.Cycles;
+
+		return frame.Cycles;
 	}
 
-	auto CPU::GetFlags() -> const std::uint8_t
+	auto CPU::SkipIdleLoop(const BlockCache::Block* block, std::uint32_t cycles) -> std::uint32_t
 	{
-		return static_cast<std::uint8_t>(s_Flags.to_ulong());
+		auto& idle = m_IdleLoop;
+
+		// Pending interrupts are taken between passes, anything but the loop itself starts over
+		if (!block || !block->IdleLoop || cycles == 0 || InterruptPending())
+		{
+			idle.Active = false;
+			return 0;
+		}
+
+		if (!idle.Active || idle.PC != block->PC || idle.Bank != block->Bank)
+		{
+			idle = IdleLoop{ true, block->PC, block->Bank };
+			return 0;
+		}
+
+		// The first pass may change what the next one reads, PPU status loses vblank, so the state after
+		// it is the reference. A pass coming back to it with nothing written repeats from then on.
+		if (++idle.Passes < 2 || m_Registers != idle.Snapshot)
+		{
+			idle.Passes = 1;
+			idle.Snapshot = m_Registers;
+			idle.Cycles = m_Cycles;
+			return 0;
+		}
+
+		// Whole passes, the last one still runs and ends where it would have
+		auto pass = m_Cycles - idle.Cycles;
+		auto skipped = static_cast<std::uint32_t>((cycles - 1) / pass * pass);
+
+		m_Cycles += skipped;
+		m_SkippedCycles.fetch_add(skipped, std::memory_order_relaxed);
+		idle.Cycles = m_Cycles;
+
+		return skipped;
+	}
+
+	auto CPU::GetMnemonic(std::uint8_t opCode) -> std::string_view
+	{
+		for (auto& descriptor : s_OpCodeList)
+		{
+			if (descriptor.OpCode == opCode)
+				return descriptor.Mnemonic;
+		}
+
+		return {};
 	}
 
-	auto CPU::Stop() -> void
+	auto CPU::GetFlags() -> const std::uint8_t
 	{
-		m_Executing.store(false);
-		m_CV.notify_all();
+		return m_Registers.GetP();
 	}
 
-	auto CPU::UpdatePowerState() -> void
+	auto CPU::NMIRunning() const -> bool
 	{
-		m_CV.notify_all();
+		return m_NMIRunning;
 	}
 
-	auto CPU::TriggerNMI() -> void
+	auto CPU::SetNMIRunning(bool running) -> void
 	{
-		if (s_NMIRunning.load() == true)
-			return;
+		m_NMIRunning = running;
+	}
 
-		s_NMI.store(true);
+	auto CPU::SaveState(CPUState& state) const -> void
+	{
+		state.A = m_Registers.A;
+		state.X = m_Registers.X;
+		state.Y = m_Registers.Y;
+		state.SP = m_Registers.SP;
+		state.PC = m_Registers.PC;
+		state.Flags = m_Registers.GetP();
+		state.NMIRunning = m_NMIRunning;
+		state.Cycles = m_Cycles;
 	}
 
-	auto CPU::NMIRunning() -> bool
+	auto CPU::LoadState(const CPUState& state) -> void
 	{
-		return s_NMIRunning.load();
+		m_Registers.A = state.A;
+		m_Registers.X = state.X;
+		m_Registers.Y = state.Y;
+		m_Registers.SP = state.SP;
+		m_Registers.PC = state.PC;
+		m_Registers.SetP(state.Flags);
+		m_NMIRunning = state.NMIRunning;
+		m_Cycles = state.Cycles;
 	}
 
 	auto CPU::StepToRTS() -> void
 	{
-		s_StepToRTS.store(true);
+		m_StepToRTS.store(true);
 	}
 
 }
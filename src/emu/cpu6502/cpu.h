@@ -1,10 +1,12 @@
 #pragma once
 
+#include "emu/cpu6502/blockcache.h"
+#include "emu/cpu6502/recompiler.h"
 #include "emu/memory/memorymanager.h"
 #include "emu/system/powerhandler.h"
 
+#include <array>
 #include <atomic>
-#include <condition_variable>
 #include <cstdint>
 #include <span>
 #include <string_view>
@@ -20,6 +22,28 @@ namespace emu
 		Step,
 	};
 
+	constexpr std::uint8_t FlagCarry = 0x01;
+	constexpr std::uint8_t FlagZero = 0x02;
+	constexpr std::uint8_t FlagInterrupt = 0x04;
+	constexpr std::uint8_t FlagDecimal = 0x08;
+	constexpr std::uint8_t FlagBreak = 0x10;
+	constexpr std::uint8_t FlagOverflow = 0x40;
+	constexpr std::uint8_t FlagNegative = 0x80;
+
+	// N and Z for every value Registers::NZ can hold
+	inline constexpr auto NZFlags = []
+	{
+		std::array<std::uint8_t, 0x200> table{};
+
+		for (std::uint32_t result = 0; result < table.size(); result++)
+			table[result] = static_cast<std::uint8_t>(((result & 0x180) ? FlagNegative : 0) | ((result & 0xFF) ? 0 : FlagZero));
+
+		return table;
+	}();
+
+	// P holds the status bits except N and Z, which are evaluated lazily: instructions only store their
+	// result in NZ and the two flags are looked up when a branch, PHP, BRK or an interrupt reads them.
+	// Bit 8 of NZ sets N on its own, so BIT can take N and Z from different values.
 	struct Registers
 	{
 		std::uint8_t A{};
@@ -27,32 +51,87 @@ namespace emu
 		std::uint8_t Y{};
 		std::uint16_t PC{ 0xFFFC };
 		std::uint8_t SP{ 0xFD };
+		std::uint8_t P{};
+		std::uint16_t NZ{ 1 };
+
+		auto operator==(const Registers&) const -> bool = default;
+
+		auto GetP() const -> std::uint8_t { return P | NZFlags[NZ]; }
+
+		auto SetP(std::uint8_t value) -> void
+		{
+			P = value & ~(FlagNegative | FlagZero);
+			NZ = ((value & FlagNegative) ? 0x100 : 0x00) | ((value & FlagZero) ? 0x00 : 0x01);
+		}
+
+		auto GetFlag(std::uint8_t flag) const -> bool { return GetP() & flag; }
+
+		auto SetFlag(std::uint8_t flag, bool set) -> void
+		{
+			if (flag & (FlagNegative | FlagZero))
+				SetP(set ? GetP() | flag : GetP() & ~flag);
+			else
+				P = set ? P | flag : P & ~flag;
+		}
 	};
 
 	class CPU
 	{
+		friend class Recompiler;
+
 	public:
 		CPU() = delete;
 //		explicit CPU(MemoryManager& memoryManager, DMA& oamDMA, DMA& dmcDMA);
 		explicit CPU(PowerHandler& powerHandler, MemoryManager& memoryManager);
 
-		auto Stop() -> void;
-
-		static auto TriggerNMI() -> void;
-		static auto NMIRunning() -> bool;
+		auto NMIRunning() const -> bool;
+		auto SetNMIRunning(bool running) -> void;
 		auto StepToRTS() -> void;
 
-		auto UpdatePowerState() -> void;
-
-		auto GetRegisters() -> Registers&;
+		auto GetRegisters() -> Registers& { return m_Registers; }
 		auto GetFlags() -> const std::uint8_t;
 
-		auto Execute(std::uint16_t startVector = 0) -> void;
+		auto Reset(std::uint16_t startVector = 0) -> void;
+		auto Step() -> std::uint16_t;
+
+		// Runs whole instructions until at least cycles have passed and returns how many did. Interrupts
+		// are taken between instructions as with Step. With the block cache enabled, decoded blocks run
+		// back to back and are left early when an interrupt becomes pending, with the recompiler the hot
+		// ones run compiled under the same rules. Returns early at an invalid opcode or once suspended.
+		auto Run(std::uint32_t cycles) -> std::uint32_t;
+
+		auto SetBlockCacheEnabled(bool enabled) -> void { m_BlockCacheEnabled.store(enabled); }
+		auto IsBlockCacheEnabled() const -> bool { return m_BlockCacheEnabled.load(); }
+		auto GetBlockCache() const -> const BlockCache& { return m_BlockCache; }
+
+		// Runs hot blocks as x86-64 code. Works on top of the block cache and does nothing with it off
+		// or on other hosts.
+		auto SetRecompilerEnabled(bool enabled) -> void { m_RecompilerEnabled.store(enabled); }
+		auto IsRecompilerEnabled() const -> bool { return m_RecompilerEnabled.load(); }
+		auto GetRecompiler() -> Recompiler& { return m_Recompiler; }
+
+		// Jumps over the passes of idle loops, blocks that branch back to themselves and write nothing,
+		// to the end of the cycle budget where the PPU next changes what they read. A loop is only
+		// skipped once a pass left the registers as it found them, so it ends as if it had run. Works on
+		// top of the block cache, GetSkippedCycles counts the cycles never run.
+		auto SetIdleSkipEnabled(bool enabled) -> void { m_IdleSkipEnabled.store(enabled); }
+		auto IsIdleSkipEnabled() const -> bool { return m_IdleSkipEnabled.load(); }
+		auto GetSkippedCycles() const -> std::uint64_t { return m_SkippedCycles.load(std::memory_order_relaxed); }
+
+		static auto GetMnemonic(std::uint8_t opCode) -> std::string_view;
+
+		auto GetCycles() const -> std::uint64_t { return m_Cycles; }
+
+		auto SaveState(CPUState& state) const -> void;
+		auto LoadState(const CPUState& state) -> void;
+
+		auto GetMemoryManager() -> MemoryManager& { return m_MemoryManager; }
 //		auto Execute(std::span<std::uint8_t> program, const std::uint16_t memoryLocation) -> void;
 
 		inline auto ReadAddress(std::uint16_t address) -> std::uint8_t;
 		inline auto WriteAddress(std::uint16_t address, std::uint8_t value) -> void;
 
+		inline auto FetchImmediate() -> std::uint8_t;
 		inline auto FetchAbsoluteAddress() -> std::uint16_t;
 		inline auto FetchAbsluteAddressRegister(std::uint8_t Registers::* reg) -> std::uint16_t;
 		inline auto FetchIndirectIndexedAddress() -> std::uint16_t;
@@ -71,16 +150,50 @@ namespace emu
 
 		//		auto AbsoluteAddress() -> uint16_t;
 
+	private:
+		auto ServiceInterrupts() -> std::uint16_t;
+		auto ExecuteInstruction() -> std::uint16_t;
+		auto RunBlock(const BlockCache::Block& block, std::uint32_t cycles) -> std::uint32_t;
+		auto RunNative(const BlockCache::Block& block, std::uint32_t cycles) -> std::uint32_t;
+		auto SkipIdleLoop(const BlockCache::Block* block, std::uint32_t cycles) -> std::uint32_t;
+		auto InterruptPending() const -> bool;
+
 	private:
 		MemoryManager& m_MemoryManager;
 		PowerHandler& m_PowerHandler;
 
-		std::uint16_t m_StartVector{ 0 };
+		Registers m_Registers{};
+
+		// Operand bytes of the instruction being executed, the addressing helpers read them from here
+		std::uint16_t m_Operand{ 0 };
+
+		BlockCache m_BlockCache;
+		std::atomic<bool> m_BlockCacheEnabled{ true };
+
+		Recompiler m_Recompiler{};
+		std::atomic<bool> m_RecompilerEnabled{ false };
 
-		std::atomic<bool> m_Executing{ false };
+		// Idle loop entered last, with the registers and cycle count after its first pass. It is kept by
+		// PC and bank, blocks move when the cache grows and are dropped when it is cleared.
+		struct IdleLoop
+		{
+			bool Active{ false };
+			std::uint16_t PC{ 0 };
+			const std::uint8_t* Bank{ nullptr };
+			std::uint32_t Passes{ 0 };
+			Registers Snapshot{};
+			std::uint64_t Cycles{ 0 };
+		};
 
-		std::condition_variable m_CV{};
-		std::mutex m_Mutex{};
+		IdleLoop m_IdleLoop{};
+		std::atomic<bool> m_IdleSkipEnabled{ false };
+		std::atomic<std::uint64_t> m_SkippedCycles{ 0 };
+
+		bool m_NMIRunning{ false };
+		std::atomic<bool> m_StepToRTS{ false };
+
+		std::uint16_t m_StartVector{ 0 };
+		std::uint64_t m_Cycles{ 0 };
 	};
 
 
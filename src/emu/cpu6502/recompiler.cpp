@@ -0,0 +1,988 @@
+#include "emu/cpu6502/recompiler.h"
+#include "emu/cpu6502/cpu.h"
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h>
+#else
+	#include <sys/mman.h>
+#endif
+
+
+namespace emu
+{
+
+	static_assert(std::is_standard_layout_v<Registers> && std::is_standard_layout_v<JitFrame> && std::is_standard_layout_v<BusPage>);
+	static_assert(sizeof(BusPage) == 32 && offsetof(BusPage, ReadData) == 0 && offsetof(BusPage, WriteData) == 8);
+
+	enum class NativeOperation : std::uint8_t
+	{
+		None,
+		Load,
+		Store,
+		Transfer,
+		Increment,
+		Decrement,
+		SetFlag,
+		ClearFlag,
+		And,
+		Or,
+		Eor,
+		Compare,
+		IncrementMemory,
+		DecrementMemory,
+		Branch,
+		Jump,
+	};
+
+	enum class AddressMode : std::uint8_t
+	{
+		Implied,
+		Immediate,
+		Zeropage,
+		ZeropageX,
+		ZeropageY,
+		Absolute,
+		AbsoluteX,
+		AbsoluteY,
+		IndirectY,
+	};
+
+	// Register is the Registers offset an operation works on, for flag operations and branches the flag
+	// mask. Source is the register a transfer copies from, for branches 1 when taken on a set flag.
+	// Cycles repeat what the interpreter handlers return, including their quirks.
+	struct NativeOpCode
+	{
+		NativeOperation Operation{ NativeOperation::None };
+		AddressMode Mode{ AddressMode::Implied };
+		std::uint8_t Register{ 0 };
+		std::uint8_t Source{ 0 };
+		std::uint8_t Cycles{ 0 };
+	};
+
+	static constexpr auto s_NativeOpCodes = []
+	{
+		using enum NativeOperation;
+		using enum AddressMode;
+
+		constexpr std::uint8_t A = offsetof(Registers, A);
+		constexpr std::uint8_t X = offsetof(Registers, X);
+		constexpr std::uint8_t Y = offsetof(Registers, Y);
+		constexpr std::uint8_t SP = offsetof(Registers, SP);
+
+		std::array<NativeOpCode, 0x100> opCodes{};
+
+		auto set = [&opCodes](std::uint8_t opCode, NativeOperation operation, AddressMode mode, std::uint8_t reg, std::uint8_t cycles, std::uint8_t source = 0)
+		{
+			opCodes[opCode] = NativeOpCode{ operation, mode, reg, source, cycles };
+		};
+
+		set(0xa9, Load, Immediate, A, 2);
+		set(0xa2, Load, Immediate, X, 2);
+		set(0xa0, Load, Immediate, Y, 2);
+		set(0xa5, Load, Zeropage, A, 3);
+		set(0xa6, Load, Zeropage, X, 3);
+		set(0xa4, Load, Zeropage, Y, 3);
+		set(0xb5, Load, ZeropageX, A, 4);
+		set(0xb4, Load, ZeropageX, Y, 4);
+		set(0xb6, Load, ZeropageY, X, 4);
+		set(0xad, Load, Absolute, A, 4);
+		set(0xae, Load, Absolute, X, 4);
+		set(0xac, Load, Absolute, Y, 4);
+		set(0xbd, Load, AbsoluteX, A, 1);
+		set(0xb9, Load, AbsoluteY, A, 1);
+		set(0xbc, Load, AbsoluteX, Y, 1);
+		set(0xbe, Load, AbsoluteY, X, 1);
+		set(0xb1, Load, IndirectY, A, 1);
+
+		set(0x85, Store, Zeropage, A, 3);
+		set(0x86, Store, Zeropage, X, 3);
+		set(0x84, Store, Zeropage, Y, 3);
+		set(0x95, Store, ZeropageX, A, 4);
+		set(0x94, Store, ZeropageX, Y, 4);
+		set(0x96, Store, ZeropageY, X, 4);
+		set(0x8d, Store, Absolute, A, 4);
+		set(0x8e, Store, Absolute, X, 4);
+		set(0x8c, Store, Absolute, Y, 4);
+		set(0x9d, Store, AbsoluteX, A, 5);
+		set(0x99, Store, AbsoluteY, A, 5);
+		set(0x91, Store, IndirectY, A, 6);
+
+		set(0xaa, Transfer, Implied, X, 2, A);
+		set(0xa8, Transfer, Implied, Y, 2, A);
+		set(0x8a, Transfer, Implied, A, 2, X);
+		set(0x98, Transfer, Implied, A, 2, Y);
+		set(0x9a, Transfer, Implied, SP, 2, X);
+
+		set(0xe8, Increment, Implied, X, 2);
+		set(0xc8, Increment, Implied, Y, 2);
+		set(0xca, Decrement, Implied, X, 2);
+		set(0x88, Decrement, Implied, Y, 2);
+
+		set(0x18, ClearFlag, Implied, FlagCarry, 2);
+		set(0x38, SetFlag, Implied, FlagCarry, 2);
+		set(0xd8, ClearFlag, Implied, FlagDecimal, 2);
+		set(0x78, SetFlag, Implied, FlagInterrupt, 2);
+
+		set(0x29, And, Immediate, A, 2);
+		set(0x25, And, Zeropage, A, 3);
+		set(0x2d, And, Absolute, A, 4);
+		set(0x3d, And, AbsoluteX, A, 4);
+		set(0x39, And, AbsoluteY, A, 4);
+		set(0x09, Or, Immediate, A, 2);
+		set(0x05, Or, Zeropage, A, 3);
+		set(0x15, Or, ZeropageX, A, 4);
+		set(0x0d, Or, Absolute, A, 4);
+		set(0x1d, Or, AbsoluteX, A, 4);
+		set(0x19, Or, AbsoluteY, A, 4);
+		set(0x11, Or, IndirectY, A, 6);
+		set(0x49, Eor, Immediate, A, 2);
+		set(0x45, Eor, Zeropage, A, 3);
+
+		set(0xc9, Compare, Immediate, A, 2);
+		set(0xe0, Compare, Immediate, X, 2);
+		set(0xc0, Compare, Immediate, Y, 2);
+		set(0xc5, Compare, Zeropage, A, 3);
+		set(0xd5, Compare, ZeropageX, A, 4);
+		set(0xcd, Compare, Absolute, A, 4);
+		set(0xcc, Compare, Absolute, Y, 4);
+		set(0xdd, Compare, AbsoluteX, A, 4);
+		set(0xd9, Compare, AbsoluteY, A, 4);
+
+		set(0xe6, IncrementMemory, Zeropage, 0, 5);
+		set(0xee, IncrementMemory, Absolute, 0, 6);
+		set(0xc6, DecrementMemory, Zeropage, 0, 5);
+		set(0xd6, DecrementMemory, ZeropageX, 0, 6);
+		set(0xce, DecrementMemory, Absolute, 0, 6);
+		set(0xde, DecrementMemory, AbsoluteX, 0, 7);
+
+		set(0x10, Branch, Implied, FlagNegative, 0, 0);
+		set(0x30, Branch, Implied, FlagNegative, 0, 1);
+		set(0x90, Branch, Implied, FlagCarry, 0, 0);
+		set(0xb0, Branch, Implied, FlagCarry, 0, 1);
+		set(0xd0, Branch, Implied, FlagZero, 0, 0);
+		set(0xf0, Branch, Implied, FlagZero, 0, 1);
+
+		set(0x4c, Jump, Absolute, 0, 3);
+
+		return opCodes;
+	}();
+
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+	enum HostRegister : std::uint8_t
+	{
+		RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+		R8, R9, R10, R11, R12, R13, R14, R15,
+		NoRegister = 0xFF,
+	};
+
+	enum Condition : std::uint8_t
+	{
+		Below = 0x2,
+		AboveOrEqual = 0x3,
+		Equal = 0x4,
+		NotEqual = 0x5,
+		Sign = 0x8,
+	};
+
+	// Integer argument registers of the host calling convention
+#if defined(_WIN32)
+	constexpr std::array<HostRegister, 4> ArgumentRegisters{ RCX, RDX, R8, R9 };
+#else
+	constexpr std::array<HostRegister, 4> ArgumentRegisters{ RDI, RSI, RDX, RCX };
+#endif
+
+	// Pinned while a block runs
+	constexpr HostRegister RegistersBase = RBX;
+	constexpr HostRegister FrameBase = RBP;
+	constexpr HostRegister RAMBase = R12;
+	constexpr HostRegister PagesBase = R13;
+	constexpr HostRegister CycleCount = R14;
+	constexpr HostRegister CycleBudget = R15;
+
+	// Shadow space for Win64 callees plus a spill slot, keeps the stack 16 byte aligned at calls
+	constexpr std::int32_t StackSize = 40;
+	constexpr std::int32_t SpillSlot = 32;
+
+	constexpr std::int32_t OffsetExit = offsetof(JitFrame, Exit);
+	constexpr std::int32_t OffsetPC = offsetof(Registers, PC);
+	constexpr std::int32_t OffsetP = offsetof(Registers, P);
+	constexpr std::int32_t OffsetNZ = offsetof(Registers, NZ);
+
+
+	// Encoder for the handful of x86-64 instructions the block compiler uses, plus the 6502 building
+	// blocks made of them
+	class X64Emitter
+	{
+	public:
+		struct Memory
+		{
+			HostRegister Base{ NoRegister };
+			std::int32_t Displacement{ 0 };
+			HostRegister Index{ NoRegister };
+		};
+
+		using Label = std::size_t;
+
+		auto GetCode() const -> const std::vector<std::uint8_t>& { return m_Code; }
+		auto GetPosition() const -> std::size_t { return m_Code.size(); }
+
+		auto Emit(std::initializer_list<std::uint8_t> bytes) -> void { m_Code.insert(m_Code.end(), bytes); }
+
+		auto Emit16(std::uint16_t value) -> void
+		{
+			Emit({ static_cast<std::uint8_t>(value), static_cast<std::uint8_t>(value >> 8) });
+		}
+
+		auto Emit32(std::uint32_t value) -> void
+		{
+			for (std::uint32_t shift = 0; shift < 32; shift += 8)
+				m_Code.push_back(static_cast<std::uint8_t>(value >> shift));
+		}
+
+		auto Emit64(std::uint64_t value) -> void
+		{
+			Emit32(static_cast<std::uint32_t>(value));
+			Emit32(static_cast<std::uint32_t>(value >> 32));
+		}
+
+		// opCode with reg in the ModRM reg field and a memory operand
+		auto Op(std::initializer_list<std::uint8_t> opCode, std::uint8_t reg, const Memory& memory, bool wide = false) -> void
+		{
+			std::uint8_t rex = (wide ? 0x08 : 0x00) | ((reg & 0x08) >> 1) | ((memory.Base & 0x08) >> 3);
+
+			if (memory.Index != NoRegister)
+				rex |= (memory.Index & 0x08) >> 2;
+
+			if (rex)
+				m_Code.push_back(0x40 | rex);
+
+			Emit(opCode);
+
+			std::uint8_t base = memory.Base & 0x07;
+			bool sib = memory.Index != NoRegister || base == RSP;
+			bool shortDisplacement = memory.Displacement >= -128 && memory.Displacement <= 127;
+			std::uint8_t mod = (memory.Displacement == 0 && base != RBP) ? 0 : shortDisplacement ? 1 : 2;
+
+			m_Code.push_back(static_cast<std::uint8_t>((mod << 6) | ((reg & 0x07) << 3) | (sib ? 0x04 : base)));
+
+			if (sib)
+				m_Code.push_back(static_cast<std::uint8_t>((((memory.Index != NoRegister ? memory.Index : RSP) & 0x07) << 3) | base));
+
+			if (mod == 1)
+				m_Code.push_back(static_cast<std::uint8_t>(memory.Displacement));
+			else if (mod == 2)
+				Emit32(static_cast<std::uint32_t>(memory.Displacement));
+		}
+
+		// opCode with reg in the ModRM reg field and a register operand
+		auto Op(std::initializer_list<std::uint8_t> opCode, std::uint8_t reg, HostRegister rm, bool wide = false) -> void
+		{
+			std::uint8_t rex = (wide ? 0x08 : 0x00) | ((reg & 0x08) >> 1) | ((rm & 0x08) >> 3);
+
+			if (rex)
+				m_Code.push_back(0x40 | rex);
+
+			Emit(opCode);
+			m_Code.push_back(static_cast<std::uint8_t>(0xC0 | ((reg & 0x07) << 3) | (rm & 0x07)));
+		}
+
+		auto LoadByte(HostRegister target, const Memory& memory) -> void { Op({ 0x0F, 0xB6 }, target, memory); }
+		auto StoreByte(const Memory& memory, HostRegister source) -> void { Op({ 0x88 }, source, memory); }
+		auto Load32(HostRegister target, const Memory& memory) -> void { Op({ 0x8B }, target, memory); }
+		auto Store32(const Memory& memory, HostRegister source) -> void { Op({ 0x89 }, source, memory); }
+		auto Load64(HostRegister target, const Memory& memory) -> void { Op({ 0x8B }, target, memory, true); }
+
+		auto StoreWord(const Memory& memory, std::uint16_t value) -> void
+		{
+			Emit({ 0x66 });
+			Op({ 0xC7 }, 0, memory);
+			Emit16(value);
+		}
+
+		auto Store16(const Memory& memory, HostRegister source) -> void
+		{
+			Emit({ 0x66 });
+			Op({ 0x89 }, source, memory);
+		}
+
+		// Byte sized group 1 operation (0 add, 1 or, 4 and, 7 cmp) on memory with an immediate
+		auto ByteImmediate(std::uint8_t operation, const Memory& memory, std::uint8_t value) -> void
+		{
+			Op({ 0x80 }, operation, memory);
+			Emit({ value });
+		}
+
+		auto TestByte(const Memory& memory, std::uint8_t value) -> void
+		{
+			Op({ 0xF6 }, 0, memory);
+			Emit({ value });
+		}
+
+		auto TestWord(const Memory& memory, std::uint16_t value) -> void
+		{
+			Emit({ 0x66 });
+			Op({ 0xF7 }, 0, memory);
+			Emit16(value);
+		}
+
+		auto OrByte(const Memory& memory, HostRegister source) -> void { Op({ 0x08 }, source, memory); }
+
+		// Byte sized operation between registers, opCode is the r/m8, r8 form (00 add, 08 or, 20 and,
+		// 28 sub, 30 xor, 84 test)
+		auto ByteRegister(std::uint8_t opCode, HostRegister target, HostRegister source) -> void { Op({ opCode }, source, target); }
+
+		auto ShiftByte(std::uint8_t operation, HostRegister target, std::uint8_t count) -> void
+		{
+			Op({ 0xC0 }, operation, target);
+			Emit({ count });
+		}
+
+		auto Shift32(std::uint8_t operation, HostRegister target, std::uint8_t count) -> void
+		{
+			Op({ 0xC1 }, operation, target);
+			Emit({ count });
+		}
+
+		auto IncrementByte(HostRegister target) -> void { Op({ 0xFE }, 0, target); }
+		auto DecrementByte(HostRegister target) -> void { Op({ 0xFE }, 1, target); }
+		auto SetCondition(Condition condition, HostRegister target) -> void { Op({ 0x0F, static_cast<std::uint8_t>(0x90 | condition) }, 0, target); }
+
+		auto ZeroExtendByte(HostRegister target, HostRegister source) -> void { Op({ 0x0F, 0xB6 }, target, source); }
+		auto ZeroExtendWord(HostRegister target, HostRegister source) -> void { Op({ 0x0F, 0xB7 }, target, source); }
+		auto Move32(HostRegister target, HostRegister source) -> void { Op({ 0x89 }, source, target); }
+		auto Move64(HostRegister target, HostRegister source) -> void { Op({ 0x89 }, source, target, true); }
+		auto Add32(HostRegister target, HostRegister source) -> void { Op({ 0x01 }, source, target); }
+		auto Or32(HostRegister target, HostRegister source) -> void { Op({ 0x09 }, source, target); }
+		auto Compare32(HostRegister left, HostRegister right) -> void { Op({ 0x39 }, right, left); }
+		auto Test64(HostRegister left, HostRegister right) -> void { Op({ 0x85 }, right, left, true); }
+
+		auto Add32(HostRegister target, std::uint32_t value) -> void
+		{
+			Op({ 0x81 }, 0, target);
+			Emit32(value);
+		}
+
+		auto MoveImmediate32(HostRegister target, std::uint32_t value) -> void
+		{
+			if (target & 0x08)
+				Emit({ 0x41 });
+
+			Emit({ static_cast<std::uint8_t>(0xB8 | (target & 0x07)) });
+			Emit32(value);
+		}
+
+		auto MoveImmediate64(HostRegister target, std::uint64_t value) -> void
+		{
+			Emit({ static_cast<std::uint8_t>(0x48 | ((target & 0x08) >> 3)), static_cast<std::uint8_t>(0xB8 | (target & 0x07)) });
+			Emit64(value);
+		}
+
+		auto Push(HostRegister source) -> void
+		{
+			if (source & 0x08)
+				Emit({ 0x41 });
+
+			Emit({ static_cast<std::uint8_t>(0x50 | (source & 0x07)) });
+		}
+
+		auto Pop(HostRegister target) -> void
+		{
+			if (target & 0x08)
+				Emit({ 0x41 });
+
+			Emit({ static_cast<std::uint8_t>(0x58 | (target & 0x07)) });
+		}
+
+		auto Call(const void* function) -> void
+		{
+			MoveImmediate64(RAX, reinterpret_cast<std::uint64_t>(function));
+			Emit({ 0xFF, 0xD0 });
+		}
+
+		auto Jump(Condition condition) -> Label
+		{
+			Emit({ 0x0F, static_cast<std::uint8_t>(0x80 | condition) });
+			Emit32(0);
+
+			return GetPosition() - 4;
+		}
+
+		auto Jump() -> Label
+		{
+			Emit({ 0xE9 });
+			Emit32(0);
+
+			return GetPosition() - 4;
+		}
+
+		auto JumpBack(std::size_t target) -> void
+		{
+			Emit({ 0xE9 });
+			Emit32(static_cast<std::uint32_t>(target - (GetPosition() + 4)));
+		}
+
+		auto Bind(Label label) -> void
+		{
+			auto displacement = static_cast<std::uint32_t>(GetPosition() - (label + 4));
+			std::memcpy(m_Code.data() + label, &displacement, sizeof(displacement));
+		}
+
+		// 6502 building blocks
+
+		auto Register(std::uint8_t offset) const -> Memory { return { RegistersBase, offset }; }
+		auto Frame(std::int32_t offset) const -> Memory { return { FrameBase, offset }; }
+
+		auto Prologue() -> void
+		{
+			for (auto reg : { RBX, RBP, R12, R13, R14, R15 })
+				Push(reg);
+
+			Emit({ 0x48, 0x83, 0xEC, static_cast<std::uint8_t>(StackSize) });
+
+			Move64(FrameBase, ArgumentRegisters[0]);
+			Load64(RegistersBase, Frame(offsetof(JitFrame, CPURegisters)));
+			Load64(RAMBase, Frame(offsetof(JitFrame, RAM)));
+			Load64(PagesBase, Frame(offsetof(JitFrame, Pages)));
+			Load32(CycleBudget, Frame(offsetof(JitFrame, Budget)));
+			Emit({ 0x45, 0x31, 0xF6 });
+		}
+
+		auto Epilogue() -> void
+		{
+			Store32(Frame(offsetof(JitFrame, Cycles)), CycleCount);
+			Emit({ 0x48, 0x83, 0xC4, static_cast<std::uint8_t>(StackSize) });
+
+			for (auto reg : { R15, R14, R13, R12, RBP, RBX })
+				Pop(reg);
+
+			Emit({ 0xC3 });
+		}
+
+		// Leaves the block at pc when condition holds
+		auto ExitTo(Condition condition, std::uint16_t pc) -> void { m_Exits.emplace_back(Jump(condition), pc); }
+		auto ExitTo(std::uint16_t pc) -> void { m_Exits.emplace_back(Jump(), pc); }
+
+		// Leaves the block with Registers::PC already set by a callout
+		auto Return(Condition condition) -> void { m_Returns.push_back(Jump(condition)); }
+
+		auto AddCycles(std::uint32_t cycles) -> void { Add32(CycleCount, cycles); }
+
+		auto ExitWhenOverBudget(std::uint16_t pc) -> void
+		{
+			Compare32(CycleCount, CycleBudget);
+			ExitTo(AboveOrEqual, pc);
+		}
+
+		auto ExitWhenRequested(std::uint16_t pc) -> void
+		{
+			ByteImmediate(7, Frame(OffsetExit), 0);
+			ExitTo(NotEqual, pc);
+		}
+
+		// N and Z from AL, kept as the result like the interpreter does. Clobbers ECX.
+		auto SetNZ() -> void
+		{
+			ZeroExtendByte(RCX, RAX);
+			Store16(Register(OffsetNZ), RCX);
+		}
+
+		// Tests flag in P or NZ, the returned condition holds when the flag is set
+		auto TestFlag(std::uint8_t flag) -> Condition
+		{
+			switch (flag)
+			{
+			case FlagZero:
+				TestByte(Register(OffsetNZ), 0xFF);
+				return Equal;
+
+			case FlagNegative:
+				TestWord(Register(OffsetNZ), 0x180);
+				return NotEqual;
+
+			default:
+				TestByte(Register(OffsetP), flag);
+				return NotEqual;
+			}
+		}
+
+		// Effective address of mode into EAX. Zero page indexing does not wrap, as in the interpreter.
+		auto Address(AddressMode mode, std::uint16_t operand) -> void
+		{
+			constexpr std::uint8_t X = offsetof(Registers, X);
+			constexpr std::uint8_t Y = offsetof(Registers, Y);
+
+			switch (mode)
+			{
+			case AddressMode::Zeropage:
+				MoveImmediate32(RAX, operand & 0xFF);
+				break;
+
+			case AddressMode::ZeropageX:
+			case AddressMode::ZeropageY:
+				LoadByte(RAX, Register(mode == AddressMode::ZeropageX ? X : Y));
+				Add32(RAX, operand & 0xFF);
+				break;
+
+			case AddressMode::Absolute:
+				MoveImmediate32(RAX, operand);
+				break;
+
+			case AddressMode::AbsoluteX:
+			case AddressMode::AbsoluteY:
+				LoadByte(RAX, Register(mode == AddressMode::AbsoluteX ? X : Y));
+				Add32(RAX, operand);
+				ZeroExtendWord(RAX, RAX);
+				break;
+
+			case AddressMode::IndirectY:
+				LoadByte(RCX, { RAMBase, operand & 0xFF });
+				LoadByte(RAX, { RAMBase, (operand & 0xFF) + 1 });
+				Shift32(4, RAX, 8);
+				Or32(RAX, RCX);
+				LoadByte(RCX, Register(Y));
+				Add32(RAX, RCX);
+				ZeroExtendWord(RAX, RAX);
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		// Operand value of mode into EAX. Internal RAM is read directly, known pages through the page
+		// table and the rest through Recompiler::Read.
+		auto ReadOperand(AddressMode mode, std::uint16_t operand, const void* readCallout) -> void
+		{
+			switch (mode)
+			{
+			case AddressMode::Immediate:
+				MoveImmediate32(RAX, operand & 0xFF);
+				return;
+
+			case AddressMode::Zeropage:
+				LoadByte(RAX, { RAMBase, operand & 0xFF });
+				return;
+
+			case AddressMode::ZeropageX:
+			case AddressMode::ZeropageY:
+				Address(mode, operand);
+				LoadByte(RAX, { RAMBase, 0, RAX });
+				return;
+
+			case AddressMode::Absolute:
+				if (operand < 0x2000)
+				{
+					LoadByte(RAX, { RAMBase, operand & 0x07FF });
+					return;
+				}
+
+				break;
+
+			default:
+				break;
+			}
+
+			Address(mode, operand);
+			ReadBus(readCallout);
+		}
+
+		// Byte at the address in EAX into EAX
+		auto ReadBus(const void* readCallout) -> void
+		{
+			Move32(RCX, RAX);
+			Shift32(5, RCX, 8);
+			Shift32(4, RCX, 5);
+			Load64(RDX, { PagesBase, offsetof(BusPage, ReadData), RCX });
+			Test64(RDX, RDX);
+			auto io = Jump(Equal);
+
+			ZeroExtendByte(RCX, RAX);
+			LoadByte(RAX, { RDX, 0, RCX });
+			auto done = Jump();
+
+			Bind(io);
+			Move32(ArgumentRegisters[1], RAX);
+			Move64(ArgumentRegisters[0], FrameBase);
+			Call(readCallout);
+			ZeroExtendByte(RAX, RAX);
+
+			Bind(done);
+		}
+
+		// Writes CL to the address in EAX. The callout adds DMA cycles and may request an exit.
+		auto WriteBus(const void* writeCallout) -> void
+		{
+			Move32(RDX, RAX);
+			Shift32(5, RDX, 8);
+			Shift32(4, RDX, 5);
+			Load64(R8, { PagesBase, offsetof(BusPage, WriteData), RDX });
+			Test64(R8, R8);
+			auto io = Jump(Equal);
+
+			ZeroExtendByte(RDX, RAX);
+			StoreByte({ R8, 0, RDX }, RCX);
+			auto done = Jump();
+
+			Bind(io);
+			Move32(R10, RAX);
+			Move32(R11, RCX);
+			Move64(ArgumentRegisters[0], FrameBase);
+			Move32(ArgumentRegisters[1], R10);
+			Move32(ArgumentRegisters[2], R11);
+			Call(writeCallout);
+			Add32(CycleCount, RAX);
+
+			Bind(done);
+		}
+
+		auto Interpret(const void* interpretCallout, OpCodeFn execute, std::uint16_t operand, std::uint16_t nextPC) -> void
+		{
+			Move64(ArgumentRegisters[0], FrameBase);
+			MoveImmediate64(ArgumentRegisters[1], reinterpret_cast<std::uint64_t>(execute));
+			MoveImmediate32(ArgumentRegisters[2], operand);
+			MoveImmediate32(ArgumentRegisters[3], nextPC);
+			Call(interpretCallout);
+			Add32(CycleCount, RAX);
+		}
+
+		// Exit stubs and the shared epilogue go behind the block body
+		auto Finish() -> void
+		{
+			for (auto& [label, pc] : m_Exits)
+			{
+				Bind(label);
+				StoreWord(Register(OffsetPC), pc);
+				m_Returns.push_back(Jump());
+			}
+
+			for (auto label : m_Returns)
+				Bind(label);
+
+			Epilogue();
+		}
+
+	private:
+		std::vector<std::uint8_t> m_Code{};
+		std::vector<std::pair<Label, std::uint16_t>> m_Exits{};
+		std::vector<Label> m_Returns{};
+	};
+
+#endif
+
+
+	Recompiler::Recompiler()
+	{
+		if constexpr (!IsSupported())
+			return;
+
+#if defined(_WIN32)
+		m_Arena = static_cast<std::uint8_t*>(VirtualAlloc(nullptr, ArenaSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+#else
+		auto arena = mmap(nullptr, ArenaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		m_Arena = arena == MAP_FAILED ? nullptr : static_cast<std::uint8_t*>(arena);
+#endif
+	}
+
+	Recompiler::~Recompiler()
+	{
+		if (!m_Arena)
+			return;
+
+#if defined(_WIN32)
+		VirtualFree(m_Arena, 0, MEM_RELEASE);
+#else
+		munmap(m_Arena, ArenaSize);
+#endif
+	}
+
+	auto Recompiler::Compile(std::span<const BlockCache::Instruction> instructions, std::uint16_t pc) -> NativeBlock
+	{
+#if defined(__x86_64__) || defined(_M_X64)
+		if (!m_Arena)
+			return nullptr;
+
+		auto readCallout = reinterpret_cast<const void*>(&Recompiler::Read);
+		auto writeCallout = reinterpret_cast<const void*>(&Recompiler::Write);
+		auto interpretCallout = reinterpret_cast<const void*>(&Recompiler::Interpret);
+
+		X64Emitter emitter;
+		emitter.Prologue();
+
+		auto start = emitter.GetPosition();
+		auto blockPC = pc;
+
+		std::uint64_t nativeInstructions{ 0 };
+		bool leftBlock{ false };
+
+		for (auto& instruction : instructions)
+		{
+			auto& native = s_NativeOpCodes[instruction.OpCode];
+			auto operand = instruction.Operand;
+			std::uint16_t nextPC = pc + instruction.Size;
+
+			auto value = emitter.Register(native.Register);
+			bool mayExit{ false };
+
+			switch (native.Operation)
+			{
+			case NativeOperation::Load:
+				emitter.ReadOperand(native.Mode, operand, readCallout);
+				emitter.StoreByte(value, RAX);
+				emitter.SetNZ();
+				break;
+
+			case NativeOperation::Store:
+				emitter.Address(native.Mode, operand);
+				emitter.LoadByte(RCX, value);
+				emitter.WriteBus(writeCallout);
+				mayExit = true;
+				break;
+
+			case NativeOperation::Transfer:
+				emitter.LoadByte(RAX, emitter.Register(native.Source));
+
+				emitter.StoreByte(value, RAX);
+
+				if (native.Register != offsetof(Registers, SP))
+					emitter.SetNZ();
+
+				break;
+
+			case NativeOperation::Increment:
+			case NativeOperation::Decrement:
+				emitter.LoadByte(RAX, value);
+
+				if (native.Operation == NativeOperation::Increment)
+					emitter.IncrementByte(RAX);
+				else
+					emitter.DecrementByte(RAX);
+
+				emitter.StoreByte(value, RAX);
+				emitter.SetNZ();
+				break;
+
+			case NativeOperation::SetFlag:
+				emitter.ByteImmediate(1, emitter.Register(OffsetP), native.Register);
+				break;
+
+			case NativeOperation::ClearFlag:
+				emitter.ByteImmediate(4, emitter.Register(OffsetP), static_cast<std::uint8_t>(~native.Register));
+				break;
+
+			case NativeOperation::And:
+			case NativeOperation::Or:
+			case NativeOperation::Eor:
+				emitter.ReadOperand(native.Mode, operand, readCallout);
+				emitter.Move32(RCX, RAX);
+				emitter.LoadByte(RAX, value);
+				emitter.ByteRegister(native.Operation == NativeOperation::And ? 0x20 : native.Operation == NativeOperation::Or ? 0x08 : 0x30, RAX, RCX);
+				emitter.StoreByte(value, RAX);
+				emitter.SetNZ();
+				break;
+
+			case NativeOperation::Compare:
+				// N and Z from reg - value, C when reg >= value
+				emitter.ReadOperand(native.Mode, operand, readCallout);
+				emitter.Move32(RCX, RAX);
+				emitter.LoadByte(RAX, value);
+				emitter.ByteRegister(0x28, RAX, RCX);
+				emitter.SetCondition(AboveOrEqual, R8);
+				emitter.ByteImmediate(4, emitter.Register(OffsetP), static_cast<std::uint8_t>(~FlagCarry));
+				emitter.OrByte(emitter.Register(OffsetP), R8);
+				emitter.SetNZ();
+				break;
+
+			case NativeOperation::IncrementMemory:
+			case NativeOperation::DecrementMemory:
+				emitter.Address(native.Mode, operand);
+				emitter.Store32({ RSP, SpillSlot }, RAX);
+				emitter.ReadBus(readCallout);
+
+				if (native.Operation == NativeOperation::IncrementMemory)
+					emitter.IncrementByte(RAX);
+				else
+					emitter.DecrementByte(RAX);
+
+				emitter.SetNZ();
+				emitter.ZeroExtendByte(RCX, RAX);
+				emitter.Load32(RAX, { RSP, SpillSlot });
+				emitter.WriteBus(writeCallout);
+				mayExit = true;
+				break;
+
+			case NativeOperation::Branch:
+			{
+				// Cycles only depend on the page of the target, taken or not
+				auto relative = static_cast<std::int8_t>(operand & 0xFF);
+				bool boundaryCrossed = ((nextPC + relative) & 0xFF00) != (nextPC & 0xFF00);
+				std::uint16_t target = nextPC + relative;
+
+				emitter.AddCycles(boundaryCrossed ? 4 : 3);
+				auto set = emitter.TestFlag(native.Register);
+				auto taken = emitter.Jump(native.Source ? set : set == Equal ? NotEqual : Equal);
+				emitter.ExitTo(nextPC);
+				emitter.Bind(taken);
+
+				if (target == blockPC)
+				{
+					emitter.ExitWhenOverBudget(target);
+					emitter.JumpBack(start);
+				}
+				else
+				{
+					emitter.ExitTo(target);
+				}
+
+				break;
+			}
+
+			case NativeOperation::Jump:
+				emitter.AddCycles(native.Cycles);
+
+				if (operand == blockPC)
+				{
+					emitter.ExitWhenOverBudget(operand);
+					emitter.JumpBack(start);
+				}
+				else
+				{
+					emitter.ExitTo(operand);
+				}
+
+				break;
+
+			case NativeOperation::None:
+				// Handlers may read the PC, the callout leaves it at where the instruction went
+				emitter.StoreWord(emitter.Register(OffsetPC), pc);
+				emitter.Interpret(interpretCallout, instruction.Execute, operand, nextPC);
+				emitter.ByteImmediate(7, emitter.Frame(OffsetExit), 0);
+				emitter.Return(NotEqual);
+				emitter.Compare32(CycleCount, CycleBudget);
+				emitter.Return(AboveOrEqual);
+				break;
+			}
+
+			if (native.Operation != NativeOperation::None)
+				nativeInstructions++;
+
+			if (native.Operation == NativeOperation::Branch || native.Operation == NativeOperation::Jump)
+			{
+				leftBlock = true;
+				break;
+			}
+
+			if (native.Operation != NativeOperation::None)
+			{
+				emitter.AddCycles(native.Cycles);
+				emitter.ExitWhenOverBudget(nextPC);
+
+				if (mayExit)
+					emitter.ExitWhenRequested(nextPC);
+			}
+
+			pc = nextPC;
+		}
+
+		// Falling off the end continues at the next instruction
+		if (!leftBlock)
+			emitter.ExitTo(pc);
+
+		emitter.Finish();
+
+		auto& code = emitter.GetCode();
+
+		// Keep the arena 16 byte aligned per block
+		auto size = (code.size() + 15) & ~std::size_t{ 15 };
+
+		if (m_Used + size > ArenaSize)
+			return nullptr;
+
+		Protect(m_Used, size, false);
+		std::memcpy(m_Arena + m_Used, code.data(), code.size());
+		Protect(m_Used, size, true);
+
+		auto block = reinterpret_cast<NativeBlock>(m_Arena + m_Used);
+		m_Used += size;
+
+		m_CompiledBlocks++;
+		m_NativeInstructions += nativeInstructions;
+		m_InterpretedInstructions += instructions.size() - nativeInstructions;
+
+		return block;
+#else
+		return nullptr;
+#endif
+	}
+
+	auto Recompiler::Reset() -> void
+	{
+		m_Used = 0;
+	}
+
+	auto Recompiler::Protect(std::size_t offset, std::size_t size, bool executable) -> void
+	{
+		// Whole pages around the range, other blocks sharing them are not running while this happens
+		constexpr std::size_t PageSize = 0x1000;
+
+		auto first = offset & ~(PageSize - 1);
+		auto last = (offset + size + PageSize - 1) & ~(PageSize - 1);
+
+#if defined(_WIN32)
+		DWORD previous{ 0 };
+		VirtualProtect(m_Arena + first, last - first, executable ? PAGE_EXECUTE_READ : PAGE_READWRITE, &previous);
+
+		if (executable)
+			FlushInstructionCache(GetCurrentProcess(), m_Arena + offset, size);
+#else
+		mprotect(m_Arena + first, last - first, executable ? PROT_READ | PROT_EXEC : PROT_READ | PROT_WRITE);
+#endif
+	}
+
+	auto Recompiler::Read(JitFrame* frame, std::uint32_t address) -> std::uint32_t
+	{
+		return frame->Cpu->m_MemoryManager.ReadBus(static_cast<std::uint16_t>(address));
+	}
+
+	auto Recompiler::Write(JitFrame* frame, std::uint32_t address, std::uint32_t value) -> std::uint32_t
+	{
+		auto& cpu = *frame->Cpu;
+		auto& memoryManager = cpu.m_MemoryManager;
+
+		memoryManager.WriteBus(static_cast<std::uint16_t>(address), static_cast<std::uint8_t>(value));
+
+		if (cpu.InterruptPending() || memoryManager.GetCodeGeneration() != frame->CodeGeneration)
+			frame->Exit = 1;
+
+		return memoryManager.ConsumeDMACycles();
+	}
+
+	auto Recompiler::Interpret(JitFrame* frame, OpCodeFn execute, std::uint32_t operand, std::uint32_t nextPC) -> std::uint32_t
+	{
+		auto& cpu = *frame->Cpu;
+		auto& registers = cpu.m_Registers;
+		auto& memoryManager = cpu.m_MemoryManager;
+
+		cpu.m_Operand = static_cast<std::uint16_t>(operand);
+
+		auto result = execute(cpu);
+		registers.PC += result.Size;
+
+		if (registers.PC != nextPC || cpu.InterruptPending() || memoryManager.GetCodeGeneration() != frame->CodeGeneration)
+			frame->Exit = 1;
+
+		return result.ClockCycles + memoryManager.ConsumeDMACycles();
+	}
+
+
+}
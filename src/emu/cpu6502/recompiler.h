@@ -0,0 +1,94 @@
+#pragma once
+
+#include "emu/cpu6502/blockcache.h"
+#include "emu/memory/memorymanager.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+
+namespace emu
+{
+
+	struct Registers;
+
+	// Everything compiled code needs while it runs, passed in by CPU::RunNative. Cycles comes back as
+	// the cycles the block ran, Exit is raised by the C++ callouts when the block has to be left early.
+	struct JitFrame
+	{
+		CPU* Cpu{ nullptr };
+		Registers* CPURegisters{ nullptr };
+		std::uint8_t* RAM{ nullptr };
+		const BusPage* Pages{ nullptr };
+		std::uint32_t Cycles{ 0 };
+		std::uint32_t Budget{ 0 };
+		std::uint32_t CodeGeneration{ 0 };
+		std::uint8_t Exit{ 0 };
+	};
+
+
+	// Translates hot block cache blocks into x86-64 code. Loads, stores, transfers, logic, compares,
+	// increments and branches are emitted natively, everything else calls its interpreter handler.
+	// RAM is accessed directly, other pages through the bus page table and I/O through MemoryManager.
+	// Compiled code counts cycles and leaves the block at the cycle budget, when an interrupt becomes
+	// pending and when a write changes code, so interrupts and PPU catch up happen as with the
+	// interpreter. Only built for x86-64 hosts, elsewhere Compile always fails.
+	class Recompiler
+	{
+	public:
+		static constexpr std::size_t ArenaSize = 8 << 20;
+		static constexpr std::uint32_t DefaultHotThreshold = 16;
+
+		Recompiler();
+		~Recompiler();
+
+		Recompiler(const Recompiler&) = delete;
+		auto operator=(const Recompiler&) -> Recompiler& = delete;
+
+		static constexpr auto IsSupported() -> bool
+		{
+#if defined(__x86_64__) || defined(_M_X64)
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		// False on other hosts and when the executable arena could not be allocated
+		auto IsAvailable() const -> bool { return m_Arena != nullptr; }
+
+		// Code for a block decoded at pc, nullptr when the arena is full. Reset frees all of it at once,
+		// the caller drops every block pointing into it.
+		auto Compile(std::span<const BlockCache::Instruction> instructions, std::uint16_t pc) -> NativeBlock;
+		auto Reset() -> void;
+
+		// Times a block runs interpreted before it is compiled
+		auto SetHotThreshold(std::uint32_t threshold) -> void { m_HotThreshold = threshold; }
+		auto GetHotThreshold() const -> std::uint32_t { return m_HotThreshold; }
+
+		auto GetCodeSize() const -> std::size_t { return m_Used; }
+		auto GetCompiledBlocks() const -> std::uint64_t { return m_CompiledBlocks; }
+		auto GetNativeInstructions() const -> std::uint64_t { return m_NativeInstructions; }
+		auto GetInterpretedInstructions() const -> std::uint64_t { return m_InterpretedInstructions; }
+
+	private:
+		static auto Read(JitFrame* frame, std::uint32_t address) -> std::uint32_t;
+		static auto Write(JitFrame* frame, std::uint32_t address, std::uint32_t value) -> std::uint32_t;
+		static auto Interpret(JitFrame* frame, OpCodeFn execute, std::uint32_t operand, std::uint32_t nextPC) -> std::uint32_t;
+
+		auto Protect(std::size_t offset, std::size_t size, bool executable) -> void;
+
+	private:
+		std::uint8_t* m_Arena{ nullptr };
+		std::size_t m_Used{ 0 };
+
+		std::uint32_t m_HotThreshold{ DefaultHotThreshold };
+
+		std::uint64_t m_CompiledBlocks{ 0 };
+		std::uint64_t m_NativeInstructions{ 0 };
+		std::uint64_t m_InterpretedInstructions{ 0 };
+	};
+
+
+}
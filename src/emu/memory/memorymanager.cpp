@@ -1,113 +1,270 @@
 #include "emu/memory/memorymanager.h"
 
-#include "emu/cartridge/mapper.h"
-#include "emu/cpu6502/cpu.h"
-#include "input/controller.h"
-
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <mutex>
 #include <print>
-
-#include "imgui.h"
-
+#include <thread>
+#include <variant>
 
 
 namespace emu
 {
 
 
-	static int SelectedMemory{ 0 };
-	static int MemoryPage{ 0 };
+	MemoryManager::MemoryManager(const Cartridge& cartridge, Controller& controller)
+		: m_Cartridge(cartridge), m_Controller(controller)
+	{
+		m_Map = Mapper::CreateMemoryMap(cartridge);
 
-	static std::uint16_t PPUAddress{ 0u };
-	static std::uint16_t OAMAddress{ 0u };
-	static bool RegisterW{ false };
+		if (!m_Map.CharRAM.Data.empty())
+		{
+			m_Map.CharROM.Data = m_Map.CharRAM.Data;
+			m_Map.CharROM.Size = m_Map.CharRAM.Size;
+			m_Map.CharROM.Name = m_Map.CharRAM.Name;
+		}
 
-	static std::uint16_t RegisterV{ 0u };
-	static std::uint16_t RegisterT{ 0u };
-	static std::uint8_t RegisterX{ 0u };
+		SetNametableMirroring(m_Map.Mirroring);
 
-	static std::uint16_t ScrollX{ 0u };
-	static std::uint16_t ScrollY{ 0u };
+		MapPages();
 
-	static std::uint8_t ControllerClock{ 0u };
-	static std::uint8_t PPUDataBuffer{ 0u };
+		m_Board = Mapper::CreateBoard(cartridge);
+		std::visit([this](auto& board) { board.Reset(*this); }, m_Board);
+	}
 
-	static MemoryMap Map;
+	MemoryManager::~MemoryManager()
+	{
 
+	}
 
-	auto ReadController(std::uint8_t controllerID) -> std::uint8_t 
+	static auto ReadOpenBus([[maybe_unused]] MemoryManager& memoryManager, std::uint16_t address) -> std::uint8_t
 	{
-		// TODO: Implement controller ID so that two controllers can be used. Controller 1 is hardcoded.
-		if (controllerID == 1)
-			return 0;
+		return static_cast<std::uint8_t>(address >> 8);
+	}
+
+	static auto WriteIgnored([[maybe_unused]] MemoryManager& memoryManager, [[maybe_unused]] std::uint16_t address, [[maybe_unused]] std::uint8_t value) -> void
+	{
+	}
 
-		auto bits = Controller::GetData();
+	auto MemoryManager::MapPages() -> void
+	{
+		for (auto& page : m_Pages)
+		{
+			page = BusPage{ nullptr, nullptr, ReadOpenBus, WriteIgnored };
+		}
 
-		std::uint8_t value = ((bits >> ControllerClock++) & 0x01);
+		// 0x0000 - 0x1FFF: 2KB internal RAM, mirrored four times
+		for (std::uint16_t page = 0x00; page < 0x20; page++)
+		{
+			auto data = m_Map.CPURAM.Data.data() + (page & 0x07) * 0x100;
+			m_Pages[page].ReadData = data;
+			m_Pages[page].WriteData = data;
+		}
 
-		if (ControllerClock > 7)
-			ControllerClock = 0;
+		// 0x2000 - 0x3FFF: PPU registers, mirrored every 8 bytes
+		for (std::uint16_t page = 0x20; page < 0x40; page++)
+		{
+			m_Pages[page].Read = [](MemoryManager& memoryManager, std::uint16_t address) { return memoryManager.ReadPPUIO(0x2000 + (address & 0x07)); };
+			m_Pages[page].Write = [](MemoryManager& memoryManager, std::uint16_t address, std::uint8_t value) { memoryManager.WritePPUIO(0x2000 + (address & 0x07), value); };
+		}
 
-		return value;
+		// 0x4000 - 0x4017: APU and I/O registers
+		m_Pages[0x40].Read = [](MemoryManager& memoryManager, std::uint16_t address)
+		{
+			return address < 0x4018 ? memoryManager.ReadAPUIO(address) : ReadOpenBus(memoryManager, address);
+		};
+
+		m_Pages[0x40].Write = [](MemoryManager& memoryManager, std::uint16_t address, std::uint8_t value)
+		{
+			if (address < 0x4018)
+				memoryManager.WriteAPUIO(address, value);
+		};
+
+		// 0x6000 - 0x7FFF: cartridge program RAM
+		for (std::uint16_t page = 0x60; page < 0x80; page++)
+		{
+			auto data = m_Map.ProgramRAM.Data.data() + (page - 0x60) * 0x100;
+			m_Pages[page].ReadData = data;
+			m_Pages[page].WriteData = data;
+		}
+
+		// 0x8000 - 0xFFFF: program ROM through the PRG windows set by the board, writes go to its registers
+		for (std::uint16_t page = 0x80; page < 0x100; page++)
+		{
+			m_Pages[page].Write = [](MemoryManager& memoryManager, std::uint16_t address, std::uint8_t value) { memoryManager.WriteMapper(address, value); };
+		}
 	}
 
+	auto MemoryManager::WriteMapper(std::uint16_t address, std::uint8_t value) -> void
+	{
+		std::visit([&](auto& board) { board.WriteRegister(*this, address, value); }, m_Board);
+	}
 
-	MemoryManager::MemoryManager(Cartridge& cartridge)
-		: m_Cartridge(cartridge)
+	auto MemoryManager::SetPRGBank(std::uint8_t window, std::uint32_t bank) -> void
 	{
-		Map = Mapper::CreateMemoryMap(cartridge);
+		auto bankCount = GetPRGBankCount();
+
+		if (bankCount == 0)
+			return;
+
+		window &= 0x03;
+
+		auto data = m_Map.ProgramROM.Data.data() + (bank % bankCount) * PRGBankSize;
+
+		if (m_PRGBanks[window] != data)
+			m_CodeGeneration++;
+
+		m_PRGBanks[window] = data;
+
+		// 32 pages of 256 bytes per window
+		for (std::uint16_t page = 0; page < PRGBankSize / 0x100; page++)
+			m_Pages[0x80 + window * 0x20 + page].ReadData = data + page * 0x100;
 	}
 
-	MemoryManager::~MemoryManager()
+	auto MemoryManager::GetRAMPage(std::uint8_t page) -> std::uint8_t*
+	{
+		if (page < 0x20)
+			return m_Map.CPURAM.Data.data() + (page & 0x07) * 0x100;
+
+		return m_Map.ProgramRAM.Data.data() + (page - 0x60) * 0x100;
+	}
+
+	auto MemoryManager::WatchCodePage(std::uint8_t page) -> void
+	{
+		// Only internal RAM and PRG RAM hold code that can change
+		if (page >= 0x80 || (page >= 0x20 && page < 0x60))
+			return;
+
+		// Internal RAM is watched in all four mirrors
+		auto first = page < 0x20 ? page & 0x07 : page;
+		auto last = page < 0x20 ? 0x1F : page;
+
+		for (auto mirror = first; mirror <= last; mirror += 0x08)
+		{
+			m_Pages[mirror].WriteData = nullptr;
+			m_Pages[mirror].Write = [](MemoryManager& memoryManager, std::uint16_t address, std::uint8_t value) { memoryManager.WriteCodePage(address, value); };
+			m_CodePages[mirror] = true;
+		}
+	}
+
+	auto MemoryManager::WriteCodePage(std::uint16_t address, std::uint8_t value) -> void
+	{
+		InvalidateCode();
+
+		m_Pages[address >> 8].WriteData[address & 0xFF] = value;
+	}
+
+	auto MemoryManager::InvalidateCode() -> void
+	{
+		for (std::uint16_t page = 0; page < m_CodePages.size(); page++)
+		{
+			if (!m_CodePages[page])
+				continue;
+
+			m_Pages[page].WriteData = GetRAMPage(static_cast<std::uint8_t>(page));
+			m_Pages[page].Write = WriteIgnored;
+		}
+
+		m_CodePages.reset();
+
+		m_CodeWrites++;
+		m_CodeGeneration++;
+	}
+
+	auto MemoryManager::SetCHRBank(std::uint8_t window, std::uint32_t bank) -> void
+	{
+		auto bankCount = GetCHRBankCount();
+
+		if (bankCount == 0)
+			return;
+
+		window &= 0x07;
+
+		auto data = m_Map.CharROM.Data.data() + (bank % bankCount) * CHRBankSize;
+
+		if (m_CHRBanks[window] == data)
+			return;
+
+		BeginVRAMWrite();
+
+		m_CHRBanks[window] = data;
+		m_TileCache.SetPatternBank(window, std::span(data, CHRBankSize));
+
+		EndVRAMWrite();
+	}
+
+	auto MemoryManager::ReadController(std::uint8_t controllerID) -> std::uint8_t 
 	{
+		// TODO: Implement controller ID so that two controllers can be used. Controller 1 is hardcoded.
+		if (controllerID == 1)
+			return 0;
+
+		auto bits = m_Controller.GetData();
+
+		std::uint8_t value = ((bits >> m_ControllerClock++) & 0x01);
+
+		if (m_ControllerClock > 7)
+			m_ControllerClock = 0;
 
+		return value;
+	}
+
+	auto MemoryManager::ConsumeDMACycles() -> std::uint16_t
+	{
+		auto cycles = m_DMACycles;
+		m_DMACycles = 0;
+
+		return cycles;
 	}
 
 	auto MemoryManager::ClearPPUIOBit(std::uint16_t address, std::uint8_t bit) -> void
 	{
-		Map.PPUIO.Data.at(address - Map.PPUIO.StartAddress) &= ~bit;
+		m_Map.PPUIO.Data.at(address - m_Map.PPUIO.StartAddress) &= ~bit;
 	}
 
 	auto MemoryManager::GetPPUIOBit(std::uint16_t address) -> std::uint8_t
 	{
-		return Map.PPUIO.Data.at(address - Map.PPUIO.StartAddress);
+		return m_Map.PPUIO.Data.at(address - m_Map.PPUIO.StartAddress);
 	}
 
 	auto MemoryManager::SetPPUIOBit(std::uint16_t address, std::uint8_t bit) -> void
 	{
-		Map.PPUIO.Data.at(address - Map.PPUIO.StartAddress) |= bit;
+		m_Map.PPUIO.Data.at(address - m_Map.PPUIO.StartAddress) |= bit;
 	}
 
 	auto MemoryManager::ReadCharROM(std::uint16_t address) -> std::uint8_t
 	{
-		return Map.CharROM.Data.at(address - Map.CharROM.StartAddress);
+		return m_CHRBanks[(address >> 10) & 0x07][address & 0x3FF];
 	}
 
 	auto MemoryManager::ReadProgramROM(std::uint16_t address) -> std::uint8_t
 	{
-		return Map.ProgramROM.Data.at(address - Map.ProgramROM.StartAddress);
+		return m_PRGBanks[(address >> 13) & 0x03][address & 0x1FFF];
 	}
 
 	auto MemoryManager::ReadAPURAM(std::uint16_t address) -> std::uint8_t
 	{
-		return Map.APURAM.Data.at(address - Map.APURAM.StartAddress);
+		return m_Map.APURAM.Data.at(address - m_Map.APURAM.StartAddress);
 	}
 
 	auto MemoryManager::ReadCPURAM(std::uint16_t address) -> std::uint8_t
 	{
-		return Map.CPURAM.Data.at(address - Map.CPURAM.StartAddress);
+		return m_Map.CPURAM.Data.at(address - m_Map.CPURAM.StartAddress);
 	}
 
 	auto MemoryManager::ReadOAMRAM(std::uint16_t address) -> std::uint8_t
 	{
-		return Map.OAMRAM.Data.at(address - Map.OAMRAM.StartAddress);
+		return m_Map.OAMRAM.Data.at(address - m_Map.OAMRAM.StartAddress);
 	}
 
 	auto MemoryManager::ReadPPURAM(std::uint16_t address) -> std::uint8_t
 	{
-		std::lock_guard<std::mutex> lock(m_PPURAMMutex);
+		if (address >= 0x3F00)
+			return m_Palette.Read(address);
 
-		return Map.PPURAM.Data.at(address - Map.PPURAM.StartAddress);
+		// $3000 - $3EFF mirror the nametables at $2000 - $2EFF
+		return m_Nametables[(address >> 10) & 0x03][address & 0x3FF];
 	}
 	
 	auto MemoryManager::ReadAPUIO(std::uint16_t address) -> std::uint8_t
@@ -115,19 +272,19 @@ namespace emu
 		if (address == 0x4016)
 		{
 			auto value = ReadController(0);
-			Map.APUIO.Data.at(address - Map.APUIO.StartAddress) = value;
-//			Map.APUIO.Data.at(address - Map.APUIO.StartAddress) = Controller::GetData();
+			m_Map.APUIO.Data.at(address - m_Map.APUIO.StartAddress) = value;
+//			m_Map.APUIO.Data.at(address - m_Map.APUIO.StartAddress) = Controller::GetData();
 //			return ReadController(0);
 		}
 
 		if (address == 0x4017)
 		{
 			auto value = ReadController(1);
-			Map.APUIO.Data.at(address - Map.APUIO.StartAddress) = value;
+			m_Map.APUIO.Data.at(address - m_Map.APUIO.StartAddress) = value;
 //			return ReadController(1);
 		}
 
-		return Map.APUIO.Data.at(address - Map.APUIO.StartAddress);
+		return m_Map.APUIO.Data.at(address - m_Map.APUIO.StartAddress);
 	}
 
 	auto MemoryManager::ReadPPUIO(std::uint16_t address) -> std::uint8_t
@@ -136,75 +293,98 @@ namespace emu
 		{
 			if (address == 0x2002)
 			{
-				auto value = Map.PPUIO.Data.at(2);
-				Map.PPUIO.Data.at(2) &= 0x7F;
-				RegisterW = false;
+				auto value = m_Map.PPUIO.Data.at(2);
+				m_Map.PPUIO.Data.at(2) &= 0x7F;
+				m_RegisterW = false;
 
 				return value;
 			}
 
 			if (address == 0x2007)
 			{
-				std::uint8_t value = PPUDataBuffer;
+				std::uint8_t value = m_PPUDataBuffer;
+				std::uint16_t address = m_RegisterV & 0x3FFF;
 
-				if (PPUAddress >= 0x2000)
-					PPUDataBuffer = ReadPPURAM(PPUAddress);
+				if (address >= 0x2000)
+					m_PPUDataBuffer = ReadPPURAM(address);
 				else
-					PPUDataBuffer = ReadCharROM(PPUAddress);
+					m_PPUDataBuffer = ReadCharROM(address);
 
-				PPUAddress += ReadPPUIO(0x2000) & 0x4 ? 32 : 1;
+				m_RegisterV += ReadPPUIO(0x2000) & 0x4 ? 32 : 1;
 
 				return value;
 			}
 		}
 
-		return Map.PPUIO.Data.at(address - Map.PPUIO.StartAddress);
+		return m_Map.PPUIO.Data.at(address - m_Map.PPUIO.StartAddress);
 	}
 
 	auto MemoryManager::WriteAPURAM(std::uint16_t address, std::uint8_t value) -> void
 	{
-		Map.APURAM.Data.at(address - Map.APURAM.StartAddress) = value;
+		m_Map.APURAM.Data.at(address - m_Map.APURAM.StartAddress) = value;
+	}
+
+	auto MemoryManager::WriteCharRAM(std::uint16_t address, std::uint8_t value) -> void
+	{
+		// CHR RAM carts map their windows into CharRAM, the offset is taken from the window pointer
+		auto offset = static_cast<std::size_t>(m_CHRBanks[(address >> 10) & 0x07] - m_Map.CharRAM.Data.data()) + (address & 0x3FF);
+
+		BeginVRAMWrite();
+		m_Map.CharRAM.Data.at(offset) = value;
+		EndVRAMWrite();
+
+		m_TileCache.Invalidate(address / TileCache::BytesPerTile);
 	}
 
 	auto MemoryManager::WriteCPURAM(std::uint16_t address, std::uint8_t value) -> void
 	{
-		Map.CPURAM.Data.at(address - Map.CPURAM.StartAddress) = value;
+		m_Map.CPURAM.Data.at(address - m_Map.CPURAM.StartAddress) = value;
 	}
 
 	auto MemoryManager::WriteOAMRAM(std::uint16_t address, std::uint8_t value) -> void
 	{
-		Map.OAMRAM.Data.at(address - Map.OAMRAM.StartAddress) = value;
+		m_Map.OAMRAM.Data.at(address - m_Map.OAMRAM.StartAddress) = value;
 	}
 
 	auto MemoryManager::WritePPURAM(std::uint16_t address, std::uint8_t value) -> void
 	{
-		std::lock_guard<std::mutex> lock(m_PPURAMMutex);
+		BeginVRAMWrite();
 
-		if (address >= 0x2000 && address < 0x3000)
-		{
-			if (m_Cartridge.GetAttributes().NametableMirroring == 0)
-				Map.PPURAM.Data.at((address + 0x400) - Map.PPURAM.StartAddress) = value;
-			else
-				Map.PPURAM.Data.at((address + 0x800) - Map.PPURAM.StartAddress) = value;
-		}
+		if (address >= 0x3F00)
+			m_Palette.Write(address, value);
+		else
+			m_Nametables[(address >> 10) & 0x03][address & 0x3FF] = value;
 
-		Map.PPURAM.Data.at(address - Map.PPURAM.StartAddress) = value;
+		EndVRAMWrite();
 	}
 
 	auto MemoryManager::WriteAPUIO(std::uint16_t address, std::uint8_t value) -> void
 	{
 		std::lock_guard<std::mutex> lock(m_WriteMutex);
-		Map.APUIO.Data.at(address - Map.APUIO.StartAddress) = value;
+		m_Map.APUIO.Data.at(address - m_Map.APUIO.StartAddress) = value;
+
+		// Check for OAM DMA write
+		if (address == 0x4014)
+		{
+			DMATransfer(MemoryOwner::PPU, value);
+			m_DMACycles = 514;
+		}
+
+		if (address == 0x4015)
+		{
+			DMATransfer(MemoryOwner::ASU, value);
+			m_DMACycles = 4;
+		}
 
 		if (address == 0x4016)
 		{
 			if (value & 0x1)
 			{
-				Controller::LatchData();
+				m_Controller.LatchData();
 			}
 			else if (value == 0)
 			{
-				ControllerClock = 0;
+				m_ControllerClock = 0;
 			}
 		}
 	}
@@ -215,34 +395,43 @@ namespace emu
 		{
 			case 0x2000:
 			{
-				RegisterT &= 0xF3;
-				RegisterT |= (value & 0x3) << 10;
+				m_RegisterT &= ~0x0C00;
+				m_RegisterT |= (value & 0x03) << 10;
 
 				// Check for Vblank NMI and Vblank status is 1
-				if ((value & 0x80) && (Map.PPUIO.Data.at(2) & 0x80))
+				if ((value & 0x80) && (m_Map.PPUIO.Data.at(2) & 0x80))
 				{
-					CPU::TriggerNMI();
+					TriggerNMI();
 				}
 
 				break;
 			}
 
+			case 0x2001:
+			{
+				BeginVRAMWrite();
+				m_Palette.SetMask(value);
+				EndVRAMWrite();
+
+				break;
+			}
+
 			case 0x2002:
 			{
-				RegisterW = false;
+				m_RegisterW = false;
 				break;
 			}
 
 			case 0x2003:
 			{
-				OAMAddress = value & 0x00FF;
+				m_OAMAddress = value & 0x00FF;
 				break;
 			}
 
 			case 0x2004:
 			{
-				WriteOAMRAM(OAMAddress, value);
-				OAMAddress++;
+				WriteOAMRAM(m_OAMAddress, value);
+				m_OAMAddress++;
 
 				break;
 			}
@@ -252,74 +441,79 @@ namespace emu
 //				if (value != 0)
 //					__debugbreak();
 
-//				if (value == 0 && !RegisterW)
+//				if (value == 0 && !m_RegisterW)
 //					break;
 
 //				std::println("Scroll:: {}", value);
 
-				if (!RegisterW)
+				if (!m_RegisterW)
 				{
-					ScrollX = value;
-
-					RegisterT &= 0xE0;
-					RegisterT |= (value & 0xF8) >> 3;
-					RegisterX = value & 0x07;
+					m_RegisterT &= ~0x001F;
+					m_RegisterT |= (value & 0xF8) >> 3;
+					m_RegisterX = value & 0x07;
 				}
 				else
 				{
-					ScrollY = value;
-
-					RegisterT &= 0x0C1F;
-					RegisterT |= (value & 0xF8) << 2;
-					RegisterT |= (value & 0x03) << 13;
+					m_RegisterT &= 0x0C1F;
+					m_RegisterT |= (value & 0xF8) << 2;
+					m_RegisterT |= (value & 0x07) << 12;
 				}
 
-				RegisterW = !RegisterW;
+				m_RegisterW = !m_RegisterW;
 
 				break;
 			}
 
 			case 0x2006:
 			{
-				if (!RegisterW)
+				if (!m_RegisterW)
 				{
-					PPUAddress = ((value & 0x3F) << 8) & 0xFF00;
-
-					RegisterT &= 0x7FFF;
+					m_RegisterT &= 0x00FF;
+					m_RegisterT |= (value & 0x3F) << 8;
 				}
 				else
 				{
-					PPUAddress += value;
-	
-					if (PPUAddress > 0x2000)
-						PPUDataBuffer = ReadPPURAM(PPUAddress);
-					else
-						PPUDataBuffer = 0;
+					m_RegisterT &= 0xFF00;
+					m_RegisterT |= value;
 
-					RegisterV = RegisterT;
+					m_RegisterV = m_RegisterT;
+
+					if (m_RegisterV > 0x2000)
+						m_PPUDataBuffer = ReadPPURAM(m_RegisterV);
+					else
+						m_PPUDataBuffer = 0;
 				}
 
-				RegisterW = !RegisterW;
+				m_RegisterW = !m_RegisterW;
 
 				break;
 			}
 
 			case 0x2007:
 			{
-				if (PPUAddress < 0x2000 && PPUAddress >= 0x0100)
+				std::uint16_t address = m_RegisterV & 0x3FFF;
+
+				if (address < 0x2000)
 				{
-					std::println("Invalid PPUAddress for write: {:04x}", PPUAddress);
-					return;
-				}
+					if (m_Map.CharRAM.Data.empty())
+					{
+						std::println("Invalid PPUAddress for write: {:04x}", address);
+						return;
+					}
 
-				WritePPURAM(PPUAddress, value);
-				PPUAddress += ReadPPUIO(0x2000) & 0x4 ? 32 : 1;
+					WriteCharRAM(address, value);
+				}
+				else
+				{
+					WritePPURAM(address, value);
+				}
+				m_RegisterV += ReadPPUIO(0x2000) & 0x4 ? 32 : 1;
 
 				break;
 			}
 		}
 
-		Map.PPUIO.Data.at(address - Map.PPUIO.StartAddress) = value;
+		m_Map.PPUIO.Data.at(address - m_Map.PPUIO.StartAddress) = value;
 	}
 
 	auto MemoryManager::DMATransfer(MemoryOwner targetOwner, std::uint8_t value) -> void
@@ -336,7 +530,7 @@ namespace emu
 			for (auto i = 0; i < length; i++)
 			{
 				// Write via PPUDATA
-				WriteOAMRAM(i, ReadCPURAM(address + i));
+				WriteOAMRAM(i, ReadBus(address + i));
 			}
 		}
 		else if (targetOwner == MemoryOwner::ASU)
@@ -346,104 +540,273 @@ namespace emu
 
 	}
 
-	auto MemoryManager::GetScrollXRegister() const -> const std::uint16_t
+	auto MemoryManager::ReadNametableRow(std::uint8_t nametable, std::uint8_t row, std::span<std::uint8_t, 32> tiles) const -> void
 	{
-		return ScrollX;
+		auto data = GetNametable(nametable).subspan((row & 0x1F) * 32, 32);
+
+		std::ranges::copy(data, tiles.begin());
 	}
 
-	auto MemoryManager::GetScrollYRegister() const -> const std::uint16_t
+	auto MemoryManager::GetNametable(std::uint8_t nametable) const -> std::span<const std::uint8_t, 0x400>
 	{
-		return ScrollY;
+		return std::span<const std::uint8_t, 0x400>(m_Nametables[nametable & 0x03], 0x400);
 	}
 
-	auto MemoryManager::GetVRegister() const -> const std::uint16_t
+	auto MemoryManager::GetAttributeTable(std::uint8_t nametable) const -> std::span<const std::uint8_t, 64>
 	{
-		return RegisterV;
+		return GetNametable(nametable).subspan<0x3C0, 64>();
 	}
 
-	auto MemoryManager::GetTRegister() const -> const std::uint16_t
+	auto MemoryManager::GetPatternBank(std::uint8_t window) const -> std::span<const std::uint8_t>
 	{
-		return RegisterT;
+		return std::span(m_CHRBanks[window & 0x07], CHRBankSize);
 	}
 
-	auto MemoryManager::GetXRegister() const -> const std::uint8_t
+	auto MemoryManager::SetNametableMirroring(NametableMirroring mirroring) -> void
 	{
-		return RegisterX;
-	}
+		// 1KB page of nametable RAM for $2000, $2400, $2800 and $2C00
+		std::array<std::uint8_t, 4> pages{};
+
+		switch (mirroring)
+		{
+			case NametableMirroring::Horizontal: pages = { 0, 0, 1, 1 }; break;
+			case NametableMirroring::Vertical: pages = { 0, 1, 0, 1 }; break;
+			case NametableMirroring::SingleScreenLower: pages = { 0, 0, 0, 0 }; break;
+			case NametableMirroring::SingleScreenUpper: pages = { 1, 1, 1, 1 }; break;
+			case NametableMirroring::FourScreen: pages = { 0, 1, 2, 3 }; break;
+		}
 
+		// Four-screen needs the cartridge RAM behind CIRAM, without it the pages wrap into CIRAM
+		auto pageCount = m_Map.NametableRAM.Data.size() / 0x400;
 
-	auto ViewPage(std::span<std::uint8_t> memory, std::uint16_t address)
-	{
-		auto startAddress = MemoryPage * 0x100;
+		BeginVRAMWrite();
+
+		m_Mirroring = mirroring;
 
-		std::uint16_t count{ 0 };
+		for (std::size_t nametable = 0; nametable < m_Nametables.size(); nametable++)
+			m_Nametables[nametable] = m_Map.NametableRAM.Data.data() + (pages[nametable] % pageCount) * 0x400;
 
-		for (auto row = 0; row < 16; row++)
+		EndVRAMWrite();
+	}
+
+	auto MemoryManager::SnapshotVRAM(VRAMSnapshot& snapshot) const -> void
+	{
+		// Seqlock read. The copies race with the emulation thread's plain stores, which is deliberate:
+		// VRAM is written byte by byte on the hot path and making every store atomic would cost the
+		// emulation thread far more than a retried copy. A torn copy is never used, the sequence check
+		// throws it away. Bank and nametable pointers always point into live memory, even mid-switch.
+		while (true)
 		{
-			std::string str = std::format("{:04x} : ", row * 16 + startAddress + address);
+			auto sequence = m_VRAMSequence.load(std::memory_order_acquire);
 
-			for (auto col = 0; col < 16; col++)
+			if (!(sequence & 1))
 			{
-				if ((row * 16 + startAddress + col) < memory.size())
-					str += std::format("{:02x} ", memory[row * 16 + startAddress + col]);
+				for (std::uint8_t window = 0; window < m_CHRBanks.size(); window++)
+				{
+					if (m_CHRBanks[window])
+						std::memcpy(&snapshot.PatternTables[window * CHRBankSize], m_CHRBanks[window], CHRBankSize);
+				}
+				for (std::uint8_t nametable = 0; nametable < 4; nametable++)
+					std::memcpy(&snapshot.Nametables[nametable * 0x400], m_Nametables[nametable], 0x400);
+				std::ranges::copy(m_Palette.GetEntries(), snapshot.PaletteEntries.begin());
+				std::ranges::copy(m_Palette.GetColors(), snapshot.PaletteColors.begin());
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+
+				if (m_VRAMSequence.load(std::memory_order_relaxed) == sequence)
+					return;
 			}
 
-			ImGui::Text("%s", str.c_str());
+			// The emulation thread is mid-write, give it the core instead of spinning against it
+			std::this_thread::yield();
 		}
 	}
 
-	auto DrawMemory(Memory& memory) -> void
+	auto MemoryManager::BeginVRAMWrite() -> void
 	{
-		// Chunk info block
-		{
-			ImGui::Text("Start address: %04x", memory.StartAddress);
-			ImGui::Text("Length: %04x", memory.Size);
+		m_VRAMSequence.store(m_VRAMSequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	auto MemoryManager::EndVRAMWrite() -> void
+	{
+		m_VRAMSequence.store(m_VRAMSequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
 
-			ImGui::Separator();
+	auto MemoryManager::TriggerNMI() -> void
+	{
+		m_NMI.store(true, std::memory_order_release);
+	}
 
-			ImGui::Text("%s", memory.Name.c_str());
+	auto MemoryManager::IsNMIPending() const -> bool
+	{
+		return m_NMI.load(std::memory_order_acquire);
+	}
 
-			ImGui::Separator();
+	auto MemoryManager::ClearNMI() -> void
+	{
+		m_NMI.store(false, std::memory_order_release);
+	}
 
-			if (ImGui::InputInt("Page", &MemoryPage))
+	auto MemoryManager::SetIRQLine(IRQSource source, bool asserted) -> void
+	{
+		if (asserted)
+			m_IRQLines |= static_cast<std::uint8_t>(source);
+		else
+			m_IRQLines &= ~static_cast<std::uint8_t>(source);
+	}
+
+	auto MemoryManager::ClockA12(std::uint32_t risingEdges) -> void
+	{
+		// Only boards with a scanline counter listen to A12
+		std::visit([&](auto& board)
+		{
+			if constexpr (requires { board.ClockA12(*this); })
 			{
-				if (MemoryPage < 0 || memory.Size <= 0x100) MemoryPage = 0;
-				if (MemoryPage > ((memory.Size / 256) - 1) && memory.Size > 0x100) MemoryPage = (memory.Size / 256) - 1;
+				for (std::uint32_t edge = 0; edge < risingEdges; edge++)
+					board.ClockA12(*this);
 			}
+		}, m_Board);
+	}
 
-			ImGui::Separator();
+	auto MemoryManager::SaveState(MemoryState& state) const -> void
+	{
+		auto save = [](const Memory& memory, std::span<std::uint8_t> block)
+		{
+			std::memcpy(block.data(), memory.Data.data(), std::min(memory.Data.size(), block.size()));
+		};
 
-			ViewPage(memory.Data, memory.StartAddress);
-		}
+		save(m_Map.CPURAM, state.CPURAM);
+		save(m_Map.ProgramRAM, state.ProgramRAM);
+		save(m_Map.CharRAM, state.CharRAM);
+		save(m_Map.NametableRAM, state.NametableRAM);
+		save(m_Map.OAMRAM, state.OAMRAM);
+		save(m_Map.APURAM, state.APURAM);
+		save(m_Map.PPUIO, state.PPUIO);
+		save(m_Map.APUIO, state.APUIO);
+
+		std::ranges::copy(m_Palette.GetEntries(), state.PaletteEntries.begin());
+
+		state.RegisterV = m_RegisterV;
+		state.RegisterT = m_RegisterT;
+		state.RegisterX = m_RegisterX;
+		state.RegisterW = m_RegisterW;
+		state.PPUDataBuffer = m_PPUDataBuffer;
+		state.OAMAddress = m_OAMAddress;
+
+		state.ControllerClock = m_ControllerClock;
+		state.ControllerLatch = m_Controller.GetData();
+
+		state.NMI = IsNMIPending();
+		state.IRQLines = m_IRQLines;
+		state.DMACycles = m_DMACycles;
+
+		// Windows point into the cartridge data, they are saved as bank numbers
+		state.Mirroring = m_Mirroring;
+
+		for (std::size_t window = 0; window < m_PRGBanks.size(); window++)
+			state.PRGBanks[window] = m_PRGBanks[window] ? static_cast<std::uint32_t>((m_PRGBanks[window] - m_Map.ProgramROM.Data.data()) / PRGBankSize) : 0;
 
+		for (std::size_t window = 0; window < m_CHRBanks.size(); window++)
+			state.CHRBanks[window] = m_CHRBanks[window] ? static_cast<std::uint32_t>((m_CHRBanks[window] - m_Map.CharROM.Data.data()) / CHRBankSize) : 0;
+
+		std::visit([&](const auto& board)
+		{
+			state.Board.MapperNumber = board.Number;
+
+			if constexpr (requires { board.SaveState(state.Board); })
+				board.SaveState(state.Board);
+		}, m_Board);
 	}
 
-	auto MemoryManager::ViewMemory() -> void
+	auto MemoryManager::LoadState(const MemoryState& state) -> bool
 	{
-		ImGui::Begin("Memory");
+		if (state.Board.MapperNumber != std::visit([](const auto& board) { return board.Number; }, m_Board))
+			return false;
 
-		if (ImGui::InputInt("Memory", &SelectedMemory))
+		auto load = [](Memory& memory, std::span<const std::uint8_t> block)
 		{
-			if (SelectedMemory < 0) SelectedMemory = 0;
-			if (SelectedMemory >= 7) SelectedMemory = 7;
-		}
+			std::memcpy(memory.Data.data(), block.data(), std::min(memory.Data.size(), block.size()));
+		};
+
+		load(m_Map.CPURAM, state.CPURAM);
+		load(m_Map.ProgramRAM, state.ProgramRAM);
+		load(m_Map.OAMRAM, state.OAMRAM);
+		load(m_Map.APURAM, state.APURAM);
+		load(m_Map.APUIO, state.APUIO);
+
+		// RAM changed behind the bus, decoded code from it is stale
+		InvalidateCode();
+
+		BeginVRAMWrite();
+
+		load(m_Map.CharRAM, state.CharRAM);
+		load(m_Map.NametableRAM, state.NametableRAM);
+		load(m_Map.PPUIO, state.PPUIO);
+
+		m_Palette.SetMask(state.PPUIO[1]);
+		m_Palette.SetEntries(state.PaletteEntries);
+
+		EndVRAMWrite();
+
+		m_RegisterV = state.RegisterV;
+		m_RegisterT = state.RegisterT;
+		m_RegisterX = state.RegisterX;
+		m_RegisterW = state.RegisterW;
+		m_PPUDataBuffer = state.PPUDataBuffer;
+		m_OAMAddress = state.OAMAddress;
+
+		m_ControllerClock = state.ControllerClock;
+		m_Controller.SetData(state.ControllerLatch);
 
-		switch (SelectedMemory)
+		m_NMI.store(state.NMI, std::memory_order_release);
+		m_IRQLines = state.IRQLines;
+		m_DMACycles = state.DMACycles;
+
+		std::visit([&](auto& board)
 		{
-			case 0: DrawMemory(Map.ProgramROM); break;
-			case 1: DrawMemory(Map.CharROM); break;
-			case 2: DrawMemory(Map.PPUIO); break;
-			case 3: DrawMemory(Map.APUIO); break;
-			case 4: DrawMemory(Map.APURAM); break;
-			case 5: DrawMemory(Map.PPURAM); break;
-			case 6: DrawMemory(Map.CPURAM); break;
-			case 7: DrawMemory(Map.OAMRAM); break;
-
-			default:
-				DrawMemory(Map.CPURAM); break;
-		}
+			if constexpr (requires { board.LoadState(state.Board); })
+				board.LoadState(state.Board);
+		}, m_Board);
+
+		SetNametableMirroring(state.Mirroring);
+
+		for (std::uint8_t window = 0; window < m_PRGBanks.size(); window++)
+			SetPRGBank(window, state.PRGBanks[window]);
+
+		for (std::uint8_t window = 0; window < m_CHRBanks.size(); window++)
+			SetCHRBank(window, state.CHRBanks[window]);
+
+		// CHR RAM may hold other tiles behind unchanged bank pointers
+		if (!m_Map.CharRAM.Data.empty())
+			m_TileCache.InvalidateAll();
+
+		return true;
+	}
+
+	auto MemoryManager::GetMemoryMap() -> MemoryMap&
+	{
+		return m_Map;
+	}
+
+	auto MemoryManager::GetVRegister() const -> const std::uint16_t
+	{
+		return m_RegisterV;
+	}
+
+	auto MemoryManager::SetVRegister(std::uint16_t value) -> void
+	{
+		m_RegisterV = value & 0x7FFF;
+	}
 
-		ImGui::End();
+	auto MemoryManager::GetTRegister() const -> const std::uint16_t
+	{
+		return m_RegisterT;
+	}
+
+	auto MemoryManager::GetXRegister() const -> const std::uint8_t
+	{
+		return m_RegisterX;
 	}
 
 }
@@ -1,9 +1,17 @@
 #pragma once
 
 #include "emu/cartridge/cartridge.h"
+#include "emu/cartridge/mapper.h"
 #include "emu/memory/ram.h"
 #include "emu/memory/rom.h"
-
+#include "emu/ppu/palette.h"
+#include "emu/ppu/tilecache.h"
+#include "emu/system/savestate.h"
+#include "input/controller.h"
+
+#include <array>
+#include <atomic>
+#include <bitset>
 #include <cstdint>
 #include <memory>
 #include <mutex>
@@ -24,13 +32,82 @@ namespace emu
 		Cartridge,
 	};
 
+	// Devices that can hold the CPU IRQ line low, the line stays asserted while any source is set
+	enum class IRQSource : std::uint8_t
+	{
+		Mapper = 0x01,
+	};
+
+
+	class MemoryManager;
+
+	using IOReadFn = auto (*)(MemoryManager&, std::uint16_t) -> std::uint8_t;
+	using IOWriteFn = auto (*)(MemoryManager&, std::uint16_t, std::uint8_t) -> void;
+
+	// One entry per 256 byte page of the CPU address space. Plain RAM/ROM pages point straight
+	// into host memory, pages without a data pointer are routed to the I/O handlers.
+	struct BusPage
+	{
+		const std::uint8_t* ReadData{ nullptr };
+		std::uint8_t* WriteData{ nullptr };
+
+		IOReadFn Read{ nullptr };
+		IOWriteFn Write{ nullptr };
+	};
+
+
+	// Copy of everything the PPU reads for rendering, taken consistently by SnapshotVRAM
+	struct VRAMSnapshot
+	{
+		std::array<std::uint8_t, 0x2000> PatternTables{};
+		std::array<std::uint8_t, 0x1000> Nametables{};
+		std::array<std::uint8_t, Palette::EntryCount> PaletteEntries{};
+		std::array<std::uint32_t, Palette::EntryCount> PaletteColors{};
+	};
+
 
 	class MemoryManager
 	{
 	public:
-		explicit MemoryManager(Cartridge& cartridge);
+		static constexpr std::uint32_t PRGBankSize = 0x2000;
+		static constexpr std::uint32_t CHRBankSize = 0x400;
+
+		explicit MemoryManager(const Cartridge& cartridge, Controller& controller);
 		~MemoryManager();
 
+		inline auto ReadBus(std::uint16_t address) -> std::uint8_t
+		{
+			auto& page = m_Pages[address >> 8];
+
+			if (page.ReadData) [[likely]]
+				return page.ReadData[address & 0xFF];
+
+			return page.Read(*this, address);
+		}
+
+		inline auto WriteBus(std::uint16_t address, std::uint8_t value) -> void
+		{
+			auto& page = m_Pages[address >> 8];
+
+			if (page.WriteData) [[likely]]
+			{
+				page.WriteData[address & 0xFF] = value;
+				return;
+			}
+
+			page.Write(*this, address, value);
+		}
+
+		// Reads without touching I/O, those pages read as open bus. Used to decode instructions ahead.
+		inline auto PeekBus(std::uint16_t address) const -> std::uint8_t
+		{
+			auto& page = m_Pages[address >> 8];
+
+			return page.ReadData ? page.ReadData[address & 0xFF] : static_cast<std::uint8_t>(address >> 8);
+		}
+
+		auto ConsumeDMACycles() -> std::uint16_t;
+
 		auto ReadCharROM(std::uint16_t address) -> std::uint8_t;
 		auto ReadProgramROM(std::uint16_t address) -> std::uint8_t;
 
@@ -43,6 +120,7 @@ namespace emu
 		auto ReadPPUIO(std::uint16_t address) -> std::uint8_t;
 
 		auto WriteAPURAM(std::uint16_t address, std::uint8_t value) -> void;
+		auto WriteCharRAM(std::uint16_t address, std::uint8_t value) -> void;
 		auto WriteCPURAM(std::uint16_t address, std::uint8_t value) -> void;
 		auto WriteOAMRAM(std::uint16_t address, std::uint8_t value) -> void;
 		auto WritePPURAM(std::uint16_t address, std::uint8_t value) -> void;
@@ -56,19 +134,120 @@ namespace emu
 
 		auto DMATransfer(MemoryOwner targetOwner, std::uint8_t value) -> void;
 
-		auto GetScrollXRegister() const -> const std::uint16_t;
-		auto GetScrollYRegister() const -> const std::uint16_t;
-
+		// Bulk VRAM access. The views are live and meant for the emulation thread, which is the only
+		// writer. Other threads copy what they need with SnapshotVRAM. Nametables are 0 - 3 as
+		// addressed by the PPU, each 960 tile bytes followed by its 64 byte attribute table.
+		auto ReadNametableRow(std::uint8_t nametable, std::uint8_t row, std::span<std::uint8_t, 32> tiles) const -> void;
+		auto GetNametable(std::uint8_t nametable) const -> std::span<const std::uint8_t, 0x400>;
+		auto GetAttributeTable(std::uint8_t nametable) const -> std::span<const std::uint8_t, 64>;
+		auto GetPatternBank(std::uint8_t window) const -> std::span<const std::uint8_t>;
+		auto GetPaletteRAM() const -> std::span<const std::uint8_t, Palette::EntryCount> { return m_Palette.GetEntries(); }
+
+		// Safe from any thread, retries while the emulation thread is in the middle of a VRAM write
+		auto SnapshotVRAM(VRAMSnapshot& snapshot) const -> void;
+
+		// Bank windows: four 8KB PRG windows at $8000 - $FFFF and eight 1KB CHR windows at $0000 - $1FFF.
+		// Bank numbers wrap at the size of the cartridge data, switching only moves pointers.
+		auto SetPRGBank(std::uint8_t window, std::uint32_t bank) -> void;
+		auto SetCHRBank(std::uint8_t window, std::uint32_t bank) -> void;
+		auto GetPRGBankData(std::uint8_t window) const -> const std::uint8_t* { return m_PRGBanks[window & 0x03]; }
+		auto GetPRGBankCount() const -> std::uint32_t { return static_cast<std::uint32_t>(m_Map.ProgramROM.Data.size() / PRGBankSize); }
+		auto GetCHRBankCount() const -> std::uint32_t { return static_cast<std::uint32_t>(m_Map.CharROM.Data.size() / CHRBankSize); }
+
+		// Points the four nametables into nametable RAM, mappers may change it at any time
+		auto SetNametableMirroring(NametableMirroring mirroring) -> void;
+		auto GetNametableMirroring() const -> NametableMirroring { return m_Mirroring; }
+
+		// Loopy registers: V is the current VRAM address and scroll position, T the one latched for the
+		// next line/frame, X the fine horizontal scroll
 		auto GetVRegister() const -> const std::uint16_t;
+		auto SetVRegister(std::uint16_t value) -> void;
 		auto GetTRegister() const -> const std::uint16_t;
 		auto GetXRegister() const -> const std::uint8_t;
 
-		auto ViewMemory() -> void;
+		// Safe from any thread, the frontend's debug button raises NMI from the UI thread
+		auto TriggerNMI() -> void;
+		auto IsNMIPending() const -> bool;
+		auto ClearNMI() -> void;
+
+		// Level triggered, the source keeps the line asserted until its device acknowledges it
+		auto SetIRQLine(IRQSource source, bool asserted) -> void;
+		auto IsIRQAsserted() const -> bool { return m_IRQLines != 0; }
+
+		// PPU A12 rising edges, reported by the renderer once per scanline instead of per pattern fetch
+		auto ClockA12(std::uint32_t risingEdges) -> void;
+
+		// Decoded code tracking. A watched RAM page (with its mirrors) takes the slow write path, the first
+		// write to it drops every watch and counts as a code write. The code generation also moves when a
+		// PRG window is switched to another bank.
+		auto WatchCodePage(std::uint8_t page) -> void;
+		auto GetCodeWrites() const -> std::uint32_t { return m_CodeWrites; }
+		auto GetCodeGeneration() const -> std::uint32_t { return m_CodeGeneration; }
+
+		// Page table as ReadBus and WriteBus see it, for compiled code doing the same lookup
+		auto GetBusPages() const -> const BusPage* { return m_Pages.data(); }
+
+		// RAM, PPU latches, controller and mapper board. A state taken with another board is rejected
+		// and leaves the machine untouched.
+		auto SaveState(MemoryState& state) const -> void;
+		auto LoadState(const MemoryState& state) -> bool;
+
+		auto GetMemoryMap() -> MemoryMap&;
+		auto GetPalette() -> Palette& { return m_Palette; }
+		auto GetTileCache() -> TileCache& { return m_TileCache; }
+
+	private:
+		auto MapPages() -> void;
+
+		auto ReadController(std::uint8_t controllerID) -> std::uint8_t;
+
+		auto WriteMapper(std::uint16_t address, std::uint8_t value) -> void;
+
+		auto GetRAMPage(std::uint8_t page) -> std::uint8_t*;
+		auto WriteCodePage(std::uint16_t address, std::uint8_t value) -> void;
+		auto InvalidateCode() -> void;
+
+		// Seqlock around VRAM writes, the sequence is odd while a write is in progress
+		auto BeginVRAMWrite() -> void;
+		auto EndVRAMWrite() -> void;
 
 	private:
-		Cartridge& m_Cartridge;
+		const Cartridge& m_Cartridge;
+		Controller& m_Controller;
+
+		MemoryMap m_Map;
+		Palette m_Palette;
+		TileCache m_TileCache;
+
+		MapperBoard m_Board{};
+
+		std::array<const std::uint8_t*, 4> m_PRGBanks{};
+		std::array<const std::uint8_t*, 8> m_CHRBanks{};
+
+		NametableMirroring m_Mirroring{ NametableMirroring::Horizontal };
+		std::array<std::uint8_t*, 4> m_Nametables{};
+
+		std::uint16_t m_OAMAddress{ 0u };
+		bool m_RegisterW{ false };
+
+		std::uint16_t m_RegisterV{ 0u };
+		std::uint16_t m_RegisterT{ 0u };
+		std::uint8_t m_RegisterX{ 0u };
+
+		std::uint8_t m_ControllerClock{ 0u };
+		std::uint8_t m_PPUDataBuffer{ 0u };
+
+		std::atomic<bool> m_NMI{ false };
+		std::uint8_t m_IRQLines{ 0 };
+
+		std::array<BusPage, 0x100> m_Pages{};
+		std::uint16_t m_DMACycles{ 0 };
+
+		std::bitset<0x100> m_CodePages{};
+		std::uint32_t m_CodeWrites{ 0 };
+		std::uint32_t m_CodeGeneration{ 0 };
 		
-		std::mutex m_PPURAMMutex;
+		std::atomic<std::uint32_t> m_VRAMSequence{ 0 };
 		std::mutex m_WriteMutex;
 	};
 
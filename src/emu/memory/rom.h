@@ -1,9 +1,7 @@
 #pragma once
 
 #include <cstdint>
-#include <memory>
 #include <span>
-#include <vector>
 
 
 namespace emu
@@ -16,26 +14,25 @@ namespace emu
 	};
 
 
+	// View into cartridge ROM data, the bytes are owned by the cartridge image
 	class ROM
 	{
 	public:
 		ROM() = default;
-		ROM(const ROM& other);
-		ROM(std::uint16_t size, std::span<std::uint8_t> data);
+		ROM(std::span<const std::uint8_t> data);
 
-		auto SetData(std::uint16_t size, std::span<std::uint8_t> data) -> void;
-		auto GetData() -> auto& { return m_Data; }
+		auto SetData(std::span<const std::uint8_t> data) -> void;
+		auto GetData() const -> std::span<const std::uint8_t> { return m_Data; }
 
-		constexpr auto ReadAddress(std::uint16_t address) -> std::uint8_t
+		constexpr auto ReadAddress(std::uint16_t address) const -> std::uint8_t
 		{
-			return m_Data.at(address);
+			return m_Data[address];
 		}
 
-		auto GetSize() const -> auto const { return m_Size; }
+		auto GetSize() const -> std::uint32_t { return static_cast<std::uint32_t>(m_Data.size()); }
 
 	private:
-		std::uint16_t m_Size{};
-		std::vector<std::uint8_t> m_Data{};
+		std::span<const std::uint8_t> m_Data{};
 	};
 
 
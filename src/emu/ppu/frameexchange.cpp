@@ -0,0 +1,48 @@
+#include "emu/ppu/frameexchange.h"
+
+
+namespace emu
+{
+
+	FrameExchange::FrameExchange()
+	{
+		for (auto& buffer : m_Buffers)
+			buffer.resize(FrameSize);
+	}
+
+	auto FrameExchange::Publish() -> void
+	{
+		m_Sequences[m_Back] = ++m_PublishedFrames;
+
+		// Release makes the pixels and sequence visible to the consumer that takes this slot
+		auto previous = m_Middle.exchange(m_Back | FreshFrame, std::memory_order_acq_rel);
+
+		m_Back = previous & IndexMask;
+	}
+
+	auto FrameExchange::AcquireLatest() -> Frame
+	{
+		if (m_Middle.load(std::memory_order_relaxed) & FreshFrame)
+		{
+			auto previous = m_Middle.exchange(m_Front, std::memory_order_acq_rel);
+
+			m_Front = previous & IndexMask;
+		}
+
+		auto sequence = m_Sequences[m_Front];
+
+		if (sequence == m_PresentedSequence)
+		{
+			if (sequence != 0)
+				m_DuplicatedFrames++;
+		}
+		else
+		{
+			m_DroppedFrames += sequence - m_PresentedSequence - 1;
+			m_PresentedSequence = sequence;
+		}
+
+		return Frame{ m_Buffers[m_Front], sequence };
+	}
+
+}
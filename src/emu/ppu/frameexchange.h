@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+namespace emu
+{
+
+	// Completed frame handed to the presenter. Sequence counts published frames from 1, 0 means
+	// nothing has been published yet. Pixels stay valid until the next AcquireLatest.
+	struct Frame
+	{
+		std::span<const std::uint8_t> Pixels{};
+		std::uint64_t Sequence{ 0 };
+	};
+
+	// Lock-free triple buffer between one producer (the PPU) and one consumer (the presenter).
+	// The producer renders into its back buffer and publishes it by swapping it with the middle
+	// slot, the consumer swaps the middle slot with its front buffer when it holds a newer frame.
+	// Neither side ever waits, a frame published over an unread one is dropped, and presenting
+	// without a new frame shows the previous one again.
+	class FrameExchange
+	{
+	public:
+		static constexpr std::uint32_t Width = 256;
+		static constexpr std::uint32_t Height = 240;
+		static constexpr std::size_t FrameSize = Width * Height * 4;
+
+		FrameExchange();
+
+		// Producer side
+		auto GetBackBuffer() -> std::span<std::uint8_t> { return m_Buffers[m_Back]; }
+		auto Publish() -> void;
+
+		// Consumer side
+		auto AcquireLatest() -> Frame;
+
+		// Counted on the consumer side from the sequence numbers of acquired frames
+		auto GetDroppedFrames() const -> std::uint64_t { return m_DroppedFrames; }
+		auto GetDuplicatedFrames() const -> std::uint64_t { return m_DuplicatedFrames; }
+
+	private:
+		// Set in the middle slot while it holds a frame the consumer has not taken yet
+		static constexpr std::uint8_t FreshFrame = 0x04;
+		static constexpr std::uint8_t IndexMask = 0x03;
+
+		std::array<std::vector<std::uint8_t>, 3> m_Buffers{};
+		std::array<std::uint64_t, 3> m_Sequences{};
+
+		// Producer only
+		std::uint8_t m_Back{ 0 };
+		std::uint64_t m_PublishedFrames{ 0 };
+
+		alignas(64) std::atomic<std::uint8_t> m_Middle{ 1 };
+
+		// Consumer only
+		alignas(64) std::uint8_t m_Front{ 2 };
+		std::uint64_t m_PresentedSequence{ 0 };
+		std::uint64_t m_DroppedFrames{ 0 };
+		std::uint64_t m_DuplicatedFrames{ 0 };
+	};
+
+}
@@ -0,0 +1,126 @@
+#include "emu/ppu/palette.h"
+
+#include <bit>
+
+
+namespace emu
+{
+
+	// 3 bits per channel, 0x0RGB. Columns E and F are black on the console.
+	static constexpr std::array<std::uint32_t, 64> PaletteColors
+	{
+		0x333, 0x014, 0x006, 0x326, 0x403, 0x503, 0x510, 0x420, 0x320, 0x120, 0x031, 0x040, 0x022, 0x111, 0x000, 0x000,
+		0x555, 0x036, 0x027, 0x407, 0x507, 0x704, 0x700, 0x630, 0x430, 0x140, 0x040, 0x053, 0x044, 0x222, 0x000, 0x000,
+		0x777, 0x357, 0x447, 0x637, 0x707, 0x737, 0x740, 0x750, 0x660, 0x360, 0x070, 0x276, 0x077, 0x444, 0x000, 0x000,
+		0x777, 0x567, 0x657, 0x757, 0x747, 0x755, 0x764, 0x770, 0x773, 0x572, 0x473, 0x276, 0x467, 0x666, 0x000, 0x000,
+	};
+
+	static constexpr std::uint8_t GrayscaleBit = 0x01;
+	static constexpr std::uint8_t EmphasisBits = 0xE0;
+
+	// Emphasizing one channel darkens the other two
+	static constexpr float EmphasisAttenuation = 0.816f;
+
+	// All 64 colors for each of the 8 emphasis combinations, indexed by (emphasis << 6) | color
+	static constexpr auto ColorTable = []
+	{
+		std::array<std::uint32_t, 8 * 64> table{};
+
+		for (std::uint32_t emphasis = 0; emphasis < 8; emphasis++)
+		{
+			for (std::uint32_t index = 0; index < 64; index++)
+			{
+				std::array<std::uint8_t, 4> rgba{ 0, 0, 0, 255 };
+
+				for (std::uint32_t channel = 0; channel < 3; channel++)
+				{
+					float value = ((PaletteColors[index] >> (8 - channel * 4)) & 0xF) / 7.0f * 255;
+
+					if (emphasis & ~(1u << channel))
+						value *= EmphasisAttenuation;
+
+					rgba[channel] = static_cast<std::uint8_t>(value);
+				}
+
+				table[(emphasis << 6) | index] = std::bit_cast<std::uint32_t>(rgba);
+			}
+		}
+
+		return table;
+	}();
+
+	// $3F10, $3F14, $3F18 and $3F1C share their byte with $3F00, $3F04, $3F08 and $3F0C
+	static auto EntryIndex(std::uint16_t address) -> std::uint8_t
+	{
+		std::uint8_t index = address & (Palette::EntryCount - 1);
+
+		return (index & 0x03) == 0 ? index & 0x0F : index;
+	}
+
+
+	Palette::Palette()
+	{
+		Resolve();
+	}
+
+	auto Palette::Read(std::uint16_t address) const -> std::uint8_t
+	{
+		auto value = m_Entries[EntryIndex(address)];
+
+		return m_Mask & GrayscaleBit ? value & 0x30 : value;
+	}
+
+	auto Palette::Write(std::uint16_t address, std::uint8_t value) -> void
+	{
+		auto index = EntryIndex(address);
+
+		m_Entries[index] = value & 0x3F;
+
+		// The backdrop shows through every transparent pixel, so it feeds eight resolved entries
+		if (index == 0)
+		{
+			Resolve();
+			return;
+		}
+
+		if ((index & 0x03) == 0)
+			return;
+
+		auto colorIndex = m_Mask & GrayscaleBit ? m_Entries[index] & 0x30 : m_Entries[index];
+		m_Colors[index] = ColorTable[((m_Mask & EmphasisBits) << 1) | colorIndex];
+	}
+
+	auto Palette::SetMask(std::uint8_t ppuMask) -> void
+	{
+		ppuMask &= EmphasisBits | GrayscaleBit;
+
+		if (ppuMask == m_Mask)
+			return;
+
+		m_Mask = ppuMask;
+
+		Resolve();
+	}
+
+	auto Palette::SetEntries(std::span<const std::uint8_t, EntryCount> entries) -> void
+	{
+		for (std::uint8_t index = 0; index < EntryCount; index++)
+			m_Entries[index] = entries[index] & 0x3F;
+
+		Resolve();
+	}
+
+	auto Palette::Resolve() -> void
+	{
+		auto colors = std::span(ColorTable).subspan((m_Mask & EmphasisBits) << 1, 64);
+		std::uint8_t colorMask = m_Mask & GrayscaleBit ? 0x30 : 0x3F;
+
+		for (std::uint8_t index = 0; index < EntryCount; index++)
+		{
+			auto entry = (index & 0x03) == 0 ? m_Entries[0] : m_Entries[index];
+
+			m_Colors[index] = colors[entry & colorMask];
+		}
+	}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+
+namespace emu
+{
+
+	// Palette RAM ($3F00 - $3F1F) together with every entry resolved to an RGBA color for the current
+	// PPUMASK grayscale and emphasis bits. Resolved colors hold R, G, B, A in memory order, so a pixel
+	// is written to the framebuffer with one 32 bit store.
+	class Palette
+	{
+	public:
+		static constexpr std::uint16_t EntryCount = 32;
+
+		Palette();
+
+		auto Read(std::uint16_t address) const -> std::uint8_t;
+		auto Write(std::uint16_t address, std::uint8_t value) -> void;
+
+		auto SetMask(std::uint8_t ppuMask) -> void;
+		auto SetEntries(std::span<const std::uint8_t, EntryCount> entries) -> void;
+
+		// Index 0x00 - 0x1F as formed by the PPU, entries at multiples of 4 return the backdrop color
+		inline auto GetColor(std::uint8_t index) const -> std::uint32_t { return m_Colors[index & (EntryCount - 1)]; }
+		auto GetColors() const -> std::span<const std::uint32_t, EntryCount> { return m_Colors; }
+		auto GetEntries() const -> std::span<const std::uint8_t, EntryCount> { return m_Entries; }
+
+	private:
+		auto Resolve() -> void;
+
+	private:
+		std::array<std::uint8_t, EntryCount> m_Entries{};
+		std::array<std::uint32_t, EntryCount> m_Colors{};
+
+		std::uint8_t m_Mask{ 0 };
+	};
+
+}
@@ -3,18 +3,18 @@
 #include "emu/memory/memorymanager.h"
 #include "emu/system/powerhandler.h"
 
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <bit>
 #include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <print>
 #include <thread>
 #include <ranges>
 #include <unordered_map>
 
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
-
 
 using namespace std::chrono_literals;
 
@@ -31,264 +31,161 @@ namespace emu
 	static constexpr std::uint16_t PPUDATA = 0x2007;
 	static constexpr std::uint16_t OAMDMA = 0x4014;
 	
-	static std::uint16_t RegV{};
-	static std::uint16_t RegT{};
-	static std::uint8_t RegX{};
-	static std::uint8_t RegW{};
+	static constexpr std::uint32_t DotsPerScanline = 341;
+	static constexpr std::uint32_t ScanlinesPerFrame = 262;
 
-	static bool OddFrame = false;
+	static constexpr std::uint32_t MasterClockFrequency = 21477272u;
 
-	static std::uint32_t MasterClockFrequency = 21477272u;
+	static constexpr std::uint8_t SpriteBehindBackground = 0x20;
+	static constexpr std::uint8_t SpriteZeroPixel = 0x40;
 
-	static std::vector<std::uint32_t> PaletteColors
-	{
-		0x333, 0x014, 0x006, 0x326, 0x403, 0x503, 0x510, 0x420, 0x320, 0x120, 0x031, 0x040, 0x022, 0x111, 0x003, 0x020,
-		0x555, 0x036, 0x027, 0x407, 0x507, 0x704, 0x700, 0x630, 0x430, 0x140, 0x040, 0x053, 0x044, 0x222, 0x200, 0x310,
-		0x777, 0x357, 0x447, 0x637, 0x707, 0x737, 0x740, 0x750, 0x660, 0x360, 0x070, 0x276, 0x077, 0x444, 0x000, 0x000,
-		0x777, 0x567, 0x657, 0x757, 0x747, 0x755, 0x764, 0x770, 0x773, 0x572, 0x473, 0x276, 0x467, 0x666, 0x653, 0x760,
-	};
+	static constexpr std::uint16_t HorizontalBits = 0x041F;
+	static constexpr std::uint16_t VerticalBits = 0x7BE0;
 
-	struct SpriteData
+	// V register layout: yyy NN YYYYY XXXXX (fine Y, nametable, coarse Y, coarse X)
+	static auto IncrementFineY(std::uint16_t& v) -> void
 	{
-		std::uint8_t YPosition;
-		std::uint8_t TileIndex;
-		std::uint8_t Attributes;
-		std::uint8_t XPosition;
-	};
-
-	struct TileData
-	{
-		std::array<std::uint8_t, 64> PixelValues;
-	};
-
-	static std::vector<std::uint8_t> ImageData;
-	static std::vector<std::uint16_t> NametableData;
-
-	static std::unordered_map<std::uint16_t, TileData> Tilemap;
-//	static std::unordered_map<std::uint8_t, TileData> Tilemap;
-	static std::vector<SpriteData> Sprites;
-
-
-	std::atomic<bool> SceneIsDrawing{ false };
-
-
+		if ((v & 0x7000) != 0x7000)
+		{
+			v += 0x1000;
+			return;
+		}
 
-	auto LoadTile(MemoryManager& memoryManager, std::uint16_t baseAddress, std::uint16_t tileID) -> void
-	{
-		TileData newTileData;
+		v &= ~0x7000;
 
-		std::vector<std::uint8_t> tileData(16);
-		std::uint16_t tileByteAddress = 0;
+		std::uint16_t coarseY = (v & 0x03E0) >> 5;
 
-		for (auto& tileByte : tileData)
+		// Row 29 is the last row of a nametable, rows 30 and 31 are attribute data and wrap without switching
+		if (coarseY == 29)
 		{
-			tileByte = memoryManager.ReadCharROM(baseAddress + tileID * 16u + tileByteAddress++);
+			coarseY = 0;
+			v ^= 0x0800;
 		}
-
-		auto index{ 0u };
-
-		for (auto row = 0; row < 8; row++)
+		else if (coarseY == 31)
 		{
-			for (auto col = 0; col < 8; col++)
-			{
-				auto pixelValue{ 0u };
-
-				auto byte1 = tileData.at(row);
-				auto byte2 = tileData.at(row + 8);
-
-				if (byte1 & 1 << (7 - col)) pixelValue += 1;
-				if (byte2 & 1 << (7 - col)) pixelValue += 2;
-
-				newTileData.PixelValues[index++] = pixelValue;
-			}
+			coarseY = 0;
 		}
-
-		Tilemap[tileID] = newTileData;
-	}
-
-	auto LoadTiles(MemoryManager& memoryManager) -> void
-	{
-		for (auto index = 0; index < 512; index++)
+		else
 		{
-			LoadTile(memoryManager, 0x0000, index);
+			coarseY++;
 		}
-	}
 
+		v = (v & ~0x03E0) | (coarseY << 5);
+	}
 
 	PPU::PPU(PowerHandler& powerHandler, MemoryManager& memoryManager, std::uint8_t nametableAlignment)
 		: m_PowerHandler(powerHandler), m_MemoryManager(memoryManager), m_NametableAlignment(nametableAlignment)
 	{
 		m_Pixels.resize(256 * 240);
-		ImageData.resize(256u * 240u * 4u);
 
-		std::uint16_t index{};
-
-		LoadTiles(m_MemoryManager);
+		SetSIMDLevel(DetectSIMDLevel());
 	}
 
-	auto PPU::IsDrawing() -> bool { return SceneIsDrawing.load(); }
-
-	auto PPU::GetImageData() -> std::vector<std::uint8_t>&
+	auto PPU::SetSIMDLevel(SIMDLevel level) -> void
 	{
-		while (SceneIsDrawing.load())
-			;
-
-		return ImageData;
+		m_ExpandTileRows = GetTileRowExpander(level);
+		m_FindSpritesOnRow = GetSpriteFinder(level);
 	}
 
-	auto PPU::Execute() -> void
+	auto PPU::GetDotsToScanlineEnd() const -> std::uint32_t
 	{
-		std::println("Starting PPU");
-
-		m_Executing.store(true);
-
-		auto framesPerSecond = 60.0988f;
-		auto frameTime = 1.0f / framesPerSecond;
-
-
-		const auto frequency = MasterClockFrequency / 4;
-		const auto cycleTime = 1'000'000'000 / frequency;
-
-		LARGE_INTEGER li{};
-		if (!QueryPerformanceFrequency(&li))
-		{
-			std::println("QueryPerformanceFrequency failed");
-		}
-
-		auto freq = li.QuadPart; //  / 1'000.0;
-		auto frequencyDivider = static_cast<double>(freq) / frequency;
-
-		std::println("PPU frequency: {} Hz, PerformanceCounterFrequency = {} Hz, frequencyDivider = {}", frequency, freq, frequencyDivider);
-
-		std::println("Frametime: {}s", frameTime);
-
-		NametableData.resize(32 * 30 * 2);
-
-		LARGE_INTEGER vblankCount{};
-		LARGE_INTEGER vblankStartCount{};
-
+		return DotsPerScanline - m_Dot;
+	}
 
-		LARGE_INTEGER startCount{};
-		LARGE_INTEGER endCount{};
+	auto PPU::Clock(std::uint32_t dots) -> bool
+	{
+		bool frameCompleted{ false };
 
-//		QueryPerformanceCounter(&vblankStartCount);
+		m_Dot += dots;
 
-		while (m_Executing.load())
+		while (m_Dot >= DotsPerScanline)
 		{
-			OddFrame = !OddFrame;
+			m_Dot -= DotsPerScanline;
 
-			QueryPerformanceCounter(&startCount);
+			if (m_Scanline < 240)
+				RenderScanline();
 
-			auto startTime = std::chrono::steady_clock::now();
-
-			if (m_PowerHandler.GetState() == PowerState::SingleStep || m_PowerHandler.GetState() == PowerState::Off)
-				m_PowerHandler.SetState(PowerState::Suspended);
+			// Dots 256 - 304: move V down one row and reload the horizontal scroll from T, the
+			// pre-render line also reloads the vertical scroll for the next frame
+			if ((m_Scanline < 240 || m_Scanline == 261) && (m_MemoryManager.ReadPPUIO(PPUMASK) & 0x18))
 			{
-				std::unique_lock<std::mutex> lock(m_Mutex);
-				m_CV.wait(lock, [&] {
-					return m_PowerHandler.GetState() != PowerState::Suspended || m_Executing.load() == 0;
-					});
-			}
+				auto v = m_MemoryManager.GetVRegister();
+				auto t = m_MemoryManager.GetTRegister();
 
-			m_MemoryManager.ClearPPUIOBit(PPUSTATUS, 0x40);
+				IncrementFineY(v);
+				v = (v & ~HorizontalBits) | (t & HorizontalBits);
 
+				if (m_Scanline == 261)
+					v = (v & ~VerticalBits) | (t & VerticalBits);
 
+				m_MemoryManager.SetVRegister(v);
 
-//			NametableData.clear();
+				// Dots 257 - 320 fetch sprite patterns, A12 rises once on this line when they come from the
+				// other pattern table than the background. 8x16 sprites fill unused slots with tile $FF at $1000.
+				auto ppuCtrl = m_MemoryManager.ReadPPUIO(PPUCTRL);
+				bool spritesHigh = (ppuCtrl & 0x20) || (ppuCtrl & 0x08);
+				bool backgroundHigh = ppuCtrl & 0x10;
 
-			// Set VBlank flag
-			{
-				m_MemoryManager.SetPPUIOBit(PPUSTATUS, 0x80);
+				if (spritesHigh != backgroundHigh)
+					m_MemoryManager.ClockA12(1);
 			}
 
-			QueryPerformanceCounter(&vblankStartCount);
-
-			do 
+			if (++m_Scanline == ScanlinesPerFrame)
 			{
-				QueryPerformanceCounter(&vblankCount);
-			} while ((vblankCount.QuadPart - vblankStartCount.QuadPart) < (6820 * frequencyDivider));
-
-
-			if (m_MemoryManager.ReadPPUIO(PPUCTRL) & 0x80 && (m_MemoryManager.GetPPUIOBit(PPUSTATUS) & 0x80))
-			{
-				//				std::println("TriggerNMI");
-				CPU::TriggerNMI();
+				m_Scanline = 0;
+				m_OddFrame = !m_OddFrame;
 			}
 
-			// Clear VBlank flag
+			switch (m_Scanline)
 			{
-				m_MemoryManager.ClearPPUIOBit(PPUSTATUS, 0x80);
-			}
-
-			// Set Sprite0 hit flag
-			{
-//				m_MemoryManager.SetPPUIOBit(PPUSTATUS, 0x40);
-
-			}
+				// Post-render scanline, the visible frame is complete
+				case 240:
+				{
+					if (m_OutputEnabled)
+						m_FrameExchange.Publish();
 
-//			while (CPU::NMIRunning())
-//				;
+					frameCompleted = true;
 
-			// Generate image data
+					break;
+				}
 
-//			while (CPU::NMIRunning())
-//				
-//			std::this_thread::sleep_for(4ms);
+				// Set VBlank flag
+				case 241:
+				{
+					m_MemoryManager.SetPPUIOBit(PPUSTATUS, 0x80);
 
-//			if (OddFrame)
-//			{
-			SceneIsDrawing.store(true);
-			GenerateImageData(ImageData);
-			SceneIsDrawing.store(false);
-//			}
+					if (m_MemoryManager.ReadPPUIO(PPUCTRL) & 0x80)
+					{
+						m_MemoryManager.TriggerNMI();
+					}
 
-//			std::this_thread::sleep_for(8ms);
+					break;
+				}
 
-			// Clear Sprite0 hit flag
-			{
-//				m_MemoryManager.ClearPPUIOBit(PPUSTATUS, 0x40);
+				// Pre-render scanline, clear VBlank, sprite 0 hit and sprite overflow
+				case 261:
+				{
+					m_MemoryManager.ClearPPUIOBit(PPUSTATUS, 0xE0);
+					break;
+				}
 			}
-
-//			else
-//				std::println("Skipping NMI");
-
-//			std::this_thread::sleep_for(2ms);
-//			std::this_thread::sleep_for(12ms);
-
-
-			do
-			{
-				QueryPerformanceCounter(&endCount);
-			} while ((endCount.QuadPart - startCount.QuadPart) < (240 * 341 * frequencyDivider)); // * frequencyDivider * 341 < (240 * 341 * frequencyDivider));
-
-//			auto endTime = std::chrono::steady_clock::now();
-
-//			std::println("Frametime: {}", std::chrono::duration<double>(endTime - startTime).count());
 		}
 
-		std::println("Stopping PPU");
+		return frameCompleted;
 	}
 
-	auto PPU::Stop() -> void
+	auto PPU::SaveState(PPUState& state) const -> void
 	{
-		m_Executing.store(false);
-		m_CV.notify_all();
+		state.Dot = m_Dot;
+		state.Scanline = m_Scanline;
+		state.OddFrame = m_OddFrame;
 	}
 
-	auto PPU::UpdatePowerState() -> void
+	auto PPU::LoadState(const PPUState& state) -> void
 	{
-		m_CV.notify_all();
-	}
-
-	auto PPU::ToggleW() -> void
-	{
-		++RegW &= 0x01;
-
-	}
-	
-	auto PPU::ResetW() -> void
-	{
-		RegW = 0;
+		m_Dot = state.Dot;
+		m_Scanline = state.Scanline;
+		m_OddFrame = state.OddFrame;
 	}
 
 	auto PPU::ReadMemory(std::uint16_t address) -> std::uint8_t
@@ -301,234 +198,207 @@ namespace emu
 		m_MemoryManager.WritePPURAM(address, value);
 	}
 
-	auto DrawSprite(SpriteData& spriteData, std::uint8_t spriteIndex, std::uint8_t backgroundIndex, MemoryManager& memoryManager) -> void
+	auto PPU::RenderScanline() -> void
 	{
-		// Check sprite 0 collision
-//		if (spriteIndex == 0)
-//		{
-//			auto& sprite = Sprites[0];
-//			auto& tileData = Tilemap.at(sprite.TileIndex);
-//			auto& backgroundTileData = Tilemap.at(backgroundIndex);
-//	
-//			for (auto i = 0; i < 64; i++)
-//			{
-//				if ((tileData.PixelValues.at(i) & backgroundTileData.PixelValues.at(i)) != 0)
-//				{
-//					auto value = memoryManager.ReadPPUIO(PPUSTATUS);
-//					value |= 0x40;
-//					memoryManager.WritePPUIO(PPUSTATUS, value);
-//
-//					break;
-//				}
-//			}
-//		}
-
-		if (spriteIndex == 0)
-			memoryManager.SetPPUIOBit(PPUSTATUS, 0x40);
-
-		for (auto yIndex = 0; yIndex < 8; yIndex++)
+		auto ppuCtrl = m_MemoryManager.ReadPPUIO(PPUCTRL);
+		auto ppuMask = m_MemoryManager.ReadPPUIO(PPUMASK);
+
+		// Hidden frames only keep the status flags right, sprite overflow comes from the evaluation and
+		// a sprite 0 hit needs the whole line with background and sprites enabled
+		if (!m_OutputEnabled)
 		{
-			for (auto xIndex = 0; xIndex < 8; xIndex++)
-			{
-				if (Tilemap.at(spriteData.TileIndex).PixelValues.at(yIndex * 8 + xIndex) == 0)
-					continue;
+			if (!(ppuMask & 0x18))
+				return;
 
-				std::uint8_t paletteIndex = 0x10 | ((spriteData.Attributes & 0x3) << 2) | (Tilemap.at(spriteData.TileIndex).PixelValues.at(yIndex * 8 + xIndex) & 0x3);
-				auto paletteColor = memoryManager.ReadPPURAM(0x3F00 + paletteIndex);
+			EvaluateSprites(ppuCtrl);
 
-				auto color = PaletteColors.at(paletteColor);
+			if (!m_SpriteZeroOnLine || (ppuMask & 0x18) != 0x18)
+				return;
+		}
 
-				auto posX = spriteData.XPosition + xIndex;
-				auto posY = spriteData.YPosition + yIndex;
+		auto& palette = m_MemoryManager.GetPalette();
 
-				if (spriteData.Attributes & 0x40)
-					posX = spriteData.XPosition + 8 - xIndex;
-				if (spriteData.Attributes & 0x80)
-					posY = spriteData.YPosition + 8 - yIndex;
+		auto line = m_FrameExchange.GetBackBuffer().subspan(m_Scanline * 256 * 4, 256 * 4);
+		auto colors = palette.GetColors();
+		auto backdrop = colors[0];
 
-				if (posX < 0 || posX >= 256 || posY < 0 || posY >= 240)
-					continue;
+		std::uint32_t fineX{ 0 };
+
+		if (ppuMask & 0x08)
+		{
+			fineX = RenderBackground(ppuCtrl, colors, line);
+
+			// Background hidden in the leftmost 8 pixels, it is transparent there for sprites as well
+			if (!(ppuMask & 0x02))
+			{
+				for (std::uint32_t x = 0; x < 8; x++)
+					std::memcpy(&line[x * 4], &backdrop, sizeof(backdrop));
 
-				ImageData.at((posY * 256 + posX) * 4 + 0) = ((color & 0x0F00) >> 8) / 7.0f * 255;
-				ImageData.at((posY * 256 + posX) * 4 + 1) = ((color & 0x00F0) >> 4) / 7.0f * 255;
-				ImageData.at((posY * 256 + posX) * 4 + 2) = (color & 0x000F) / 7.0f * 255;
-				ImageData.at((posY * 256 + posX) * 4 + 3) = 255;
+				std::memset(&m_BackgroundPixels[fineX], 0, 8);
 			}
 		}
+		else
+		{
+			for (std::uint32_t x = 0; x < 256; x++)
+				std::memcpy(&line[x * 4], &backdrop, sizeof(backdrop));
+
+			m_BackgroundPixels.fill(0);
+		}
+
+		if (!(ppuMask & 0x18))
+			return;
 
+		EvaluateSprites(ppuCtrl);
 
+		if ((ppuMask & 0x10) && m_SpriteCount > 0)
+			RenderSprites(ppuCtrl, ppuMask, std::span(m_BackgroundPixels).subspan(fineX, 256), line);
 	}
 
-	auto DrawTile(std::uint16_t tileID, std::uint8_t tileAttribute, std::uint16_t x, std::uint16_t y, std::uint8_t sizeY, std::uint8_t scrollX, MemoryManager& memoryManager) -> void
+	auto PPU::RenderBackground(std::uint8_t ppuCtrl, std::span<const std::uint32_t, 32> colors, std::span<std::uint8_t> line) -> std::uint32_t
 	{
-		std::uint8_t spriteSelect{ 0 };
+		auto& tileCache = m_MemoryManager.GetTileCache();
 
-//		auto xOffset = memoryManager.GetXRegister();
+		std::uint16_t patternBase = ppuCtrl & 0x10 ? 0x100 : 0x000;
 
-		if (!Tilemap.contains(tileID))
-		{
-			std::println("Tile {:02x} unavailable", tileID);
-			return;
-		}
+		auto v = m_MemoryManager.GetVRegister();
+		std::uint32_t fineX = m_MemoryManager.GetXRegister();
+		std::uint32_t fineY = (v >> 12) & 0x07;
 
-		for (auto yIndex = 0; yIndex < sizeY; yIndex++)
-		{
-			for (auto xIndex = 0; xIndex < 8; xIndex++)
-			{
-				std::uint8_t paletteIndex = (spriteSelect << 4) | ((tileAttribute & 0x3) << 2) | (Tilemap[tileID].PixelValues.at(yIndex * 8 + xIndex) & 0x3);
-				auto paletteColor = memoryManager.ReadPPURAM(0x3F00 + paletteIndex);
+		std::uint32_t coarseX = v & 0x1F;
+		std::uint32_t coarseY = (v >> 5) & 0x1F;
+		std::uint8_t nametable = (v >> 10) & 0x03;
 
-				if (paletteColor == 0x0f && paletteIndex % 4 == 0)
-					paletteColor = 0x22;
+		// The line starts in the nametable selected by V and continues into its horizontal neighbour
+		std::array<std::uint8_t, 64> tileIDs;
+		m_MemoryManager.ReadNametableRow(nametable, coarseY, std::span(tileIDs).first<32>());
+		m_MemoryManager.ReadNametableRow(nametable ^ 0x01, coarseY, std::span(tileIDs).last<32>());
 
-				auto color = PaletteColors.at(paletteColor);
+		std::array attributeTables{ m_MemoryManager.GetAttributeTable(nametable), m_MemoryManager.GetAttributeTable(nametable ^ 0x01) };
+		std::uint32_t attributeRow = (coarseY >> 2) * 8;
+		std::uint32_t attributeShift = (coarseY & 0x02) << 1;
 
-				auto posX = x * 8 + xIndex - scrollX;
-				auto posY = y * 8 + yIndex;
+		// 33 tiles cover the line for every fine X offset. They are fetched first, then expanded
+		// unclipped in one pass and the visible 256 pixels are copied out starting at fineX.
+		for (std::uint32_t tile = 0; tile < 33; tile++)
+		{
+			std::uint32_t column = coarseX + tile;
 
-				if (posX < 0 || posX >= 256)
-					continue;
+			auto attribute = attributeTables[column >> 5][attributeRow + ((column & 0x1F) >> 2)];
+			std::uint8_t paletteBase = ((attribute >> (attributeShift | (column & 0x02))) & 0x03) << 2;
 
-				ImageData.at((posY * 256 + posX) * 4 + 0) = ((color & 0x0F00) >> 8) / 7.0f * 255;
-				ImageData.at((posY * 256 + posX) * 4 + 1) = ((color & 0x00F0) >> 4) / 7.0f * 255;
-				ImageData.at((posY * 256 + posX) * 4 + 2) = (color & 0x000F) / 7.0f * 255;
-				ImageData.at((posY * 256 + posX) * 4 + 3) = 255;
-			}
+			auto pixels = &tileCache.GetTile(patternBase + tileIDs[column]).PixelValues[fineY * 8];
+
+			// Pixel values stay around for sprite priority and sprite 0 hit
+			std::memcpy(&m_BackgroundPixels[tile * 8], pixels, 8);
+			m_TileRows[tile] = TileRow{ pixels, paletteBase };
 		}
-	}
 
-	auto PPU::GenerateImageData(std::span<std::uint8_t> imageData) -> void
-	{
-		auto ppuCtrl = m_MemoryManager.ReadPPUIO(PPUCTRL);
-		auto ppuMask = m_MemoryManager.ReadPPUIO(PPUMASK);
+		m_ExpandTileRows(m_TileRows, colors.data(), m_BackgroundLine.data());
+		std::memcpy(line.data(), &m_BackgroundLine[fineX], 256 * sizeof(std::uint32_t));
 
-		std::uint16_t patternBaseAddress = ppuCtrl & 0x10 ? 0x1000 : 0x0000;
-		std::uint16_t spritePatternTable = ppuCtrl & 0x08 ? 0x1000 : 0x0000;
-		std::uint8_t spriteSize = ppuCtrl & 0x20 ? 16 : 8;
+		return fineX;
+	}
 
-		auto scrollX = m_MemoryManager.GetScrollXRegister() + ((ppuCtrl & 0x1) << 8);
-		auto scrollY = m_MemoryManager.GetScrollYRegister() + ((ppuCtrl & 0x2) << 8);
+	auto PPU::EvaluateSprites(std::uint8_t ppuCtrl) -> void
+	{
+		m_SpriteCount = 0;
+		m_SpriteZeroOnLine = false;
 
-//		auto scrollT = m_MemoryManager.GetTRegister();
-//		auto scrollV = m_MemoryManager.GetVRegister();
-//		auto scrollFine = m_MemoryManager.GetXRegister();
+		// Sprites are evaluated on the line before they show up, nothing is evaluated for line 0
+		if (m_Scanline == 0)
+			return;
 
-//		auto scrollX = scrollT & 0x1F;
-//		auto scrollY = 0;
+		std::uint8_t height = ppuCtrl & 0x20 ? 16 : 8;
 
-		// Read sprites
+		auto& oam = m_MemoryManager.GetMemoryMap().OAMRAM.Data;
+		auto sprites = m_FindSpritesOnRow(oam.data(), static_cast<std::uint8_t>(m_Scanline - 1), height);
 
-		Sprites.clear();
+		m_SpriteZeroOnLine = sprites & 0x1;
 
-		for (auto index = 0; index < 64; index++)
+		while (sprites != 0 && m_SpriteCount < m_SecondaryOAM.size())
 		{
-			SpriteData sprite;
-			sprite.YPosition = m_MemoryManager.ReadOAMRAM(index * 4);
-			sprite.TileIndex = m_MemoryManager.ReadOAMRAM(index * 4 + 1) + (spritePatternTable == 0x1000 ? 0x100 : 0x0);
-			sprite.Attributes = m_MemoryManager.ReadOAMRAM(index * 4 + 2);
-			sprite.XPosition = m_MemoryManager.ReadOAMRAM(index * 4 + 3);
-
-			if (sprite.YPosition >= 0xEF || sprite.XPosition >= 0xF9)
-				continue;
+			auto index = std::countr_zero(sprites);
+			std::memcpy(&m_SecondaryOAM[m_SpriteCount++], &oam[index * 4], sizeof(SpriteData));
 
-			Sprites.push_back(sprite);
+			sprites &= sprites - 1;
 		}
 
-		if (Sprites.size() >= 8)
+		// A ninth sprite on the line sets the overflow flag
+		if (sprites != 0)
 			m_MemoryManager.SetPPUIOBit(PPUSTATUS, 0x20);
+	}
 
-//		Tilemap.clear();
-
-		std::uint16_t nametableOffset{ 0 };
+	auto PPU::RenderSprites(std::uint8_t ppuCtrl, std::uint8_t ppuMask, std::span<const std::uint8_t> backgroundPixels, std::span<std::uint8_t> line) -> void
+	{
+		auto& palette = m_MemoryManager.GetPalette();
+		auto& tileCache = m_MemoryManager.GetTileCache();
 
-		std::vector<std::uint8_t> attributeData(0x80);
+		std::uint32_t height = ppuCtrl & 0x20 ? 16 : 8;
 
-//		scrollX = 15;
+		m_SpriteLine.fill(0);
 
-		// Load tile data
-		for (auto y = 0; y < 30; y++)
+		// Sprites are drawn in OAM order and only fill transparent pixels, so the lower index always wins,
+		// even when it is behind the background and the background is drawn instead
+		for (std::uint32_t index = 0; index < m_SpriteCount; index++)
 		{
-			for (auto x = 0; x < 64; x++)
-			{
-//				nametableOffset = m_MemoryManager.GetTRegister() & 0x0C00;
-				nametableOffset = 0x400 * (ppuCtrl & 0x3);
+			auto& sprite = m_SecondaryOAM[index];
 
-				if (x >= 32)
-				{
-					nametableOffset ^= 0x400;
-				}
+			std::uint32_t row = m_Scanline - 1 - sprite.YPosition;
 
-//				std::uint8_t tileID = m_MemoryManager.ReadPPURAM(0x2000 + nametableOffset + y * 32 + x % 32); //xpos);
-				std::uint8_t tileID = m_MemoryManager.ReadPPURAM(0x2000 + nametableOffset + y * 32 + x % 32); //xpos);
+			if (sprite.Attributes & 0x80)
+				row = height - 1 - row;
 
-				NametableData[y * 64 + x] = tileID + (patternBaseAddress == 0x1000 ? 0x100 : 0x0);
+			std::uint16_t tileIndex = sprite.TileIndex;
 
-//				if (!Tilemap.contains(tileID))
-//					LoadTile(m_MemoryManager, patternBaseAddress, tileID);
-			}
-		}
+			if (height == 16)
+				tileIndex = ((tileIndex & 0x01) << 8) | ((tileIndex & 0xFE) + (row >> 3));
+			else if (ppuCtrl & 0x08)
+				tileIndex |= 0x100;
 
-		for (auto y = 0; y < 8; y++)
-		{
-			for (auto x = 0; x < 16; x++)
-			{
-//				nametableOffset = m_MemoryManager.GetTRegister() & 0x0C00;
-				nametableOffset = 0x400 * (ppuCtrl & 0x3);
+			auto pixels = &tileCache.GetTile(tileIndex).PixelValues[(row & 0x07) * 8];
 
-				if (x >= 8)
-				{
-					nametableOffset ^= 0x400;
-				}
+			std::uint8_t flags = 0x10 | ((sprite.Attributes & 0x03) << 2) | (sprite.Attributes & SpriteBehindBackground);
 
-				attributeData[y * 16 + x] = m_MemoryManager.ReadPPURAM(0x2000 + nametableOffset + 0x3c0 + y * 8 + x % 8); // xpos);
-			}
-		}
+			if (index == 0 && m_SpriteZeroOnLine)
+				flags |= SpriteZeroPixel;
 
-//		if (m_MemoryManager.GetXRegister() != 0)
-//			std::println("Scroll T: {:04x}  - Scroll V: {:04x}  - Scroll X: {:02x}", scrollT, scrollV, m_MemoryManager.GetXRegister());
-			std::println("ScrollX : {}", scrollX);
+			for (std::uint32_t pixel = 0; pixel < 8; pixel++)
+			{
+				std::uint32_t x = sprite.XPosition + pixel;
 
-		auto softScrollX = scrollX % 8;
-		auto softScrollY = scrollY % 8;
+				if (x >= 256)
+					break;
 
-		scrollX >>= 3;
-		scrollY >>= 3;
+				auto value = pixels[sprite.Attributes & 0x40 ? 7 - pixel : pixel];
 
-		// Parse screen (tilewise)
-		for (auto y = 0u; y < 30u; y++)
-		{
-			for (auto x = 0u; x < 33u; x++)
-			{
-				// Draw background
-				// Disabled for debugging purposes
-				if (!(ppuMask & 0x08))
+				if (value == 0 || m_SpriteLine[x] != 0)
 					continue;
 
-				if (x == 32 && softScrollX == 0)
-					continue;
+				m_SpriteLine[x] = flags | value;
+			}
+		}
 
-				std::uint16_t tile = ((y + scrollY) * 64u) + (((x + scrollX) % 64));
-				std::uint16_t attribute = ((y + scrollY) / 4 * 16u) + (((x + scrollX) % 64) / 4);
+		// Sprites hidden in the leftmost 8 pixels
+		std::uint32_t firstX = ppuMask & 0x04 ? 0 : 8;
 
-				std::uint8_t tileAttributeX = ((x + scrollX) % 4) > 1 ? 1 : 0;
-				std::uint8_t tileAttributeY = ((y + scrollY) % 4) > 1 ? 2 : 0;
-				
-				// Shift down attributeValue to correct block
+		for (std::uint32_t x = firstX; x < 256; x++)
+		{
+			auto spritePixel = m_SpriteLine[x];
 
-				auto attributeValue = attributeData[attribute];
-				std::uint8_t tileAttribute = (attributeValue >> (2 * (tileAttributeX + tileAttributeY))) & 0x3;
+			if (spritePixel == 0)
+				continue;
 
-				DrawTile(NametableData[tile], tileAttribute, x, y, spriteSize, softScrollX, m_MemoryManager);
-			}
-		}
+			bool backgroundOpaque = backgroundPixels[x] != 0;
 
-		if (ppuMask & 0x10)
-		{
-			// Load sprite tiles
-			for (auto sprite : Sprites)
-			{
-				DrawSprite(sprite, 0, 0, m_MemoryManager);
-			}
+			// Sprite 0 hit needs opaque pixels from both, and never happens on the last pixel
+			if ((spritePixel & SpriteZeroPixel) && backgroundOpaque && x != 255)
+				m_MemoryManager.SetPPUIOBit(PPUSTATUS, 0x40);
+
+			if ((spritePixel & SpriteBehindBackground) && backgroundOpaque)
+				continue;
+
+			auto color = palette.GetColor(spritePixel & 0x1F);
+			std::memcpy(&line[x * 4], &color, sizeof(color));
 		}
 	}
 
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "emu/memory/memorymanager.h"
+#include "emu/ppu/frameexchange.h"
+#include "emu/ppu/spriteeval.h"
+#include "emu/ppu/tilerow.h"
 #include "emu/system/powerhandler.h"
 
 #include <array>
@@ -14,31 +17,52 @@
 namespace emu
 {
 
+	struct SpriteData
+	{
+		std::uint8_t YPosition;
+		std::uint8_t TileIndex;
+		std::uint8_t Attributes;
+		std::uint8_t XPosition;
+	};
+
+
 	class PPU
 	{
 	public:
 		PPU() = delete;
 		PPU(PowerHandler& powerHandler, MemoryManager& memoryManager, std::uint8_t nametableAlignment);
 
-		static auto ToggleW() -> void;
-		static auto ResetW() -> void;
+		auto Clock(std::uint32_t dots) -> bool;
 
-		auto Stop() -> void;
+		// Dots until the end of the current scanline, rendering and every status change happen there
+		auto GetDotsToScanlineEnd() const -> std::uint32_t;
 
-		auto UpdatePowerState() -> void;
+		// Instruction set used for background rendering and sprite evaluation, the detected one by default
+		auto SetSIMDLevel(SIMDLevel level) -> void;
 
-		auto Execute() -> void;
-
-		auto GenerateImageData(std::span<std::uint8_t> imageData) -> void;
 		auto GetInternalMemory() -> std::array<std::uint8_t, 0x100>& { return m_OAM; }
-		auto GetImageData() -> std::vector<std::uint8_t>&;
 
-		auto IsDrawing() -> bool;
+		// Every completed frame is published here at the start of the post-render scanline
+		auto GetFrameExchange() -> FrameExchange& { return m_FrameExchange; }
+
+		// Without output frames are neither drawn nor published, only the lines the sprite 0 hit depends
+		// on are rendered. Used for the hidden frames of run-ahead.
+		auto SetOutputEnabled(bool enabled) -> void { m_OutputEnabled = enabled; }
+
+		// Beam position, everything else the PPU renders from lives in MemoryManager
+		auto SaveState(PPUState& state) const -> void;
+		auto LoadState(const PPUState& state) -> void;
 
 	private:
 		auto ReadMemory(std::uint16_t address) -> std::uint8_t;
 		auto WriteMemory(std::uint16_t address, std::uint8_t value) -> void;
 
+		auto RenderScanline() -> void;
+		auto RenderBackground(std::uint8_t ppuCtrl, std::span<const std::uint32_t, 32> colors, std::span<std::uint8_t> line) -> std::uint32_t;
+
+		auto EvaluateSprites(std::uint8_t ppuCtrl) -> void;
+		auto RenderSprites(std::uint8_t ppuCtrl, std::uint8_t ppuMask, std::span<const std::uint8_t> backgroundPixels, std::span<std::uint8_t> line) -> void;
+
 	private:
 		MemoryManager& m_MemoryManager;
 		PowerHandler& m_PowerHandler;
@@ -50,10 +74,30 @@ namespace emu
 
 		std::span<std::uint8_t> m_MMIO;
 
-		std::atomic<bool> m_Executing{ false };
+		FrameExchange m_FrameExchange{};
+
+		ExpandTileRowsFn m_ExpandTileRows{ nullptr };
+
+		std::array<TileRow, 33> m_TileRows{};
+		std::array<std::uint32_t, 33 * 8> m_BackgroundLine{};
+		std::array<std::uint8_t, 33 * 8> m_BackgroundPixels{};
+
+		FindSpritesOnRowFn m_FindSpritesOnRow{ nullptr };
+
+		// Up to 8 sprites of the current scanline in OAM order, sprite 0 can only be the first one
+		std::array<SpriteData, 8> m_SecondaryOAM{};
+		std::uint32_t m_SpriteCount{ 0 };
+		bool m_SpriteZeroOnLine{ false };
+
+		// Palette entry (0x10 - 0x1F, 0 when transparent) of the frontmost sprite pixel, with
+		// SpriteBehindBackground and SpriteZeroPixel flags
+		std::array<std::uint8_t, 256> m_SpriteLine{};
+
+		bool m_OddFrame{ false };
+		bool m_OutputEnabled{ true };
 
-		std::condition_variable m_CV{};
-		std::mutex m_Mutex{};
+		std::uint32_t m_Dot{ 0 };
+		std::uint32_t m_Scanline{ 0 };
 	};
 
 }
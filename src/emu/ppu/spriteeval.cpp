@@ -0,0 +1,95 @@
+#include "emu/ppu/spriteeval.h"
+
+#if defined(REXXNES_X86)
+	#include <immintrin.h>
+#endif
+
+
+namespace emu
+{
+
+	static auto FindSpritesOnRowScalar(const std::uint8_t* oam, std::uint8_t row, std::uint8_t height) -> std::uint64_t
+	{
+		std::uint64_t mask{ 0 };
+
+		for (std::uint32_t sprite = 0; sprite < 64; sprite++)
+		{
+			if (row >= oam[sprite * 4] && static_cast<std::uint8_t>(row - oam[sprite * 4]) < height)
+				mask |= std::uint64_t{ 1 } << sprite;
+		}
+
+		return mask;
+	}
+
+#if defined(REXXNES_X86)
+
+	// Packs the byte mask bits of every fourth byte (the Y positions of 8 OAM entries) into 8 bits
+	static auto PackYBits(std::uint32_t bits) -> std::uint32_t
+	{
+		bits &= 0x11111111;
+		bits = (bits | (bits >> 3)) & 0x03030303;
+		bits = (bits | (bits >> 6)) & 0x000F000F;
+
+		return (bits | (bits >> 12)) & 0xFF;
+	}
+
+	// Unsigned row - Y < height is tested for all bytes as min(diff, height - 1) == diff and Y <= row as
+	// max(row, Y) == row, only the Y bytes are kept
+	REXXNES_TARGET("sse2")
+	static auto FindSpritesOnRowSSE2(const std::uint8_t* oam, std::uint8_t row, std::uint8_t height) -> std::uint64_t
+	{
+		auto rows = _mm_set1_epi8(static_cast<char>(row));
+		auto limit = _mm_set1_epi8(static_cast<char>(height - 1));
+
+		std::uint64_t mask{ 0 };
+
+		for (std::uint32_t chunk = 0; chunk < 16; chunk++)
+		{
+			auto entries = _mm_loadu_si128(reinterpret_cast<const __m128i*>(oam + chunk * 16));
+			auto difference = _mm_sub_epi8(rows, entries);
+			auto below = _mm_cmpeq_epi8(_mm_max_epu8(rows, entries), rows);
+			auto inside = _mm_and_si128(_mm_cmpeq_epi8(_mm_min_epu8(difference, limit), difference), below);
+
+			mask |= std::uint64_t{ PackYBits(static_cast<std::uint32_t>(_mm_movemask_epi8(inside))) } << (chunk * 4);
+		}
+
+		return mask;
+	}
+
+	REXXNES_TARGET("avx2")
+	static auto FindSpritesOnRowAVX2(const std::uint8_t* oam, std::uint8_t row, std::uint8_t height) -> std::uint64_t
+	{
+		auto rows = _mm256_set1_epi8(static_cast<char>(row));
+		auto limit = _mm256_set1_epi8(static_cast<char>(height - 1));
+
+		std::uint64_t mask{ 0 };
+
+		for (std::uint32_t chunk = 0; chunk < 8; chunk++)
+		{
+			auto entries = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(oam + chunk * 32));
+			auto difference = _mm256_sub_epi8(rows, entries);
+			auto below = _mm256_cmpeq_epi8(_mm256_max_epu8(rows, entries), rows);
+			auto inside = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(difference, limit), difference), below);
+
+			mask |= std::uint64_t{ PackYBits(static_cast<std::uint32_t>(_mm256_movemask_epi8(inside))) } << (chunk * 8);
+		}
+
+		return mask;
+	}
+
+#endif
+
+	auto GetSpriteFinder(SIMDLevel level) -> FindSpritesOnRowFn
+	{
+#if defined(REXXNES_X86)
+		if (level == SIMDLevel::AVX2)
+			return FindSpritesOnRowAVX2;
+
+		if (level == SIMDLevel::SSSE3)
+			return FindSpritesOnRowSSE2;
+#endif
+
+		return FindSpritesOnRowScalar;
+	}
+
+}
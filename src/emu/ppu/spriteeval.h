@@ -0,0 +1,19 @@
+#pragma once
+
+#include "emu/system/simd.h"
+
+#include <cstdint>
+
+
+namespace emu
+{
+
+	// Compares the Y byte of all 64 OAM entries against row and returns a mask with bit n set for
+	// every sprite n where Y <= row and row - Y is below height, i.e. sprites covering that row.
+	// Nothing wraps, sprites parked at Y $EF - $FF stay hidden instead of reaching the first lines.
+	using FindSpritesOnRowFn = auto (*)(const std::uint8_t* oam, std::uint8_t row, std::uint8_t height) -> std::uint64_t;
+
+	// Falls back to the next lower level when the requested one is not compiled in
+	auto GetSpriteFinder(SIMDLevel level) -> FindSpritesOnRowFn;
+
+}
@@ -0,0 +1,70 @@
+#include "emu/ppu/tilecache.h"
+
+#include <algorithm>
+
+
+namespace emu
+{
+
+
+	TileCache::TileCache()
+	{
+		m_Tiles.resize(TileCount);
+	}
+
+	auto TileCache::SetPatternData(std::span<const std::uint8_t> patternData) -> void
+	{
+		for (std::uint8_t bank = 0; bank < BankCount; bank++)
+		{
+			std::size_t offset = bank * BankSize;
+			m_Banks[bank] = offset < patternData.size() ? patternData.subspan(offset, std::min<std::size_t>(BankSize, patternData.size() - offset)) : std::span<const std::uint8_t>{};
+		}
+
+		InvalidateAll();
+	}
+
+	auto TileCache::SetPatternBank(std::uint8_t bank, std::span<const std::uint8_t> bankData) -> void
+	{
+		bank &= BankCount - 1;
+
+		if (bankData.data() == m_Banks[bank].data() && bankData.size() == m_Banks[bank].size())
+			return;
+
+		m_Banks[bank] = bankData;
+
+		for (std::uint16_t tile = 0; tile < TilesPerBank; tile++)
+			m_Decoded[bank * TilesPerBank + tile] = false;
+	}
+
+	auto TileCache::Decode(std::uint16_t tileIndex) -> void
+	{
+		auto& tile = m_Tiles[tileIndex];
+		auto& bank = m_Banks[tileIndex / TilesPerBank];
+		std::size_t offset = (tileIndex % TilesPerBank) * BytesPerTile;
+
+		m_Decoded[tileIndex] = true;
+		m_DecodeCount++;
+
+		if (offset + BytesPerTile > bank.size())
+		{
+			tile.PixelValues.fill(0);
+			return;
+		}
+
+		auto tileData = bank.subspan(offset, BytesPerTile);
+
+		for (auto row = 0; row < 8; row++)
+		{
+			auto byte1 = tileData[row];
+			auto byte2 = tileData[row + 8];
+
+			for (auto col = 0; col < 8; col++)
+			{
+				auto shift = 7 - col;
+
+				tile.PixelValues[row * 8 + col] = static_cast<std::uint8_t>(((byte1 >> shift) & 0x1) | (((byte2 >> shift) & 0x1) << 1));
+			}
+		}
+	}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+namespace emu
+{
+
+	// 8x8 tile with one palette index (0-3) per pixel, row major. Exactly one cache line.
+	struct alignas(64) DecodedTile
+	{
+		std::array<std::uint8_t, 64> PixelValues{};
+	};
+
+	// Decoded pattern tables, indexed by (pattern table << 8) | tile. Tiles are decoded on
+	// first use and dropped again when the CHR data behind them changes. The pattern data is
+	// seen through eight 1KB banks of 64 tiles, like the CHR windows of the cartridge.
+	class TileCache
+	{
+	public:
+		static constexpr std::uint16_t TileCount = 512;
+		static constexpr std::uint16_t BytesPerTile = 16;
+		static constexpr std::uint16_t BankCount = 8;
+		static constexpr std::uint16_t BankSize = 0x400;
+		static constexpr std::uint16_t TilesPerBank = BankSize / BytesPerTile;
+
+		TileCache();
+
+		// Contiguous 8KB of pattern data, split into the eight banks
+		auto SetPatternData(std::span<const std::uint8_t> patternData) -> void;
+
+		// Drops the decoded tiles of the bank only when it points at other data
+		auto SetPatternBank(std::uint8_t bank, std::span<const std::uint8_t> bankData) -> void;
+
+		inline auto GetTile(std::uint16_t tileIndex) -> const DecodedTile&
+		{
+			tileIndex &= TileCount - 1;
+
+			if (!m_Decoded[tileIndex]) [[unlikely]]
+				Decode(tileIndex);
+
+			return m_Tiles[tileIndex];
+		}
+
+		auto Invalidate(std::uint16_t tileIndex) -> void { m_Decoded[tileIndex & (TileCount - 1)] = false; }
+		auto InvalidateAll() -> void { m_Decoded.reset(); }
+
+		auto GetDecodeCount() const -> std::uint64_t { return m_DecodeCount; }
+
+	private:
+		auto Decode(std::uint16_t tileIndex) -> void;
+
+	private:
+		std::array<std::span<const std::uint8_t>, BankCount> m_Banks{};
+
+		std::vector<DecodedTile> m_Tiles;
+		std::bitset<TileCount> m_Decoded{};
+
+		std::uint64_t m_DecodeCount{ 0 };
+	};
+
+}
@@ -0,0 +1,80 @@
+#include "emu/ppu/tilerow.h"
+
+#if defined(REXXNES_X86)
+	#include <immintrin.h>
+#endif
+
+
+namespace emu
+{
+
+	static auto ExpandTileRowsScalar(std::span<const TileRow> rows, const std::uint32_t* colors, std::uint32_t* output) -> void
+	{
+		for (auto& row : rows)
+		{
+			auto rowColors = colors + row.PaletteBase;
+
+			for (auto pixel = 0; pixel < 8; pixel++)
+				output[pixel] = rowColors[row.PixelValues[pixel]];
+
+			output += 8;
+		}
+	}
+
+#if defined(REXXNES_X86)
+
+	// The 4 colors of a palette fill one register, every pixel value becomes the byte shuffle indices of its color
+	REXXNES_TARGET("ssse3")
+	static auto ExpandTileRowsSSSE3(std::span<const TileRow> rows, const std::uint32_t* colors, std::uint32_t* output) -> void
+	{
+		auto byteOffsets = _mm_setr_epi8(0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3);
+		auto spreadLow = _mm_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3);
+		auto spreadHigh = _mm_setr_epi8(4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7);
+
+		for (auto& row : rows)
+		{
+			auto palette = _mm_loadu_si128(reinterpret_cast<const __m128i*>(colors + row.PaletteBase));
+			auto values = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row.PixelValues));
+
+			// Pixel values are 0-3, so value * 4 stays inside its byte
+			auto selectLow = _mm_add_epi8(_mm_slli_epi16(_mm_shuffle_epi8(values, spreadLow), 2), byteOffsets);
+			auto selectHigh = _mm_add_epi8(_mm_slli_epi16(_mm_shuffle_epi8(values, spreadHigh), 2), byteOffsets);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm_shuffle_epi8(palette, selectLow));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 4), _mm_shuffle_epi8(palette, selectHigh));
+
+			output += 8;
+		}
+	}
+
+	// Pixel values widened to 32 bit lanes select their color with one cross lane permute
+	REXXNES_TARGET("avx2")
+	static auto ExpandTileRowsAVX2(std::span<const TileRow> rows, const std::uint32_t* colors, std::uint32_t* output) -> void
+	{
+		for (auto& row : rows)
+		{
+			auto palette = _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(colors + row.PaletteBase)));
+			auto values = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row.PixelValues)));
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(output), _mm256_permutevar8x32_epi32(palette, values));
+
+			output += 8;
+		}
+	}
+
+#endif
+
+	auto GetTileRowExpander(SIMDLevel level) -> ExpandTileRowsFn
+	{
+#if defined(REXXNES_X86)
+		if (level == SIMDLevel::AVX2)
+			return ExpandTileRowsAVX2;
+
+		if (level == SIMDLevel::SSSE3)
+			return ExpandTileRowsSSSE3;
+#endif
+
+		return ExpandTileRowsScalar;
+	}
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "emu/system/simd.h"
+
+#include <cstdint>
+#include <span>
+
+
+namespace emu
+{
+
+	// One row of a decoded tile (8 pixel values 0-3) and the first palette entry of its attribute
+	struct TileRow
+	{
+		const std::uint8_t* PixelValues{ nullptr };
+		std::uint32_t PaletteBase{ 0 };
+	};
+
+	// Expands every tile row into 8 consecutive RGBA pixels of output. colors holds the 32 resolved
+	// palette entries, pixel value 0 of every palette already resolves to the backdrop.
+	using ExpandTileRowsFn = auto (*)(std::span<const TileRow> rows, const std::uint32_t* colors, std::uint32_t* output) -> void;
+
+	// Falls back to the next lower level when the requested one is not compiled in
+	auto GetTileRowExpander(SIMDLevel level) -> ExpandTileRowsFn;
+
+}
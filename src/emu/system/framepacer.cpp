@@ -0,0 +1,159 @@
+#include "emu/system/framepacer.h"
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <thread>
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h>
+#else
+	#include <time.h>
+#endif
+
+
+namespace emu
+{
+
+	// Indexed by FrequencyType (PAL, NTSC, Dendy), read-only so every thread can share them
+	static constexpr std::array<std::uint32_t, 3> Frequency{ 1'662'607, 1'789'773, 1'773'448 };
+
+	// 341 dots x 262 scanlines / 3 dots per cycle (NTSC, averaged over the odd frame skip),
+	// 341 x 312 / 3.2 (PAL) and 341 x 312 / 3 (Dendy)
+	static constexpr std::array<double, 3> CyclesPerFrame{ 33'247.5, 29'780.5, 35'464.0 };
+
+	// Frames that finish later than this are not caught up, the pacer restarts from the current time instead
+	static constexpr std::uint32_t MaxFramesBehind = 2;
+
+
+	auto GetCPUFrequency(FrequencyType frequencyType) -> std::uint32_t
+	{
+		return Frequency.at(static_cast<std::size_t>(frequencyType));
+	}
+
+	auto GetCPUCyclesPerFrame(FrequencyType frequencyType) -> double
+	{
+		return CyclesPerFrame.at(static_cast<std::size_t>(frequencyType));
+	}
+
+	auto GetFramePeriod(FrequencyType frequencyType) -> std::chrono::duration<double, std::nano>
+	{
+		return std::chrono::duration<double, std::nano>(GetCPUCyclesPerFrame(frequencyType) * 1e9 / GetCPUFrequency(frequencyType));
+	}
+
+	auto GetThreadCPUTime() -> std::chrono::nanoseconds
+	{
+#if defined(_WIN32)
+		FILETIME creationTime{}, exitTime{}, kernelTime{}, userTime{};
+		GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime);
+
+		auto toTicks = [](const FILETIME& fileTime) { return (static_cast<std::uint64_t>(fileTime.dwHighDateTime) << 32) | fileTime.dwLowDateTime; };
+
+		// FILETIME is in 100ns units
+		return std::chrono::nanoseconds((toTicks(kernelTime) + toTicks(userTime)) * 100);
+#else
+		timespec time{};
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+
+		return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+#endif
+	}
+
+	static auto SleepUntil(std::chrono::steady_clock::time_point wakeTime) -> void
+	{
+#if defined(__linux__)
+		// steady_clock is CLOCK_MONOTONIC on Linux, so the deadline can be handed to the kernel as an absolute time
+		auto sinceEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(wakeTime.time_since_epoch());
+
+		timespec deadline{};
+		deadline.tv_sec = static_cast<time_t>(sinceEpoch.count() / 1'000'000'000);
+		deadline.tv_nsec = static_cast<long>(sinceEpoch.count() % 1'000'000'000);
+
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR)
+			;
+#elif defined(_WIN32)
+		// Regular sleeps are rounded up to the system timer tick (15.6ms by default), high resolution timers are not
+#if !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+		constexpr DWORD CREATE_WAITABLE_TIMER_HIGH_RESOLUTION = 0x00000002;
+#endif
+		static thread_local HANDLE timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+
+		auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(wakeTime - std::chrono::steady_clock::now());
+
+		if (timer && remaining.count() > 0)
+		{
+			LARGE_INTEGER dueTime{};
+			dueTime.QuadPart = -(remaining.count() / 100);
+
+			if (SetWaitableTimer(timer, &dueTime, 0, nullptr, nullptr, FALSE))
+			{
+				WaitForSingleObject(timer, INFINITE);
+				return;
+			}
+		}
+
+		std::this_thread::sleep_until(wakeTime);
+#else
+		std::this_thread::sleep_until(wakeTime);
+#endif
+	}
+
+
+	FramePacer::FramePacer(FrequencyType frequencyType, std::chrono::nanoseconds spinSlack)
+		: m_SpinSlack(spinSlack)
+	{
+		SetFrequencyType(frequencyType);
+		Reset();
+	}
+
+	auto FramePacer::SetFrequencyType(FrequencyType frequencyType) -> void
+	{
+		m_FramePeriod = emu::GetFramePeriod(frequencyType);
+		Reset();
+	}
+
+	auto FramePacer::SetSpinSlack(std::chrono::nanoseconds spinSlack) -> void
+	{
+		m_SpinSlack = spinSlack;
+	}
+
+	auto FramePacer::Reset() -> void
+	{
+		m_StartTime = std::chrono::steady_clock::now();
+		m_FrameIndex = 0;
+	}
+
+	auto FramePacer::WaitForNextFrame() -> void
+	{
+		m_FrameIndex++;
+
+		auto deadline = m_StartTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(m_FramePeriod * static_cast<double>(m_FrameIndex));
+		auto currentTime = std::chrono::steady_clock::now();
+
+		if (currentTime >= deadline)
+		{
+			m_LateFrames++;
+
+			if (currentTime - deadline > m_FramePeriod * MaxFramesBehind)
+			{
+				m_ResyncCount++;
+				Reset();
+			}
+
+			return;
+		}
+
+		if (deadline - currentTime > m_SpinSlack)
+		{
+			SleepUntil(deadline - m_SpinSlack);
+		}
+
+		while (std::chrono::steady_clock::now() < deadline)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+
+namespace emu
+{
+
+	enum class FrequencyType
+	{
+		PAL,
+		NTSC,
+		Dendy,
+	};
+
+	auto GetCPUFrequency(FrequencyType frequencyType) -> std::uint32_t;
+	auto GetCPUCyclesPerFrame(FrequencyType frequencyType) -> double;
+	auto GetFramePeriod(FrequencyType frequencyType) -> std::chrono::duration<double, std::nano>;
+
+	// CPU time consumed by the calling thread, used to report the host cost per emulated second
+	auto GetThreadCPUTime() -> std::chrono::nanoseconds;
+
+
+	// Paces emulation to the frame rate of the selected TV system. The pacer sleeps until shortly
+	// before the frame deadline and spins for the remaining slack, which keeps the wake-up jitter of
+	// the OS scheduler out of the frame timing without burning a core for the whole frame.
+	// Deadlines are absolute (start + frame * period), so rounding and oversleep never accumulate.
+	class FramePacer
+	{
+	public:
+		static constexpr std::chrono::microseconds DefaultSpinSlack{ 500 };
+
+		explicit FramePacer(FrequencyType frequencyType, std::chrono::nanoseconds spinSlack = DefaultSpinSlack);
+
+		auto SetFrequencyType(FrequencyType frequencyType) -> void;
+		auto SetSpinSlack(std::chrono::nanoseconds spinSlack) -> void;
+
+		auto Reset() -> void;
+		auto WaitForNextFrame() -> void;
+
+		auto GetFramePeriod() const -> std::chrono::duration<double, std::nano> { return m_FramePeriod; }
+		auto GetLateFrames() const -> std::uint64_t { return m_LateFrames; }
+		auto GetResyncCount() const -> std::uint64_t { return m_ResyncCount; }
+
+	private:
+		std::chrono::duration<double, std::nano> m_FramePeriod{};
+		std::chrono::nanoseconds m_SpinSlack{};
+
+		std::chrono::steady_clock::time_point m_StartTime{};
+		std::uint64_t m_FrameIndex{ 0 };
+
+		std::uint64_t m_LateFrames{ 0 };
+		std::uint64_t m_ResyncCount{ 0 };
+	};
+
+
+}
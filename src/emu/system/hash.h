@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+
+namespace emu
+{
+
+	// 64-bit FNV-1a, used to fingerprint framebuffers and memory for regression runs
+	constexpr auto HashBytes(std::span<const std::uint8_t> data, std::uint64_t hash = 0xCBF2'9CE4'8422'2325) -> std::uint64_t
+	{
+		for (auto byte : data)
+		{
+			hash ^= byte;
+			hash *= 0x0000'0100'0000'01B3;
+		}
+
+		return hash;
+	}
+
+}
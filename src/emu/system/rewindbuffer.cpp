@@ -0,0 +1,305 @@
+#include "emu/system/rewindbuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace emu
+{
+
+	// Shortest run of unchanged bytes worth ending a literal run for
+	static constexpr std::size_t MinZeroRun = 4;
+
+
+	static auto AsBytes(MachineState& state) -> std::span<std::uint8_t>
+	{
+		return { reinterpret_cast<std::uint8_t*>(&state), sizeof(MachineState) };
+	}
+
+	static auto AsBytes(const MachineState& state) -> std::span<const std::uint8_t>
+	{
+		return { reinterpret_cast<const std::uint8_t*>(&state), sizeof(MachineState) };
+	}
+
+	static auto WriteVarint(std::vector<std::uint8_t>& out, std::size_t value) -> void
+	{
+		while (value >= 0x80)
+		{
+			out.push_back(static_cast<std::uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+
+		out.push_back(static_cast<std::uint8_t>(value));
+	}
+
+	static auto ReadVarint(std::span<const std::uint8_t> data, std::size_t& position) -> std::size_t
+	{
+		std::size_t value{ 0 };
+
+		for (std::uint32_t shift = 0; position < data.size(); shift += 7)
+		{
+			auto byte = data[position++];
+			value |= static_cast<std::size_t>(byte & 0x7F) << shift;
+
+			if (!(byte & 0x80))
+				break;
+		}
+
+		return value;
+	}
+
+	// current XOR base as a sequence of (unchanged byte count, literal count, literals), without a
+	// base the state itself is encoded
+	static auto Encode(std::span<const std::uint8_t> current, std::span<const std::uint8_t> base, std::vector<std::uint8_t>& out) -> void
+	{
+		auto byteAt = [&](std::size_t index) -> std::uint8_t
+		{
+			return base.empty() ? current[index] : current[index] ^ base[index];
+		};
+
+		auto size = current.size();
+		std::size_t position{ 0 };
+
+		while (position < size)
+		{
+			auto zeroStart = position;
+
+			while (position < size && byteAt(position) == 0)
+				position++;
+
+			auto literalStart = position;
+
+			while (position < size)
+			{
+				if (byteAt(position) == 0)
+				{
+					auto runEnd = std::min(position + MinZeroRun, size);
+					auto zeros = position;
+
+					while (zeros < runEnd && byteAt(zeros) == 0)
+						zeros++;
+
+					if (zeros == runEnd)
+						break;
+				}
+
+				position++;
+			}
+
+			WriteVarint(out, literalStart - zeroStart);
+			WriteVarint(out, position - literalStart);
+
+			for (auto index = literalStart; index < position; index++)
+				out.push_back(byteAt(index));
+		}
+	}
+
+	// XORs the encoded bytes into target, which turns the previous state into the next one and back
+	static auto Decode(std::span<const std::uint8_t> encoded, std::span<std::uint8_t> target) -> void
+	{
+		std::size_t position{ 0 };
+		std::size_t offset{ 0 };
+
+		while (position < encoded.size())
+		{
+			offset += ReadVarint(encoded, position);
+			auto literals = ReadVarint(encoded, position);
+
+			for (std::size_t i = 0; i < literals && offset < target.size(); i++)
+				target[offset++] ^= encoded[position++];
+		}
+	}
+
+
+	RewindBuffer::RewindBuffer(std::uint32_t capacity)
+		: m_Capacity(std::max(capacity, KeyframeInterval * 2))
+	{
+		for (std::uint32_t slot = 0; slot < StagingSlots; slot++)
+		{
+			m_Staging[slot] = std::make_unique<MachineState>();
+			m_Free.push_back(slot);
+		}
+
+		m_Worker = std::thread(&RewindBuffer::Work, this);
+	}
+
+	RewindBuffer::~RewindBuffer()
+	{
+		{
+			std::lock_guard lock(m_Mutex);
+			m_Stopping = true;
+		}
+
+		m_WorkAvailable.notify_all();
+		m_Worker.join();
+	}
+
+	auto RewindBuffer::BeginCapture() -> MachineState*
+	{
+		std::lock_guard lock(m_Mutex);
+
+		if (m_Free.empty())
+		{
+			m_SkippedCaptures.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		m_Capturing = m_Free.back();
+		m_Free.pop_back();
+
+		return m_Staging[m_Capturing].get();
+	}
+
+	auto RewindBuffer::EndCapture() -> void
+	{
+		{
+			std::lock_guard lock(m_Mutex);
+			m_Pending.push_back(m_Capturing);
+		}
+
+		m_WorkAvailable.notify_one();
+	}
+
+	auto RewindBuffer::StepBack(MachineState& state) -> bool
+	{
+		std::unique_lock lock(m_Mutex);
+		WaitUntilIdle(lock);
+
+		if (m_Entries.empty())
+			return false;
+
+		std::memcpy(&state, m_Newest.get(), sizeof(MachineState));
+
+		auto entry = std::move(m_Entries.back());
+		m_Entries.pop_back();
+		m_EncodedBytes -= entry.Data.size();
+
+		// A delta undoes itself, removing a keyframe means decoding the group before it
+		if (entry.Keyframe)
+		{
+			Rebuild();
+		}
+		else
+		{
+			Decode(entry.Data, AsBytes(*m_Newest));
+			m_SinceKeyframe--;
+		}
+
+		UpdateCounters();
+
+		return true;
+	}
+
+	auto RewindBuffer::Clear() -> void
+	{
+		std::unique_lock lock(m_Mutex);
+		WaitUntilIdle(lock);
+
+		m_Entries.clear();
+		m_EncodedBytes = 0;
+		m_SinceKeyframe = 0;
+		m_HasNewest = false;
+
+		UpdateCounters();
+	}
+
+	auto RewindBuffer::Work() -> void
+	{
+		while (true)
+		{
+			std::uint32_t slot{ 0 };
+
+			{
+				std::unique_lock lock(m_Mutex);
+				m_WorkAvailable.wait(lock, [this] { return m_Stopping || !m_Pending.empty(); });
+
+				if (m_Stopping)
+					return;
+
+				slot = m_Pending.front();
+				m_Pending.pop_front();
+				m_WorkerBusy = true;
+			}
+
+			Store(*m_Staging[slot]);
+
+			{
+				std::lock_guard lock(m_Mutex);
+
+				m_Free.push_back(slot);
+				m_WorkerBusy = false;
+			}
+
+			m_Idle.notify_all();
+		}
+	}
+
+	auto RewindBuffer::Store(const MachineState& state) -> void
+	{
+		// Only the worker changes the newest state while it is busy, StepBack waits for it
+		Entry entry{};
+		entry.Keyframe = !m_HasNewest || m_SinceKeyframe + 1 >= KeyframeInterval;
+
+		Encode(AsBytes(state), entry.Keyframe ? std::span<const std::uint8_t>{} : AsBytes(*m_Newest), entry.Data);
+		entry.Data.shrink_to_fit();
+
+		std::memcpy(m_Newest.get(), &state, sizeof(MachineState));
+		m_HasNewest = true;
+
+		std::lock_guard lock(m_Mutex);
+
+		m_SinceKeyframe = entry.Keyframe ? 0 : m_SinceKeyframe + 1;
+		m_EncodedBytes += entry.Data.size();
+		m_Entries.push_back(std::move(entry));
+
+		// The oldest deltas are useless without their keyframe, whole groups are dropped
+		if (m_Entries.size() > m_Capacity)
+		{
+			do
+			{
+				m_EncodedBytes -= m_Entries.front().Data.size();
+				m_Entries.pop_front();
+			}
+			while (!m_Entries.empty() && !m_Entries.front().Keyframe);
+		}
+
+		UpdateCounters();
+	}
+
+	auto RewindBuffer::Rebuild() -> void
+	{
+		if (m_Entries.empty())
+		{
+			m_HasNewest = false;
+			m_SinceKeyframe = 0;
+
+			return;
+		}
+
+		auto keyframe = m_Entries.size() - 1;
+
+		while (!m_Entries[keyframe].Keyframe)
+			keyframe--;
+
+		auto newest = AsBytes(*m_Newest);
+		std::ranges::fill(newest, std::uint8_t{ 0 });
+
+		for (auto index = keyframe; index < m_Entries.size(); index++)
+			Decode(m_Entries[index].Data, newest);
+
+		m_SinceKeyframe = static_cast<std::uint32_t>(m_Entries.size() - 1 - keyframe);
+	}
+
+	auto RewindBuffer::UpdateCounters() -> void
+	{
+		m_FrameCount.store(static_cast<std::uint32_t>(m_Entries.size()), std::memory_order_relaxed);
+		m_MemoryUsage.store(m_EncodedBytes + m_Entries.size() * sizeof(Entry), std::memory_order_relaxed);
+	}
+
+	auto RewindBuffer::WaitUntilIdle(std::unique_lock<std::mutex>& lock) -> void
+	{
+		m_Idle.wait(lock, [this] { return m_Pending.empty() && !m_WorkerBusy; });
+	}
+
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "emu/system/savestate.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+
+namespace emu
+{
+
+	// Fixed capacity history of save states for rewinding. Every KeyframeInterval-th entry holds a whole
+	// state, the ones in between the XOR against the previous state. Both are run-length encoded, which
+	// leaves little more than the bytes that changed since RAM and VRAM barely move from frame to frame.
+	//
+	// The emulation thread saves straight into one of a few staging slots (BeginCapture/EndCapture), a
+	// worker thread encodes it. When the worker falls behind, captures are skipped instead of waiting.
+	class RewindBuffer
+	{
+	public:
+		static constexpr std::uint32_t KeyframeInterval = 30;
+		static constexpr std::uint32_t StagingSlots = 4;
+
+		explicit RewindBuffer(std::uint32_t capacity);
+		~RewindBuffer();
+
+		RewindBuffer(const RewindBuffer&) = delete;
+		auto operator=(const RewindBuffer&) -> RewindBuffer& = delete;
+
+		// Emulation thread. nullptr when every staging slot is still waiting for the worker.
+		auto BeginCapture() -> MachineState*;
+		auto EndCapture() -> void;
+
+		// Emulation thread. Removes the newest state and copies it to state, false when the history is empty.
+		auto StepBack(MachineState& state) -> bool;
+		auto Clear() -> void;
+
+		// Safe from any thread
+		auto GetFrameCount() const -> std::uint32_t { return m_FrameCount.load(std::memory_order_relaxed); }
+		auto GetMemoryUsage() const -> std::size_t { return m_MemoryUsage.load(std::memory_order_relaxed); }
+		auto GetSkippedCaptures() const -> std::uint64_t { return m_SkippedCaptures.load(std::memory_order_relaxed); }
+
+	private:
+		struct Entry
+		{
+			std::vector<std::uint8_t> Data;
+			bool Keyframe{ false };
+		};
+
+		auto Work() -> void;
+		auto Store(const MachineState& state) -> void;
+		auto Rebuild() -> void;
+		auto UpdateCounters() -> void;
+
+		auto WaitUntilIdle(std::unique_lock<std::mutex>& lock) -> void;
+
+	private:
+		std::uint32_t m_Capacity{ 0 };
+
+		std::deque<Entry> m_Entries{};
+		std::size_t m_EncodedBytes{ 0 };
+		std::uint32_t m_SinceKeyframe{ 0 };
+
+		// Decoded newest entry, deltas are taken against it and StepBack returns it without decoding
+		std::unique_ptr<MachineState> m_Newest{ std::make_unique<MachineState>() };
+		bool m_HasNewest{ false };
+
+		std::array<std::unique_ptr<MachineState>, StagingSlots> m_Staging{};
+		std::deque<std::uint32_t> m_Pending{};
+		std::vector<std::uint32_t> m_Free{};
+		std::uint32_t m_Capturing{ 0 };
+		bool m_WorkerBusy{ false };
+		bool m_Stopping{ false };
+
+		std::atomic<std::uint32_t> m_FrameCount{ 0 };
+		std::atomic<std::size_t> m_MemoryUsage{ 0 };
+		std::atomic<std::uint64_t> m_SkippedCaptures{ 0 };
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_WorkAvailable{};
+		std::condition_variable m_Idle{};
+
+		std::thread m_Worker{};
+	};
+
+
+}
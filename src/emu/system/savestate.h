@@ -0,0 +1,102 @@
+#pragma once
+
+#include "emu/cartridge/mapper.h"
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+
+namespace emu
+{
+
+	// Binary save state format. MachineState is the file layout itself: a header followed by one fixed
+	// size block per component, written and read with a single copy. Bump SaveStateVersion whenever a
+	// block changes, states of another version or size are rejected.
+
+	constexpr std::uint32_t SaveStateMagic = 0x5453'5852;		// "RXST"
+	constexpr std::uint16_t SaveStateVersion = 2;
+
+	struct SaveStateHeader
+	{
+		std::uint32_t Magic{ SaveStateMagic };
+		std::uint16_t Version{ SaveStateVersion };
+		std::uint16_t Reserved{ 0 };
+		std::uint32_t Size{ 0 };
+		std::uint32_t Reserved2{ 0 };
+		std::uint64_t FrameCount{ 0 };
+	};
+
+	struct CPUState
+	{
+		std::uint8_t A{};
+		std::uint8_t X{};
+		std::uint8_t Y{};
+		std::uint8_t SP{};
+		std::uint16_t PC{};
+		std::uint8_t Flags{};
+		bool NMIRunning{};
+		std::uint64_t Cycles{};
+	};
+
+	struct PPUState
+	{
+		std::uint32_t Dot{};
+		std::uint32_t Scanline{};
+		bool OddFrame{};
+	};
+
+	struct APUState
+	{
+		std::uint64_t Cycles{};
+	};
+
+	// RAM, PPU latches, controller shift state and the mapper board. Banks are stored as bank numbers,
+	// CHR RAM is only used by cartridges without CHR ROM.
+	struct MemoryState
+	{
+		std::array<std::uint8_t, 0x800> CPURAM{};
+		std::array<std::uint8_t, 0x2000> ProgramRAM{};
+		std::array<std::uint8_t, 0x2000> CharRAM{};
+		std::array<std::uint8_t, 0x1000> NametableRAM{};
+		std::array<std::uint8_t, 0x100> OAMRAM{};
+		std::array<std::uint8_t, 0x10> APURAM{};
+		std::array<std::uint8_t, 0x8> PPUIO{};
+		std::array<std::uint8_t, 0x18> APUIO{};
+		std::array<std::uint8_t, 32> PaletteEntries{};
+
+		std::uint16_t RegisterV{};
+		std::uint16_t RegisterT{};
+		std::uint8_t RegisterX{};
+		bool RegisterW{};
+		std::uint8_t PPUDataBuffer{};
+		std::uint16_t OAMAddress{};
+
+		std::uint8_t ControllerClock{};
+		std::uint8_t ControllerLatch{};
+
+		bool NMI{};
+		std::uint8_t IRQLines{};
+		std::uint16_t DMACycles{};
+
+		NametableMirroring Mirroring{};
+		std::array<std::uint32_t, 4> PRGBanks{};
+		std::array<std::uint32_t, 8> CHRBanks{};
+
+		MapperState Board{};
+	};
+
+	struct MachineState
+	{
+		SaveStateHeader Header{};
+
+		CPUState CPU{};
+		PPUState PPU{};
+		APUState APU{};
+		MemoryState Memory{};
+	};
+
+	static_assert(std::is_trivially_copyable_v<MachineState>, "Save states are copied as raw bytes");
+
+
+}
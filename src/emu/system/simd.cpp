@@ -0,0 +1,68 @@
+#include "emu/system/simd.h"
+
+#if defined(REXXNES_X86) && defined(_MSC_VER)
+	#include <intrin.h>
+	#include <immintrin.h>
+#endif
+
+
+namespace emu
+{
+
+	static auto QuerySIMDLevel() -> SIMDLevel
+	{
+#if defined(REXXNES_X86) && (defined(__GNUC__) || defined(__clang__))
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("avx2"))
+			return SIMDLevel::AVX2;
+
+		if (__builtin_cpu_supports("ssse3"))
+			return SIMDLevel::SSSE3;
+#elif defined(REXXNES_X86) && defined(_MSC_VER)
+		int info[4]{};
+
+		__cpuid(info, 1);
+
+		bool ssse3 = info[2] & (1 << 9);
+		bool osxsave = info[2] & (1 << 27);
+
+		// AVX registers are only usable when the OS saves them on context switches
+		if (osxsave && (_xgetbv(0) & 0x6) == 0x6)
+		{
+			__cpuidex(info, 7, 0);
+
+			if (info[1] & (1 << 5))
+				return SIMDLevel::AVX2;
+		}
+
+		if (ssse3)
+			return SIMDLevel::SSSE3;
+#endif
+
+		return SIMDLevel::Scalar;
+	}
+
+	auto DetectSIMDLevel() -> SIMDLevel
+	{
+		static const SIMDLevel level = QuerySIMDLevel();
+
+		return level;
+	}
+
+	auto GetSIMDLevelName(SIMDLevel level) -> std::string_view
+	{
+		switch (level)
+		{
+			case SIMDLevel::SSSE3:
+				return "SSSE3";
+
+			case SIMDLevel::AVX2:
+				return "AVX2";
+
+			default:
+				return "Scalar";
+		}
+	}
+
+}
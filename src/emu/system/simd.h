@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define REXXNES_X86 1
+#endif
+
+// Functions using intrinsics above the compiler baseline are compiled for their instruction set only,
+// callers select them at run time through DetectSIMDLevel
+#if defined(REXXNES_X86) && (defined(__GNUC__) || defined(__clang__))
+	#define REXXNES_TARGET(isa) __attribute__((target(isa)))
+#else
+	#define REXXNES_TARGET(isa)
+#endif
+
+
+namespace emu
+{
+
+	enum class SIMDLevel : std::uint8_t
+	{
+		Scalar,
+		SSSE3,
+		AVX2,
+	};
+
+	// Highest level supported by both the host CPU and the OS, detected once
+	auto DetectSIMDLevel() -> SIMDLevel;
+
+	auto GetSIMDLevelName(SIMDLevel level) -> std::string_view;
+
+}
@@ -0,0 +1,234 @@
+#include "emu/system/system.h"
+
+#include <chrono>
+#include <print>
+
+
+namespace emu
+{
+
+	static constexpr std::uint32_t PPUDotsPerCPUCycle = 3;
+
+
+	System::System(PowerHandler& powerHandler, CPU& cpu, PPU& ppu, APU& apu)
+		: m_PowerHandler(powerHandler), m_CPU(cpu), m_PPU(ppu), m_APU(apu)
+	{
+
+	}
+
+	auto System::SetFrequencyType(FrequencyType frequencyType) -> void
+	{
+		m_FrequencyType = frequencyType;
+		m_FramePacer.SetFrequencyType(frequencyType);
+	}
+
+	auto System::Reset() -> void
+	{
+		m_CPU.Reset();
+		m_FrameCount = 0;
+
+		if (m_RewindBuffer)
+			m_RewindBuffer->Clear();
+	}
+
+	auto System::SaveState(MachineState& state) const -> void
+	{
+		state.Header = SaveStateHeader{};
+		state.Header.Size = sizeof(MachineState);
+		state.Header.FrameCount = m_FrameCount;
+
+		m_CPU.SaveState(state.CPU);
+		m_PPU.SaveState(state.PPU);
+		m_APU.SaveState(state.APU);
+		m_CPU.GetMemoryManager().SaveState(state.Memory);
+	}
+
+	auto System::LoadState(const MachineState& state) -> bool
+	{
+		auto& header = state.Header;
+
+		if (header.Magic != SaveStateMagic || header.Version != SaveStateVersion || header.Size != sizeof(MachineState))
+			return false;
+
+		// Checked first, a rejected state must not leave the console half loaded
+		if (!m_CPU.GetMemoryManager().LoadState(state.Memory))
+			return false;
+
+		m_CPU.LoadState(state.CPU);
+		m_PPU.LoadState(state.PPU);
+		m_APU.LoadState(state.APU);
+
+		m_FrameCount = header.FrameCount;
+
+		return true;
+	}
+
+	auto System::EnableRewind(std::uint32_t frames) -> void
+	{
+		m_RewindBuffer = std::make_unique<RewindBuffer>(frames);
+		m_RewindState = std::make_unique<MachineState>();
+	}
+
+	auto System::StepInstruction() -> bool
+	{
+		return CatchUp(m_CPU.Step());
+	}
+
+	auto System::RunFrame() -> bool
+	{
+		bool frameCompleted{ false };
+
+		while (!frameCompleted)
+		{
+			auto cycles = (m_PPU.GetDotsToScanlineEnd() + PPUDotsPerCPUCycle - 1) / PPUDotsPerCPUCycle;
+			auto executed = m_CPU.Run(cycles);
+
+			frameCompleted = CatchUp(executed);
+
+			// An invalid opcode suspends the CPU, Execute waits on that outside the frame
+			if (!frameCompleted && (executed == 0 || m_PowerHandler.GetState() != PowerState::Run))
+				return false;
+		}
+
+		return true;
+	}
+
+	auto System::CatchUp(std::uint32_t cycles) -> bool
+	{
+		m_APU.Clock(static_cast<std::uint16_t>(cycles));
+
+		if (m_PPU.Clock(cycles * PPUDotsPerCPUCycle))
+		{
+			m_FrameCount++;
+			return true;
+		}
+
+		return false;
+	}
+
+	auto System::RunFrameAhead() -> void
+	{
+		auto frames = m_RunAhead.load();
+
+		if (frames == 0)
+		{
+			RunFrame();
+			return;
+		}
+
+		m_PPU.SetOutputEnabled(false);
+
+		if (!RunFrame())
+		{
+			m_PPU.SetOutputEnabled(true);
+			return;
+		}
+
+		SaveState(*m_RunAheadState);
+
+		bool frameCompleted{ true };
+
+		for (std::uint32_t frame = 1; frame < frames && frameCompleted; frame++)
+			frameCompleted = RunFrame();
+
+		m_PPU.SetOutputEnabled(true);
+
+		// Stopped while running ahead, the console still goes back to the frame the input applies to
+		if (frameCompleted)
+			RunFrame();
+
+		LoadState(*m_RunAheadState);
+	}
+
+	auto System::Execute() -> void
+	{
+		std::println("Starting system");
+
+		m_Executing.store(true);
+
+		Reset();
+
+		auto framesPerSecond = 1e9 / GetFramePeriod(m_FrequencyType).count();
+
+		auto sampleCPUTime = GetThreadCPUTime();
+		auto sampleFrame = m_FrameCount;
+
+		m_FramePacer.Reset();
+
+		while (m_Executing.load())
+		{
+			if (m_PowerHandler.GetState() == PowerState::Off)
+				m_PowerHandler.SetState(PowerState::Suspended);
+
+			if (m_PowerHandler.GetState() == PowerState::Suspended)
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_CV.wait(lock, [&] {
+					return m_PowerHandler.GetState() != PowerState::Suspended || m_Executing.load() == 0;
+				});
+
+				m_FramePacer.Reset();
+				continue;
+			}
+
+			if (m_PowerHandler.GetState() == PowerState::SingleStep)
+			{
+				StepInstruction();
+				m_PowerHandler.SetState(PowerState::Suspended);
+				continue;
+			}
+
+			if (m_RewindBuffer && m_Rewinding.load())
+			{
+				// Shows the frame that follows each recorded state, and holds on the oldest one
+				if (m_RewindBuffer->StepBack(*m_RewindState) && LoadState(*m_RewindState))
+					RunFrame();
+
+				// The frame count runs backwards, host cost is sampled again once rewinding stops
+				sampleCPUTime = GetThreadCPUTime();
+				sampleFrame = m_FrameCount;
+			}
+			else
+			{
+				RunFrameAhead();
+
+				if (m_RewindBuffer)
+				{
+					if (auto state = m_RewindBuffer->BeginCapture())
+					{
+						SaveState(*state);
+						m_RewindBuffer->EndCapture();
+					}
+				}
+			}
+
+			m_FramePacer.WaitForNextFrame();
+
+			// Host cost per emulated second
+			if (m_FrameCount - sampleFrame >= framesPerSecond)
+			{
+				auto cpuTime = GetThreadCPUTime();
+				auto emulatedSeconds = (m_FrameCount - sampleFrame) / framesPerSecond;
+
+				m_HostCPUTimePerEmulatedSecond.store(std::chrono::duration<double, std::nano>(cpuTime - sampleCPUTime).count() / 1e6 / emulatedSeconds);
+
+				sampleCPUTime = cpuTime;
+				sampleFrame = m_FrameCount;
+			}
+		}
+
+		std::println("Stopping system");
+	}
+
+	auto System::Stop() -> void
+	{
+		m_Executing.store(false);
+		m_CV.notify_all();
+	}
+
+	auto System::UpdatePowerState() -> void
+	{
+		m_CV.notify_all();
+	}
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "emu/apu/apu.h"
+#include "emu/cpu6502/cpu.h"
+#include "emu/ppu/ppu.h"
+#include "emu/system/framepacer.h"
+#include "emu/system/powerhandler.h"
+#include "emu/system/rewindbuffer.h"
+#include "emu/system/savestate.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+
+namespace emu
+{
+
+	// Runs the CPU on a single thread and catches the PPU and APU up whenever it reaches the end of a
+	// scanline, the only point where the PPU changes anything the CPU can see. Wall-clock pacing is
+	// applied once per emulated frame by the FramePacer.
+	class System
+	{
+	public:
+		System() = delete;
+		explicit System(PowerHandler& powerHandler, CPU& cpu, PPU& ppu, APU& apu);
+
+		auto Stop() -> void;
+		auto UpdatePowerState() -> void;
+
+		auto Execute() -> void;
+
+		auto Reset() -> void;
+
+		// Runs until the PPU completes a frame. False when the CPU stopped first, suspended by an invalid
+		// opcode or the frontend, or without making progress.
+		auto RunFrame() -> bool;
+
+		// Runs the frame the input applies to hidden, then SetRunAhead frames further from a snapshot and
+		// shows the last one, which hides that many frames of the game's input lag. 0 runs one plain frame.
+		auto RunFrameAhead() -> void;
+		auto SetRunAhead(std::uint32_t frames) -> void { m_RunAhead.store(frames); }
+		auto GetRunAhead() const -> std::uint32_t { return m_RunAhead.load(); }
+		auto StepInstruction() -> bool;
+
+		auto SetFrequencyType(FrequencyType frequencyType) -> void;
+
+		auto GetFrameCount() const -> std::uint64_t { return m_FrameCount; }
+
+		// Whole console in the binary save state layout. Call between instructions on the emulation
+		// thread, or while it is suspended. LoadState rejects states of another version or cartridge board.
+		auto SaveState(MachineState& state) const -> void;
+		auto LoadState(const MachineState& state) -> bool;
+
+		// Records one state per frame while running, rewinding plays them back one per frame. Set up
+		// before Execute, SetRewinding may be called from any thread.
+		auto EnableRewind(std::uint32_t frames) -> void;
+		auto SetRewinding(bool rewinding) -> void { m_Rewinding.store(rewinding); }
+		auto GetRewindBuffer() const -> const RewindBuffer* { return m_RewindBuffer.get(); }
+
+		// Host thread CPU time spent per emulated second, updated once per emulated second
+		auto GetHostCPUTimePerEmulatedSecond() const -> std::chrono::duration<double, std::milli> { return std::chrono::duration<double, std::milli>(m_HostCPUTimePerEmulatedSecond.load()); }
+
+	private:
+		// Clocks the PPU and APU for cycles the CPU has run, true when that completed a frame
+		auto CatchUp(std::uint32_t cycles) -> bool;
+
+	private:
+		PowerHandler& m_PowerHandler;
+		CPU& m_CPU;
+		PPU& m_PPU;
+		APU& m_APU;
+
+		std::uint64_t m_FrameCount{ 0 };
+
+		FrequencyType m_FrequencyType{ FrequencyType::NTSC };
+		FramePacer m_FramePacer{ FrequencyType::NTSC };
+
+		std::atomic<double> m_HostCPUTimePerEmulatedSecond{ 0.0 };
+
+		std::unique_ptr<RewindBuffer> m_RewindBuffer{};
+		std::unique_ptr<MachineState> m_RewindState{};
+		std::atomic<bool> m_Rewinding{ false };
+
+		std::unique_ptr<MachineState> m_RunAheadState{ std::make_unique<MachineState>() };
+		std::atomic<std::uint32_t> m_RunAhead{ 0 };
+
+		std::atomic<bool> m_Executing{ false };
+
+		std::condition_variable m_CV{};
+		std::mutex m_Mutex{};
+	};
+
+
+}
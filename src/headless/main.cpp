@@ -0,0 +1,86 @@
+#include "emu/apu/apu.h"
+#include "emu/cartridge/cartridge.h"
+#include "emu/cpu6502/cpu.h"
+#include "emu/memory/memorymanager.h"
+#include "emu/ppu/ppu.h"
+#include "emu/system/hash.h"
+#include "emu/system/powerhandler.h"
+#include "emu/system/system.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <print>
+#include <string>
+
+
+// Runs a ROM without any display for a fixed number of frames, as fast as the host allows
+
+constexpr std::uint64_t DefaultFrameCount = 600;
+
+
+auto main(int argc, char** argv) -> int
+{
+	if (argc < 2)
+	{
+		std::println("Usage: rexxnes-headless <rom file> [frame count] [--recompiler] [--idle-skip]");
+		return -1;
+	}
+
+	std::filesystem::path romPath = argv[1];
+	std::uint64_t frameCount = argc > 2 ? std::stoull(argv[2]) : DefaultFrameCount;
+	bool recompiler{ false };
+	bool idleSkip{ false };
+
+	for (int arg = 3; arg < argc; arg++)
+	{
+		recompiler = recompiler || std::string(argv[arg]) == "--recompiler";
+		idleSkip = idleSkip || std::string(argv[arg]) == "--idle-skip";
+	}
+
+	if (!std::filesystem::exists(romPath))
+	{
+		std::println("ROM file not found: {}", romPath.string());
+		return -1;
+	}
+
+	emu::Cartridge cartridge(romPath);
+	emu::Controller controller;
+	emu::MemoryManager memoryManager(cartridge, controller);
+
+	emu::PowerHandler powerHandler{ emu::PowerState::Run };
+
+	emu::PPU ppu{ powerHandler, memoryManager, cartridge.GetAttributes().NametableMirroring };
+	emu::APU apu{ powerHandler, memoryManager };
+	emu::CPU cpu{ powerHandler, memoryManager };
+
+	emu::System system{ powerHandler, cpu, ppu, apu };
+
+	cpu.SetRecompilerEnabled(recompiler);
+	cpu.SetIdleSkipEnabled(idleSkip);
+	system.Reset();
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	std::uint64_t framesRun{ 0 };
+
+	// Nothing resumes a suspended console here, stop at the first frame that does not complete
+	while (framesRun < frameCount && system.RunFrame())
+		framesRun++;
+
+	auto endTime = std::chrono::steady_clock::now();
+	auto seconds = std::chrono::duration<double>(endTime - startTime).count();
+
+	std::println("Frames           : {} of {}", framesRun, frameCount);
+	std::println("Elapsed time     : {:.3f} s", seconds);
+	std::println("Frames/second    : {:.1f}", framesRun / seconds);
+	std::println("Framebuffer hash : {:016x}", emu::HashBytes(ppu.GetFrameExchange().AcquireLatest().Pixels));
+
+	if (recompiler)
+		std::println("Compiled blocks  : {}", cpu.GetRecompiler().GetCompiledBlocks());
+
+	if (idleSkip)
+		std::println("Skipped cycles   : {} of {}", cpu.GetSkippedCycles(), cpu.GetCycles());
+
+	return framesRun == frameCount ? 0 : -1;
+}
@@ -1,41 +1,43 @@
 #include "input/controller.h"
 
-#include <array>
-
 
 namespace emu
 {
 
 
-	static std::array<bool, 8> ButtonState;
-	static std::uint8_t DataLatch{};
-
 	auto Controller::SetState(Button button, bool pressed) -> void
 	{
-		ButtonState[static_cast<uint8_t>(button)] = pressed;
+		auto bit = static_cast<std::uint8_t>(1 << static_cast<std::uint8_t>(button));
+
+		if (pressed)
+			m_ButtonBits.fetch_or(bit);
+		else
+			m_ButtonBits.fetch_and(static_cast<std::uint8_t>(~bit));
 	}
 
-	auto Controller::GetButtonBits() -> std::uint8_t
+	auto Controller::SetButtonBits(std::uint8_t bits) -> void
 	{
-		std::uint8_t bitfield{};
-
-		for (std::uint8_t i = 0; i < 8; i++)
-		{
-			if (ButtonState[i])
-				bitfield |= 1 << i;
-		}
+		m_ButtonBits.store(bits);
+	}
 
-		return bitfield;
+	auto Controller::GetButtonBits() -> std::uint8_t
+	{
+		return m_ButtonBits.load();
 	}
 
 	auto Controller::LatchData() -> void
 	{
-		DataLatch = GetButtonBits();
+		m_DataLatch = GetButtonBits();
 	}
 
 	auto Controller::GetData() -> std::uint8_t
 	{
-		return DataLatch;
+		return m_DataLatch;
+	}
+
+	auto Controller::SetData(std::uint8_t data) -> void
+	{
+		m_DataLatch = data;
 	}
 
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 
 
@@ -21,12 +22,19 @@ namespace emu
 	class Controller
 	{
 	public:
-		static auto SetState(Button button, bool pressed) -> void;
+		auto SetState(Button button, bool pressed) -> void;
+		auto SetButtonBits(std::uint8_t bits) -> void;
 
-		static auto GetButtonBits() -> std::uint8_t;
+		auto GetButtonBits() -> std::uint8_t;
 
-		static auto LatchData() -> void;
-		static auto GetData() -> std::uint8_t;
+		auto LatchData() -> void;
+		auto GetData() -> std::uint8_t;
+		auto SetData(std::uint8_t data) -> void;
+
+	private:
+		// Written by the frontend thread, latched by the emulation thread
+		std::atomic<std::uint8_t> m_ButtonBits{};
+		std::uint8_t m_DataLatch{};
 
 	};
 
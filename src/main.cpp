@@ -1,3 +1,5 @@
+#include "display/memoryviewer.h"
+#include "display/paletteviewer.h"
 #include "display/texture.h"
 #include "emu/apu/apu.h"
 #include "emu/cartridge/cartridge.h"
@@ -5,6 +7,7 @@
 #include "emu/memory/memorymanager.h"
 #include "emu/ppu/ppu.h"
 #include "emu/system/powerhandler.h"
+#include "emu/system/system.h"
 #include "input/controller.h"
 
 #include <glad/glad.h>
@@ -15,6 +18,7 @@
 #include "backends/imgui_impl_opengl3.h"
 
 #include <cstdint>
+#include <format>
 #include <fstream>
 #include <memory>
 #include <print>
@@ -22,6 +26,9 @@
 #include <vector>
 
 
+// History kept for rewinding
+constexpr double RewindSeconds = 60.0;
+
 
 auto main() -> int
 {
@@ -44,53 +51,58 @@ auto main() -> int
 
 	glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int scancode, int action, int mods)
 		{
+			auto controller = static_cast<emu::Controller*>(glfwGetWindowUserPointer(window));
+
+			if (controller == nullptr)
+				return;
+
 			switch (key)
 			{
 				case 32:
 				{
-					emu::Controller::SetState(emu::Button::Select, action == GLFW_PRESS || action == GLFW_REPEAT);
+					controller->SetState(emu::Button::Select, action == GLFW_PRESS || action == GLFW_REPEAT);
 					break;
 				}
 
 				case 257:
 				{
-					emu::Controller::SetState(emu::Button::Start, action == GLFW_PRESS || action == GLFW_REPEAT);
+					controller->SetState(emu::Button::Start, action == GLFW_PRESS || action == GLFW_REPEAT);
 					break;
 				}
 
 				case 262:
 				{
-					emu::Controller::SetState(emu::Button::Right, action == GLFW_PRESS || action == GLFW_REPEAT);
+					controller->SetState(emu::Button::Right, action == GLFW_PRESS || action == GLFW_REPEAT);
 					break;
 				}
 
 				case 263:
 				{
-					emu::Controller::SetState(emu::Button::Left, action == GLFW_PRESS || action == GLFW_REPEAT);
+					controller->SetState(emu::Button::Left, action == GLFW_PRESS || action == GLFW_REPEAT);
 					break;
 				}
 
 				case 264:
 				{
-					emu::Controller::SetState(emu::Button::Down, action == GLFW_PRESS || action == GLFW_REPEAT);
+					controller->SetState(emu::Button::Down, action == GLFW_PRESS || action == GLFW_REPEAT);
 					break;
 				}
 
 				case 265:
 				{
-					emu::Controller::SetState(emu::Button::Up, action == GLFW_PRESS || action == GLFW_REPEAT);
+					controller->SetState(emu::Button::Up, action == GLFW_PRESS || action == GLFW_REPEAT);
 					break;
 				}
 
 				case 341:
 				{
-					emu::Controller::SetState(emu::Button::A, action == GLFW_PRESS || action == GLFW_REPEAT);
+					controller->SetState(emu::Button::A, action == GLFW_PRESS || action == GLFW_REPEAT);
 					break;
 				}
 
 				case 342:
 				{
-					emu::Controller::SetState(emu::Button::B, action == GLFW_PRESS || action == GLFW_REPEAT);
+					controller->SetState(emu::Button::B, action == GLFW_PRESS || action == GLFW_REPEAT);
 					break;
 				}
 
@@ -125,7 +137,10 @@ auto main() -> int
 	emu::Cartridge cartridge("rom/SuperMarioBros.nes");
 //	emu::Cartridge cartridge("rom/controller.nes");
 //	emu::Cartridge cartridge("rom/DonkeyKong.nes");
-	emu::MemoryManager memoryManager(cartridge);
+	emu::Controller controller;
+	emu::MemoryManager memoryManager(cartridge, controller);
+
+	glfwSetWindowUserPointer(window, &controller);
 
 	emu::PowerHandler powerHandler{ emu::PowerState::Off };
 
@@ -133,14 +148,20 @@ auto main() -> int
 	emu::APU apu{ powerHandler, memoryManager };
 	emu::CPU cpu{ powerHandler, memoryManager };
 
-	std::thread cpuThread(&emu::CPU::Execute, &cpu, 0);
-//	std::thread cpuThread(&emu::CPU::Execute, &cpu, 0xBFFC);
-	std::thread ppuThread(&emu::PPU::Execute, &ppu);
-	std::thread apuThread(&emu::APU::Execute, &apu);
+	emu::System system{ powerHandler, cpu, ppu, apu };
+	auto frequencyType = cartridge.GetAttributes().TVSystem == 1 ? emu::FrequencyType::PAL : emu::FrequencyType::NTSC;
+	auto framesPerSecond = 1e9 / emu::GetFramePeriod(frequencyType).count();
+
+	system.SetFrequencyType(frequencyType);
+	system.EnableRewind(static_cast<std::uint32_t>(framesPerSecond * RewindSeconds));
+
+	std::thread systemThread(&emu::System::Execute, &system);
 
 
 	emu::Texture displayTexture{ 256u, 240u };
 
+	emu::VRAMSnapshot vramSnapshot{};
+
 
 	while (!glfwWindowShouldClose(window))
 	{
@@ -186,6 +207,10 @@ auto main() -> int
 
 			ImGui::Separator();
 
+			ImGui::Text("Host CPU : %.1f ms / emulated s", system.GetHostCPUTimePerEmulatedSecond().count());
+
+			ImGui::Separator();
+
 			ImGui::Text("Execution control");
 
 			//			if (ImGui::Button("Run")) cpu.SetRunningMode(emu::RunningMode::Run);
@@ -197,8 +222,7 @@ auto main() -> int
 			if (ImGui::Button("Run"))
 			{
 				powerHandler.SetState(emu::PowerState::Run);
-				cpu.UpdatePowerState();
-				ppu.UpdatePowerState();
+				system.UpdatePowerState();
 			}
 
 			ImGui::SameLine();
@@ -206,8 +230,7 @@ auto main() -> int
 			if (ImGui::Button("Halt"))
 			{
 				powerHandler.SetState(emu::PowerState::Suspended);
-				cpu.UpdatePowerState();
-				ppu.UpdatePowerState();
+				system.UpdatePowerState();
 			}
 
 			ImGui::SameLine();
@@ -215,8 +238,7 @@ auto main() -> int
 			if (ImGui::Button("Step"))
 			{
 				powerHandler.SetState(emu::PowerState::SingleStep);
-				cpu.UpdatePowerState();
-				ppu.UpdatePowerState();
+				system.UpdatePowerState();
 			}
 
 			ImGui::Separator();
@@ -226,28 +248,72 @@ auto main() -> int
 				cpu.StepToRTS();
 
 				powerHandler.SetState(emu::PowerState::Run);
-				cpu.UpdatePowerState();
-				ppu.UpdatePowerState();
+				system.UpdatePowerState();
 			}
 
 			ImGui::SameLine();
-			if (ImGui::Button("Trigger NMI")) cpu.TriggerNMI();
+			if (ImGui::Button("Trigger NMI")) memoryManager.TriggerNMI();
+
+			ImGui::Separator();
+
+			bool blockCache = cpu.IsBlockCacheEnabled();
+
+			if (ImGui::Checkbox("Block cache", &blockCache))
+				cpu.SetBlockCacheEnabled(blockCache);
+
+			bool recompiler = cpu.IsRecompilerEnabled();
+
+			if (ImGui::Checkbox("Recompiler", &recompiler))
+				cpu.SetRecompilerEnabled(recompiler);
+
+			bool idleSkip = cpu.IsIdleSkipEnabled();
+
+			if (ImGui::Checkbox("Idle loop skip", &idleSkip))
+				cpu.SetIdleSkipEnabled(idleSkip);
+
+			if (idleSkip)
+				ImGui::Text("Skipped cycles : %llu", static_cast<unsigned long long>(cpu.GetSkippedCycles()));
+
+			int runAhead = static_cast<int>(system.GetRunAhead());
+
+			if (ImGui::SliderInt("Run-ahead", &runAhead, 0, 4))
+				system.SetRunAhead(static_cast<std::uint32_t>(runAhead));
+
+			ImGui::Button("Hold to rewind");
+			system.SetRewinding(ImGui::IsItemActive());
+
+			if (auto rewindBuffer = system.GetRewindBuffer())
+			{
+				auto seconds = rewindBuffer->GetFrameCount() / framesPerSecond;
+				auto kilobytes = rewindBuffer->GetMemoryUsage() / 1024.0;
+
+				auto rewindStatus = std::format("Rewind : {:.1f} s in {:.0f} KB, {:.1f} KB / s", seconds, kilobytes, seconds > 0.0 ? kilobytes / seconds : 0.0);
+				ImGui::Text("%s", rewindStatus.c_str());
+
+				if (rewindBuffer->GetSkippedCaptures())
+					ImGui::Text("Skipped captures : %llu", static_cast<unsigned long long>(rewindBuffer->GetSkippedCaptures()));
+			}
 
 			ImGui::End();
 		}
 
-		memoryManager.ViewMemory();
+		memoryManager.SnapshotVRAM(vramSnapshot);
+
+		emu::ViewMemory(memoryManager, vramSnapshot);
+		emu::ViewPalette(vramSnapshot.PaletteColors);
 
 		{
 			ImGui::Begin("Graphics");
 
-			//			ppu.GenerateImageData(imageData);
-			while (ppu.IsDrawing())
-				;
+			auto& frameExchange = ppu.GetFrameExchange();
+			auto frame = frameExchange.AcquireLatest();
 
-			displayTexture.SetData(ppu.GetImageData());
+			displayTexture.SetData(frame.Pixels);
 			ImGui::Image(displayTexture.GetTexture(), ImVec2{ 512, 480 });
 
+			auto frameStatus = std::format("Frame {}  dropped {}  duplicated {}", frame.Sequence, frameExchange.GetDroppedFrames(), frameExchange.GetDuplicatedFrames());
+			ImGui::Text("%s", frameStatus.c_str());
+
 			ImGui::End();
 		}
 
@@ -258,13 +324,9 @@ auto main() -> int
 
 	}
 
-	cpu.Stop();
-	ppu.Stop();
-	apu.Stop();
+	system.Stop();
 
-	apuThread.join();
-	ppuThread.join();
-	cpuThread.join();
+	systemThread.join();
 
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
@@ -1,236 +1,522 @@
 #include <gtest/gtest.h>
 
+#include "emu/cartridge/cartridge.h"
 #include "emu/cpu6502/cpu.h"
-#include "emu/memory/dma.h"
-#include <print>
+#include "emu/memory/memorymanager.h"
+#include "emu/system/powerhandler.h"
+#include "testsupport.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <random>
 #include <vector>
 
 
-TEST(CpuTests, LDA_ImmediateAddressing)
+// Programs are executed from CPU RAM at ProgramAddress, on top of an empty NROM cartridge
+
+constexpr std::uint16_t ProgramAddress = 0x0200;
+
+
+class CpuTests : public ::testing::Test
 {
-	emu::Memory memory(16);
-	std::vector<uint8_t> program{ 0xA9, 0xCD };
-	memory.InstallROM(0x1000, program);
+protected:
+	auto Run(const std::vector<std::uint8_t>& program, std::size_t instructionCount) -> void
+	{
+		for (std::size_t i = 0; i < program.size(); i++)
+		{
+			m_MemoryManager.WriteBus(ProgramAddress + static_cast<std::uint16_t>(i), program[i]);
+		}
 
-	emu::DMA oamDMA{ 0x4014, memory, memory };
-	emu::DMA dmcDMA{ 0x4015, memory, memory };
-	emu::CPU cpu(memory, oamDMA, dmcDMA);
+		m_CPU.GetRegisters().PC = ProgramAddress;
 
-	cpu.Execute(0x1000);
-	auto& registers = cpu.GetRegisters();
+		for (std::size_t i = 0; i < instructionCount; i++)
+		{
+			m_CPU.Step();
+		}
+	}
 
-	ASSERT_EQ(registers.A, 0xCD);
-}
+	emu::Cartridge m_Cartridge{ EmptyCartridgePath() };
+	emu::Controller m_Controller;
+	emu::MemoryManager m_MemoryManager{ m_Cartridge, m_Controller };
+	emu::PowerHandler m_PowerHandler{ emu::PowerState::Run };
+	emu::CPU m_CPU{ m_PowerHandler, m_MemoryManager };
+};
 
-TEST(CpuTests, LDX_ImmediateAddressing)
+
+TEST_F(CpuTests, LDA_ImmediateAddressing)
 {
-	emu::Memory memory{ 16 };
-	std::vector<uint8_t> program{ 0xA2, 0xCD };
-	memory.InstallROM(0x1000, program);
+	Run({ 0xA9, 0xCD }, 1);
+	auto& registers = m_CPU.GetRegisters();
 
-	emu::DMA oamDMA{ 0x4014, memory, memory };
-	emu::DMA dmcDMA{ 0x4015, memory, memory };
-	emu::CPU cpu(memory, oamDMA, dmcDMA);
+	ASSERT_EQ(registers.A, 0xCD);
+}
 
-	cpu.Execute(0x1000);
-	auto& registers = cpu.GetRegisters();
+TEST_F(CpuTests, LDX_ImmediateAddressing)
+{
+	Run({ 0xA2, 0xCD }, 1);
+	auto& registers = m_CPU.GetRegisters();
 
 	ASSERT_EQ(registers.X, 0xCD);
 }
 
-TEST(CpuTests, LDY_ImmediateAddressing)
+TEST_F(CpuTests, LDY_ImmediateAddressing)
 {
-	emu::Memory memory{ 16 };
-	std::vector<uint8_t> program{ 0xA0, 0xCD };
-	memory.InstallROM(0x1000, program);
-
-	emu::DMA oamDMA{ 0x4014, memory, memory };
-	emu::DMA dmcDMA{ 0x4015, memory, memory };
-	emu::CPU cpu(memory, oamDMA, dmcDMA);
-
-	cpu.Execute(0x1000);
-	auto& registers = cpu.GetRegisters();
+	Run({ 0xA0, 0xCD }, 1);
+	auto& registers = m_CPU.GetRegisters();
 
 	ASSERT_EQ(registers.Y, 0xCD);
 }
 
 
-TEST(CpuTests, LDA_AbsoluteAddressing)
+TEST_F(CpuTests, LDA_AbsoluteAddressing)
 {
-	emu::Memory memory{ 16 };
-	std::vector<uint8_t> program{ 0xAD, 0x03, 0x10, 0x35 };
-	memory.InstallROM(0x1000, program);
-
-	emu::DMA oamDMA{ 0x4014, memory, memory };
-	emu::DMA dmcDMA{ 0x4015, memory, memory };
-	emu::CPU cpu(memory, oamDMA, dmcDMA);
-
-	cpu.Execute(0x1000);
-	auto& registers = cpu.GetRegisters();
+	Run({ 0xAD, 0x03, 0x02, 0x35 }, 1);
+	auto& registers = m_CPU.GetRegisters();
 
 	ASSERT_EQ(registers.A, 0x35);
 }
 
-TEST(CpuTests, LDX_AbsoluteAddressing)
+TEST_F(CpuTests, LDX_AbsoluteAddressing)
 {
-	emu::Memory memory{ 16 };
-	std::vector<uint8_t> program{ 0xAE, 0x03, 0x10, 0x35 };
-	memory.InstallROM(0x1000, program);
-
-	emu::DMA oamDMA{ 0x4014, memory, memory };
-	emu::DMA dmcDMA{ 0x4015, memory, memory };
-	emu::CPU cpu(memory, oamDMA, dmcDMA);
-
-	cpu.Execute(0x1000);
-	auto& registers = cpu.GetRegisters();
+	Run({ 0xAE, 0x03, 0x02, 0x35 }, 1);
+	auto& registers = m_CPU.GetRegisters();
 
 	ASSERT_EQ(registers.X, 0x35);
 }
 
-TEST(CpuTests, LDY_AbsoluteAddressing)
+TEST_F(CpuTests, LDY_AbsoluteAddressing)
 {
-	emu::Memory memory{ 16 };
-	std::vector<uint8_t> program{ 0xAC, 0x03, 0x10, 0x35 };
-	memory.InstallROM(0x1000, program);
+	Run({ 0xAC, 0x03, 0x02, 0x35 }, 1);
+	auto& registers = m_CPU.GetRegisters();
+
+	ASSERT_EQ(registers.Y, 0x35);
+}
 
-	emu::DMA oamDMA{ 0x4014, memory, memory };
-	emu::DMA dmcDMA{ 0x4015, memory, memory };
-	emu::CPU cpu(memory, oamDMA, dmcDMA);
 
-	cpu.Execute(0x1000);
-	auto& registers = cpu.GetRegisters();
+TEST_F(CpuTests, LDA_AbsoluteAddressingOffset)
+{
+	Run({ 0xA2, 0x01, 0xBD, 0x05, 0x02, 0x35, 0x17 }, 2);
+	auto& registers = m_CPU.GetRegisters();
 
-	ASSERT_EQ(registers.Y, 0x35);
+	ASSERT_EQ(registers.A, 0x17);
 }
 
 
-TEST(CpuTests, LDA_AbsoluteAddressingOffset)
+
+TEST_F(CpuTests, STA_Zeropage)
 {
-	emu::Memory memory{ 16 };
-	std::vector<uint8_t> program{ 0xA2, 0x01, 0xBD, 0x05, 0x10, 0x35, 0x17 };
-	memory.InstallROM(0x1000, program);
+	Run({ 0xA9, 0x25, 0x85, 0x02 }, 2);
 
-	emu::DMA oamDMA{ 0x4014, memory, memory };
-	emu::DMA dmcDMA{ 0x4015, memory, memory };
-	emu::CPU cpu(memory, oamDMA, dmcDMA);
+	ASSERT_EQ(m_MemoryManager.ReadBus(0x0002), 0x25);
+}
 
-	cpu.Execute(0x1000);
-	auto& registers = cpu.GetRegisters();
+TEST_F(CpuTests, STX_Zeropage)
+{
+	Run({ 0xA2, 0x31, 0x86, 0xc2 }, 2);
 
-	ASSERT_EQ(registers.A, 0x17);
+	ASSERT_EQ(m_MemoryManager.ReadBus(0x00c2), 0x31);
 }
 
+TEST_F(CpuTests, STA_IndirectIndexed)
+{
+	m_MemoryManager.WriteBus(0x02, 0x00);
+	m_MemoryManager.WriteBus(0x03, 0x01);
+	Run({ 0xA9, 0x12, 0xA0, 0x03, 0x91, 0x02 }, 3);
+
+	ASSERT_EQ(m_MemoryManager.ReadBus(0x0103), 0x12);
+}
 
 
-TEST(CpuTests, STA_Zeropage)
+TEST_F(CpuTests, DEY_Implied)
 {
-	emu::Memory memory{ 16 };
-	std::vector<uint8_t> program{ 0xA9, 0x25, 0x85, 0x02 };
-	memory.InstallROM(0x1000, program);
+	Run({ 0xA0, 0x10, 0x88 }, 2);
+	auto& registers = m_CPU.GetRegisters();
 
-	emu::DMA oamDMA{ 0x4014, memory, memory };
-	emu::DMA dmcDMA{ 0x4015, memory, memory };
-	emu::CPU cpu(memory, oamDMA, dmcDMA);
+	ASSERT_EQ(registers.Y, 0x0F);
+}
 
-	cpu.Execute(0x1000);
-	auto& registers = cpu.GetRegisters();
 
-	ASSERT_EQ(memory.Read(0x0002), 0x25);
+TEST_F(CpuTests, CMP_Immediate)
+{
+	{
+		Run({ 0xA9, 0x45, 0xC9, 0x85 }, 2);
+		auto flags = m_CPU.GetFlags();
+
+		ASSERT_EQ((flags & 0b1000'0000) == 0x80, true);			// Negative
+		ASSERT_EQ((flags & 0b0000'0010) == 0x02, false);		// Zero
+		ASSERT_EQ((flags & 0b0000'0001) == 0x01, false);		// Carry (A < M)
+	}
+
+	{
+		Run({ 0xA9, 0x45, 0xC9, 0x28 }, 2);
+		auto flags = m_CPU.GetFlags();
+
+		ASSERT_EQ((flags & 0b1000'0000) == 0x80, false);		// Negative
+		ASSERT_EQ((flags & 0b0000'0010) == 0x02, false);		// Zero
+		ASSERT_EQ((flags & 0b0000'0001) == 0x01, true);			// Carry
+	}
+
+	{
+		Run({ 0xA9, 0x45, 0xC9, 0x45 }, 2);
+		auto flags = m_CPU.GetFlags();
+
+		ASSERT_EQ((flags & 0b1000'0000) == 0x80, false);		// Negative
+		ASSERT_EQ((flags & 0b0000'0010) == 0x02, true);			// Zero
+		ASSERT_EQ((flags & 0b0000'0001) == 0x01, true);			// Carry
+	}
 }
 
-TEST(CpuTests, STX_Zeropage)
+TEST_F(CpuTests, IRQ_RespectsInterruptFlag)
 {
-	emu::Memory memory{ 16 };
-	std::vector<uint8_t> program{ 0xA2, 0x31, 0x86, 0xc2 };
-	memory.InstallROM(0x1000, program);
+	// Handler at $0000, the vector at $FFFE of the empty cartridge points there
+	m_MemoryManager.WriteBus(0x0000, 0xA9);
+	m_MemoryManager.WriteBus(0x0001, 0x42);
 
-	emu::DMA oamDMA{ 0x4014, memory, memory };
-	emu::DMA dmcDMA{ 0x4015, memory, memory };
-	emu::CPU cpu(memory, oamDMA, dmcDMA);
+	auto& registers = m_CPU.GetRegisters();
+	registers.SetFlag(emu::FlagInterrupt, true);
+	m_MemoryManager.SetIRQLine(emu::IRQSource::Mapper, true);
 
-	cpu.Execute(0x1000);
-	auto& registers = cpu.GetRegisters();
+	Run({ 0xA2, 0x01 }, 1);
+
+	ASSERT_EQ(registers.X, 0x01);
+	ASSERT_EQ(registers.A, 0x00);
+
+	registers.SetFlag(emu::FlagInterrupt, false);
+	auto stackPointer = registers.SP;
+	auto cycles = m_CPU.Step();
 
-	ASSERT_EQ(memory.Read(0x00c2), 0x31);
+	ASSERT_EQ(registers.A, 0x42);
+	ASSERT_EQ(registers.PC, 0x0002);
+	ASSERT_EQ(cycles, 7 + 2);
+	ASSERT_EQ((m_CPU.GetFlags() & 0b0000'0100) == 0x04, true);		// Interrupt disabled in the handler
+
+	auto pushedFlags = m_MemoryManager.ReadBus(0x0100 + static_cast<std::uint8_t>(stackPointer - 2));
+	auto pushedPCLow = m_MemoryManager.ReadBus(0x0100 + static_cast<std::uint8_t>(stackPointer - 1));
+
+	ASSERT_EQ(pushedFlags & 0b0011'0100, 0x20);						// I and B clear, bit 5 set
+	ASSERT_EQ(pushedPCLow, 0x02);
 }
 
-TEST(CpuTests, STA_IndirectIndexed)
+TEST_F(CpuTests, BlockCache_MatchesInterpreterOnSelfModifyingCode)
 {
-	emu::Memory memory{ 16 };
-	memory.Write(0x02, 0x00);
-	memory.Write(0x03, 0x01);
-	std::vector<uint8_t> program{ 0xA9, 0x12, 0xA0, 0x03, 0x91, 0x02 };
-	memory.InstallROM(0x1000, program);
+	// LDA #$00 / INC $0201 / JMP $0200, every pass loads the operand the previous one incremented
+	std::vector<std::uint8_t> program{ 0xA9, 0x00, 0xEE, 0x01, 0x02, 0x4C, 0x00, 0x02 };
 
-	emu::DMA oamDMA{ 0x4014, memory, memory };
-	emu::DMA dmcDMA{ 0x4015, memory, memory };
-	emu::CPU cpu(memory, oamDMA, dmcDMA);
+	for (auto blockCache : { false, true })
+	{
+		m_CPU.SetBlockCacheEnabled(blockCache);
+		Run(program, 0);
 
-	cpu.Execute(0x1000);
-	auto& registers = cpu.GetRegisters();
+		// 2 + 6 + 3 cycles a pass, the budget ends in the middle of the eleventh
+		auto cycles = m_CPU.Run(10 * 11 + 1);
+		auto& registers = m_CPU.GetRegisters();
+
+		ASSERT_EQ(cycles, 10 * 11 + 2);
+		ASSERT_EQ(registers.A, 10);
+		ASSERT_EQ(registers.PC, ProgramAddress + 2);
+		ASSERT_EQ(m_MemoryManager.ReadBus(ProgramAddress + 1), 10);
+	}
+
+	// Rewritten from outside the CPU between two runs, the INC still to come adds one
+	m_MemoryManager.WriteBus(ProgramAddress + 1, 0x42);
+	m_CPU.Run(11);
+
+	ASSERT_EQ(m_CPU.GetRegisters().A, 0x43);
+}
 
-	ASSERT_EQ(memory.Read(0x0103), 0x12);
+TEST_F(CpuTests, BlockCache_LeavesBlockForIRQ)
+{
+	// Handler at $0000 loops on itself, the program clears I with PLP in front of three INX
+	m_MemoryManager.WriteBus(0x0000, 0xA9);
+	m_MemoryManager.WriteBus(0x0001, 0x42);
+	m_MemoryManager.WriteBus(0x0002, 0x4C);
+	m_MemoryManager.WriteBus(0x0003, 0x02);
+	m_MemoryManager.WriteBus(0x0004, 0x00);
+
+	auto& registers = m_CPU.GetRegisters();
+	registers.SetFlag(emu::FlagInterrupt, true);
+	m_MemoryManager.SetIRQLine(emu::IRQSource::Mapper, true);
+
+	Run({ 0x28, 0xE8, 0xE8, 0xE8, 0x4C, 0x00, 0x02 }, 0);
+	m_CPU.Run(30);
+
+	ASSERT_EQ(registers.X, 0x00);
+	ASSERT_EQ(registers.A, 0x42);
+	ASSERT_EQ(registers.PC, 0x0002);
 }
 
 
-TEST(CpuTests, DEY_Implied)
+TEST_F(CpuTests, IdleSkip_EndsLoopsLikeRunningThem)
 {
-	emu::Memory memory{ 16 };
-	std::vector<uint8_t> program{ 0xA0, 0x10, 0x88 };
-	memory.InstallROM(0x1000, program);
+	// LDA $2002 / BPL $0200 waits for vblank, then LDX #$01 / JMP $0207 spins
+	std::vector<std::uint8_t> program{ 0xAD, 0x02, 0x20, 0x10, 0xFB, 0xA2, 0x01, 0x4C, 0x07, 0x02 };
 
-	emu::DMA oamDMA{ 0x4014, memory, memory };
-	emu::DMA dmcDMA{ 0x4015, memory, memory };
-	emu::CPU cpu(memory, oamDMA, dmcDMA);
+	struct Slice
+	{
+		std::uint32_t Cycles{ 0 };
+		emu::Registers Registers{};
+	};
 
-	cpu.Execute(0x1000);
-	auto& registers = cpu.GetRegisters();
+	std::vector<Slice> slices[2];
 
-	ASSERT_EQ(registers.Y, 0x0F);
-}
+	for (auto idleSkip : { false, true })
+	{
+		m_CPU.SetIdleSkipEnabled(idleSkip);
+		m_CPU.GetRegisters() = emu::Registers{};
+		m_MemoryManager.ClearPPUIOBit(0x2002, 0x80);
+
+		Run(program, 0);
 
+		// Budgets of odd sizes, so the last pass of a slice ends somewhere inside the loop
+		for (std::uint32_t slice = 0; slice < 40; slice++)
+		{
+			if (slice == 20)
+				m_MemoryManager.SetPPUIOBit(0x2002, 0x80);
 
-TEST(CpuTests, CMP_Immediate)
+			auto cycles = m_CPU.Run(100 + slice * 7);
+			slices[idleSkip].push_back({ cycles, m_CPU.GetRegisters() });
+		}
+	}
+
+	for (std::size_t slice = 0; slice < slices[0].size(); slice++)
+	{
+		ASSERT_EQ(slices[1][slice].Cycles, slices[0][slice].Cycles) << "slice " << slice;
+		ASSERT_TRUE(slices[1][slice].Registers == slices[0][slice].Registers) << "slice " << slice;
+	}
+
+	ASSERT_EQ(slices[1].back().Registers.X, 0x01);
+	ASSERT_GT(m_CPU.GetSkippedCycles(), 0u);
+
+	// A loop that writes is run pass by pass
+	auto skippedCycles = m_CPU.GetSkippedCycles();
+
+	Run({ 0xE6, 0x10, 0x4C, 0x00, 0x02 }, 0);
+	m_CPU.Run(1000);
+
+	ASSERT_EQ(m_CPU.GetSkippedCycles(), skippedCycles);
+}
+
+// The status flags as they were kept before P was packed, every instruction updating them bit by bit
+struct ReferenceCPU
 {
-	emu::Memory memory{ 16 };
-	emu::DMA oamDMA{ 0x4014, memory, memory };
-	emu::DMA dmcDMA{ 0x4015, memory, memory };
-	emu::CPU cpu(memory, oamDMA, dmcDMA);
+	static constexpr std::size_t Carry = 0;
+	static constexpr std::size_t Zero = 1;
+	static constexpr std::size_t Interrupt = 2;
+	static constexpr std::size_t Decimal = 3;
+	static constexpr std::size_t Break = 4;
+	static constexpr std::size_t Overflow = 6;
+	static constexpr std::size_t Negative = 7;
+
+	auto SetNZ(std::uint8_t value) -> void
+	{
+		Flags[Negative] = value & 0x80;
+		Flags[Zero] = value == 0;
+	}
 
+	auto AddWithCarry(std::uint8_t value) -> void
 	{
-		std::vector<uint8_t> program{ 0xA9, 0x45, 0xC9, 0x85 };
-		memory.InstallROM(0x1000, program);
+		std::uint16_t result = A + value + Flags[Carry];
+		A = static_cast<std::uint8_t>(result);
 
+		Flags[Carry] = result & 0x100;
+		SetNZ(A);
+		Flags[Overflow] = ((A & 0x80) && !(value & 0x80)) || (!(A & 0x80) && (value & 0x80));
+	}
+
+	auto Compare(std::uint8_t reg, std::uint8_t value) -> void
+	{
+		SetNZ(static_cast<std::uint8_t>(reg - value));
+		Flags[Carry] = reg >= value;
+	}
 
-		cpu.Execute(0x1000);
-		auto flags = cpu.GetFlags();
+	auto Branch(std::size_t flag, bool condition, std::uint8_t operand) -> void
+	{
+		if (Flags[flag] == condition)
+			PC += static_cast<std::int8_t>(operand);
+	}
 
-		ASSERT_EQ((flags & 0b1000'0000) == 0x80, true);			// Negative
-		ASSERT_EQ((flags & 0b0000'0010) == 0x02, false);		// Zero
-		ASSERT_EQ((flags & 0b0000'0001) == 0x01, true);			// Carry
+	// operand is the immediate, the zero page value or the byte on top of the stack
+	auto Execute(std::uint8_t opCode, std::uint8_t operand) -> void
+	{
+		bool carry = Flags[Carry];
+		std::uint16_t size = 2;
+
+		switch (opCode)
+		{
+		case 0x08: Stack = static_cast<std::uint8_t>(Flags.to_ulong()); Flags[Break] = true; SP--; size = 1; break;
+		case 0x28: Flags = operand; SP++; size = 1; break;
+		case 0x09: A |= operand; SetNZ(A); break;
+		case 0x29: A &= operand; SetNZ(A); break;
+		case 0x49: A ^= operand; SetNZ(A); break;
+		case 0x69: AddWithCarry(operand); break;
+		case 0xe9: AddWithCarry(static_cast<std::uint8_t>(~operand)); break;
+		case 0xc9: Compare(A, operand); break;
+		case 0xe0: Compare(X, operand); break;
+		case 0xc0: Compare(Y, operand); break;
+		case 0xa9: A = operand; SetNZ(A); break;
+		case 0xa2: X = operand; SetNZ(X); break;
+		case 0xa0: Y = operand; SetNZ(Y); break;
+
+		case 0x24:
+			Flags[Zero] = (A & operand) == 0;
+			Flags[Negative] = operand & 0x80;
+			Flags[Overflow] = ((A & 0x80) && !(operand & 0x80)) || (!(A & 0x80) && (operand & 0x80));
+			break;
+
+		case 0xe6: Memory = operand + 1; SetNZ(Memory); break;
+		case 0xc6: Memory = operand - 1; SetNZ(Memory); break;
+		case 0x0a: Flags[Carry] = A & 0x80; A <<= 1; SetNZ(A); size = 1; break;
+		case 0x4a: Flags[Carry] = A & 0x01; A >>= 1; SetNZ(A); size = 1; break;
+		case 0x2a: Flags[Carry] = A & 0x80; A = static_cast<std::uint8_t>((A << 1) | carry); SetNZ(A); size = 1; break;
+		case 0x6a: Flags[Carry] = A & 0x01; A = static_cast<std::uint8_t>((A >> 1) | (carry ? 0x80 : 0x00)); SetNZ(A); size = 1; break;
+		case 0xe8: SetNZ(++X); size = 1; break;
+		case 0xca: SetNZ(--X); size = 1; break;
+		case 0xc8: SetNZ(++Y); size = 1; break;
+		case 0x88: SetNZ(--Y); size = 1; break;
+		case 0xaa: X = A; SetNZ(X); size = 1; break;
+		case 0xa8: Y = A; SetNZ(Y); size = 1; break;
+		case 0x8a: A = X; SetNZ(A); size = 1; break;
+		case 0x98: A = Y; SetNZ(A); size = 1; break;
+		case 0x18: Flags[Carry] = false; size = 1; break;
+		case 0x38: Flags[Carry] = true; size = 1; break;
+		case 0x78: Flags[Interrupt] = true; size = 1; break;
+		case 0xd8: Flags[Decimal] = false; size = 1; break;
+
+		case 0x10: PC += 2; Branch(Negative, false, operand); return;
+		case 0x30: PC += 2; Branch(Negative, true, operand); return;
+		case 0x90: PC += 2; Branch(Carry, false, operand); return;
+		case 0xb0: PC += 2; Branch(Carry, true, operand); return;
+		case 0xd0: PC += 2; Branch(Zero, false, operand); return;
+		case 0xf0: PC += 2; Branch(Zero, true, operand); return;
+		}
+
+		PC += size;
 	}
 
+	std::uint8_t A{};
+	std::uint8_t X{};
+	std::uint8_t Y{};
+	std::uint8_t SP{};
+	std::uint16_t PC{};
+	std::bitset<8> Flags{};
+	std::uint8_t Memory{};
+	std::uint8_t Stack{};
+};
+
+// Lazily evaluated N and Z against the reference, from random registers, flags and operands. Every
+// instruction runs on its own and the flags are read back through PHP's view of them after it.
+TEST_F(CpuTests, LazyFlags_MatchBitwiseFlags)
+{
+	constexpr std::uint8_t OperandAddress = 0x10;
+
+	std::mt19937 random(0x6502);
+	auto byte = [&random] { return static_cast<std::uint8_t>(random()); };
+
+	std::vector<std::uint8_t> opCodes
 	{
-		std::vector<uint8_t> program{ 0xA9, 0x45, 0xC9, 0x28 };
-		memory.InstallROM(0x1000, program);
+		0x08, 0x28, 0x09, 0x29, 0x49, 0x69, 0xe9, 0xc9, 0xe0, 0xc0, 0xa9, 0xa2, 0xa0, 0x24, 0xe6, 0xc6,
+		0x0a, 0x4a, 0x2a, 0x6a, 0xe8, 0xca, 0xc8, 0x88, 0xaa, 0xa8, 0x8a, 0x98, 0x18, 0x38, 0x78, 0xd8,
+		0x10, 0x30, 0x90, 0xb0, 0xd0, 0xf0,
+	};
 
-		cpu.Execute(0x1000);
-		auto flags = cpu.GetFlags();
+	auto& registers = m_CPU.GetRegisters();
 
-		ASSERT_EQ((flags & 0b1000'0000) == 0x80, false);		// Negative
-		ASSERT_EQ((flags & 0b0000'0010) == 0x02, false);		// Zero
-		ASSERT_EQ((flags & 0b0000'0001) == 0x01, true);			// Carry
+	for (auto opCode : opCodes)
+	{
+		for (std::uint32_t trial = 0; trial < 2000; trial++)
+		{
+			ReferenceCPU expected{ byte(), byte(), byte(), byte(), ProgramAddress, byte() };
+
+			// Zero and sign edges show up far more often than with uniform operands
+			std::uint8_t operand = trial % 4 == 0 ? expected.A : trial % 4 == 1 ? static_cast<std::uint8_t>(expected.A ^ 0x80) : byte();
+			bool zeropage = opCode == 0x24 || opCode == 0xe6 || opCode == 0xc6;
+
+			registers.A = expected.A;
+			registers.X = expected.X;
+			registers.Y = expected.Y;
+			registers.SP = expected.SP;
+			registers.SetP(static_cast<std::uint8_t>(expected.Flags.to_ulong()));
+
+			m_MemoryManager.WriteBus(OperandAddress, operand);
+			m_MemoryManager.WriteBus(0x0100 + static_cast<std::uint8_t>(expected.SP + 1), operand);
+			Run({ opCode, zeropage ? OperandAddress : operand }, 1);
+
+			expected.Execute(opCode, operand);
+
+			auto context = std::format("opcode {:02x} trial {}", opCode, trial);
+
+			ASSERT_EQ(registers.A, expected.A) << context;
+			ASSERT_EQ(registers.X, expected.X) << context;
+			ASSERT_EQ(registers.Y, expected.Y) << context;
+			ASSERT_EQ(registers.SP, expected.SP) << context;
+			ASSERT_EQ(registers.PC, expected.PC) << context;
+			ASSERT_EQ(m_CPU.GetFlags(), expected.Flags.to_ulong()) << context;
+
+			if (opCode == 0x08)
+			{
+				ASSERT_EQ(m_MemoryManager.ReadBus(0x0100 + static_cast<std::uint8_t>(expected.SP + 1)), expected.Stack) << context;
+			}
+
+			if (opCode == 0xe6 || opCode == 0xc6)
+			{
+				ASSERT_EQ(m_MemoryManager.ReadBus(OperandAddress), expected.Memory) << context;
+			}
+		}
 	}
+}
 
+// UxROM with two 16KB banks, each starting with LDA #bank / JMP $8000
+static auto BankedProgramPath() -> std::filesystem::path
+{
+	auto path = std::filesystem::temp_directory_path() / "rexxnes_cpu_tests_uxrom.nes";
+
+	std::vector<std::uint8_t> image(16);
+	image[0] = 'N';
+	image[1] = 'E';
+	image[2] = 'S';
+	image[3] = 0x1A;
+	image[4] = 2;
+	image[5] = 1;
+	image[6] = 0x20;
+
+	for (std::uint8_t bank = 0; bank < 2; bank++)
 	{
-		std::vector<uint8_t> program{ 0xA9, 0x45, 0xC9, 0x45 };
-		memory.InstallROM(0x1000, program);
+		std::vector<std::uint8_t> data(0x4000);
+		std::vector<std::uint8_t> code{ 0xA9, bank, 0x4C, 0x00, 0x80 };
+		std::copy(code.begin(), code.end(), data.begin());
 
-		cpu.Execute(0x1000);
-		auto flags = cpu.GetFlags();
+		image.insert(image.end(), data.begin(), data.end());
+	}
 
-		ASSERT_EQ((flags & 0b1000'0000) == 0x80, false);		// Negative
-		ASSERT_EQ((flags & 0b0000'0010) == 0x02, true);			// Zero
-		ASSERT_EQ((flags & 0b0000'0001) == 0x01, true);			// Carry
+	image.insert(image.end(), 0x2000, 0);
+
+	WriteCartridge(path, image);
+
+	return path;
+}
+
+TEST(BlockCacheTests, FollowsPRGBankSwitches)
+{
+	emu::Cartridge cartridge{ BankedProgramPath() };
+	emu::Controller controller;
+	emu::MemoryManager memoryManager{ cartridge, controller };
+	emu::PowerHandler powerHandler{ emu::PowerState::Run };
+	emu::CPU cpu{ powerHandler, memoryManager };
+
+	auto& registers = cpu.GetRegisters();
+	registers.PC = 0x8000;
+
+	for (std::uint8_t bank : std::vector<std::uint8_t>{ 0, 1, 0 })
+	{
+		memoryManager.WriteBus(0x8000, bank);
+		cpu.Run(50);
+
+		ASSERT_EQ(registers.A, bank);
 	}
+
+	// One block per bank at $8000, the first one is found again after switching back
+	ASSERT_EQ(cpu.GetBlockCache().GetBlockCount(), 2u);
 }
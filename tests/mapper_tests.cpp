@@ -0,0 +1,266 @@
+#include <gtest/gtest.h>
+
+#include "emu/cartridge/cartridge.h"
+#include "emu/memory/memorymanager.h"
+#include "emu/system/savestate.h"
+#include "testsupport.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <vector>
+
+
+// Every 8KB PRG bank and every 1KB CHR bank of the test images is filled with its own bank number,
+// so a single read tells which bank a window points at
+
+static auto BankedCartridgePath(std::uint8_t mapper, std::uint8_t prg16KBanks, std::uint8_t chr8KBanks) -> std::filesystem::path
+{
+	auto path = std::filesystem::temp_directory_path() / std::format("rexxnes_mapper_{}_{}_{}.nes", mapper, prg16KBanks, chr8KBanks);
+
+	std::vector<std::uint8_t> image(16);
+	image[0] = 'N';
+	image[1] = 'E';
+	image[2] = 'S';
+	image[3] = 0x1A;
+	image[4] = prg16KBanks;
+	image[5] = chr8KBanks;
+	image[6] = static_cast<std::uint8_t>((mapper & 0x0F) << 4);
+	image[7] = static_cast<std::uint8_t>(mapper & 0xF0);
+
+	for (std::uint32_t bank = 0; bank < prg16KBanks * 2u; bank++)
+		image.insert(image.end(), 0x2000, static_cast<std::uint8_t>(bank));
+
+	for (std::uint32_t bank = 0; bank < chr8KBanks * 8u; bank++)
+		image.insert(image.end(), 0x400, static_cast<std::uint8_t>(bank));
+
+	WriteCartridge(path, image);
+
+	return path;
+}
+
+
+class MapperTests : public ::testing::Test
+{
+protected:
+	auto Load(std::uint8_t mapper, std::uint8_t prg16KBanks, std::uint8_t chr8KBanks) -> void
+	{
+		m_MemoryManager.reset();
+		m_Cartridge = std::make_unique<emu::Cartridge>(BankedCartridgePath(mapper, prg16KBanks, chr8KBanks));
+		m_MemoryManager = std::make_unique<emu::MemoryManager>(*m_Cartridge, m_Controller);
+	}
+
+	auto PRGWindow(std::uint8_t window) -> std::uint8_t
+	{
+		return m_MemoryManager->ReadBus(0x8000 + window * 0x2000 + 0x123);
+	}
+
+	auto CHRWindow(std::uint8_t window) -> std::uint8_t
+	{
+		return m_MemoryManager->ReadCharROM(window * 0x400 + 0x45);
+	}
+
+	// MMC1 registers are loaded one bit per write, low bit first
+	auto WriteMMC1(std::uint16_t address, std::uint8_t value) -> void
+	{
+		for (auto bit = 0; bit < 5; bit++)
+			m_MemoryManager->WriteBus(address, (value >> bit) & 0x01);
+	}
+
+	std::unique_ptr<emu::Cartridge> m_Cartridge;
+	emu::Controller m_Controller;
+	std::unique_ptr<emu::MemoryManager> m_MemoryManager;
+};
+
+
+TEST_F(MapperTests, NROM_MirrorsSmallPRG)
+{
+	Load(0, 1, 1);
+
+	ASSERT_EQ(PRGWindow(0), 0);
+	ASSERT_EQ(PRGWindow(1), 1);
+	ASSERT_EQ(PRGWindow(2), 0);
+	ASSERT_EQ(PRGWindow(3), 1);
+	ASSERT_EQ(CHRWindow(7), 7);
+}
+
+TEST_F(MapperTests, UxROM_SwitchesLowerPRG)
+{
+	Load(2, 8, 0);
+
+	m_MemoryManager->WriteBus(0x8000, 3);
+
+	ASSERT_EQ(PRGWindow(0), 6);
+	ASSERT_EQ(PRGWindow(1), 7);
+	ASSERT_EQ(PRGWindow(2), 14);
+	ASSERT_EQ(PRGWindow(3), 15);
+}
+
+TEST_F(MapperTests, CNROM_SwitchesCHR)
+{
+	Load(3, 2, 4);
+
+	m_MemoryManager->WriteBus(0x8000, 2);
+
+	ASSERT_EQ(CHRWindow(0), 16);
+	ASSERT_EQ(CHRWindow(7), 23);
+}
+
+TEST_F(MapperTests, AxROM_SwitchesPRGAndSingleScreen)
+{
+	Load(7, 8, 0);
+
+	m_MemoryManager->WriteBus(0x8000, 0x12);
+
+	ASSERT_EQ(PRGWindow(0), 8);
+	ASSERT_EQ(PRGWindow(3), 11);
+	ASSERT_EQ(m_MemoryManager->GetNametableMirroring(), emu::NametableMirroring::SingleScreenUpper);
+}
+
+TEST_F(MapperTests, MMC1_SerialRegisters)
+{
+	Load(1, 8, 4);
+
+	// Power-on mode fixes the last 16KB at $C000
+	ASSERT_EQ(PRGWindow(3), 15);
+
+	// 16KB PRG switched at $8000, 4KB CHR banks, vertical mirroring
+	WriteMMC1(0x8000, 0x1E);
+	WriteMMC1(0xE000, 0x05);
+	WriteMMC1(0xA000, 0x03);
+	WriteMMC1(0xC000, 0x06);
+
+	ASSERT_EQ(PRGWindow(0), 10);
+	ASSERT_EQ(PRGWindow(1), 11);
+	ASSERT_EQ(PRGWindow(3), 15);
+	ASSERT_EQ(CHRWindow(0), 12);
+	ASSERT_EQ(CHRWindow(4), 24);
+	ASSERT_EQ(m_MemoryManager->GetNametableMirroring(), emu::NametableMirroring::Vertical);
+
+	// Bit 7 resets the shift register in the middle of a sequence
+	m_MemoryManager->WriteBus(0xE000, 0x01);
+	m_MemoryManager->WriteBus(0xE000, 0x80);
+	WriteMMC1(0xE000, 0x02);
+
+	ASSERT_EQ(PRGWindow(0), 4);
+}
+
+TEST_F(MapperTests, MMC3_BankModes)
+{
+	Load(4, 16, 8);
+
+	for (std::uint8_t index = 0; index < 8; index++)
+	{
+		m_MemoryManager->WriteBus(0x8000, index);
+		m_MemoryManager->WriteBus(0x8001, static_cast<std::uint8_t>(10 + index * 2));
+	}
+
+	ASSERT_EQ(PRGWindow(0), 22);
+	ASSERT_EQ(PRGWindow(1), 24);
+	ASSERT_EQ(PRGWindow(2), 30);
+	ASSERT_EQ(PRGWindow(3), 31);
+	ASSERT_EQ(CHRWindow(0), 10);
+	ASSERT_EQ(CHRWindow(1), 11);
+	ASSERT_EQ(CHRWindow(4), 14);
+
+	// PRG mode swaps $8000 and $C000, CHR inversion swaps the pattern tables
+	m_MemoryManager->WriteBus(0x8000, 0xC0);
+
+	ASSERT_EQ(PRGWindow(0), 30);
+	ASSERT_EQ(PRGWindow(2), 22);
+	ASSERT_EQ(CHRWindow(0), 14);
+	ASSERT_EQ(CHRWindow(4), 10);
+
+	m_MemoryManager->WriteBus(0xA000, 0x01);
+
+	ASSERT_EQ(m_MemoryManager->GetNametableMirroring(), emu::NametableMirroring::Horizontal);
+}
+
+TEST_F(MapperTests, MMC3_ScanlineIRQ)
+{
+	Load(4, 16, 8);
+
+	m_MemoryManager->WriteBus(0xC000, 2);
+	m_MemoryManager->WriteBus(0xC001, 0);
+	m_MemoryManager->WriteBus(0xE001, 0);
+
+	// Reload to 2, then count down to 0 on the third scanline
+	m_MemoryManager->ClockA12(2);
+	ASSERT_FALSE(m_MemoryManager->IsIRQAsserted());
+
+	m_MemoryManager->ClockA12(1);
+	ASSERT_TRUE(m_MemoryManager->IsIRQAsserted());
+
+	// $E000 acknowledges, the counter reloads from the latch on the next edge
+	m_MemoryManager->WriteBus(0xE000, 0);
+	ASSERT_FALSE(m_MemoryManager->IsIRQAsserted());
+
+	m_MemoryManager->WriteBus(0xE001, 0);
+	m_MemoryManager->ClockA12(3);
+	ASSERT_TRUE(m_MemoryManager->IsIRQAsserted());
+
+	// Other boards ignore A12
+	Load(1, 8, 4);
+	m_MemoryManager->ClockA12(10);
+	ASSERT_FALSE(m_MemoryManager->IsIRQAsserted());
+}
+
+TEST_F(MapperTests, MMC3_StateRestoresBoardRegisters)
+{
+	Load(4, 16, 8);
+
+	m_MemoryManager->WriteBus(0x8000, 0x46);
+	m_MemoryManager->WriteBus(0x8001, 5);
+	m_MemoryManager->WriteBus(0xC000, 2);
+	m_MemoryManager->WriteBus(0xC001, 0);
+	m_MemoryManager->WriteBus(0xE001, 0);
+
+	auto state = std::make_unique<emu::MemoryState>();
+	m_MemoryManager->SaveState(*state);
+
+	ASSERT_EQ(state->Board.MapperNumber, 4);
+
+	m_MemoryManager->WriteBus(0x8000, 0x00);
+	m_MemoryManager->WriteBus(0xC000, 9);
+	m_MemoryManager->WriteBus(0xE000, 0);
+
+	ASSERT_TRUE(m_MemoryManager->LoadState(*state));
+	ASSERT_EQ(PRGWindow(0), 30);
+	ASSERT_EQ(PRGWindow(2), 5);
+
+	// Bank select, latch and enable came back with the state
+	m_MemoryManager->WriteBus(0x8001, 7);
+	ASSERT_EQ(PRGWindow(2), 7);
+
+	m_MemoryManager->ClockA12(2);
+	ASSERT_FALSE(m_MemoryManager->IsIRQAsserted());
+
+	m_MemoryManager->ClockA12(1);
+	ASSERT_TRUE(m_MemoryManager->IsIRQAsserted());
+
+	// A state from another board is rejected
+	Load(1, 8, 4);
+	ASSERT_FALSE(m_MemoryManager->LoadState(*state));
+}
+
+TEST_F(MapperTests, CartridgesShareROMImage)
+{
+	auto path = BankedCartridgePath(4, 16, 8);
+
+	emu::Cartridge first(path);
+	emu::Cartridge second(path);
+
+	auto firstPRG = first.GetROM(emu::ROMType::Program).GetData();
+
+	ASSERT_EQ(firstPRG.size(), 16u * 0x4000);
+	ASSERT_EQ(first.GetROM(emu::ROMType::Character).GetSize(), 8u * 0x2000);
+	ASSERT_EQ(firstPRG.data(), second.GetROM(emu::ROMType::Program).GetData().data());
+	ASSERT_EQ(first.GetROM(emu::ROMType::Character).GetData().data(), second.GetROM(emu::ROMType::Character).GetData().data());
+
+	// The bus reads PRG through the shared mapping
+	emu::Controller controller;
+	emu::MemoryManager memoryManager(second, controller);
+
+	ASSERT_EQ(memoryManager.ReadBus(0xE000), 31);
+}
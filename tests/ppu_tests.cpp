@@ -0,0 +1,261 @@
+#include <gtest/gtest.h>
+
+#include "emu/cartridge/cartridge.h"
+#include "emu/memory/memorymanager.h"
+#include "emu/ppu/ppu.h"
+#include "emu/ppu/spriteeval.h"
+#include "emu/ppu/tilerow.h"
+#include "emu/system/powerhandler.h"
+#include "emu/system/simd.h"
+#include "testsupport.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <random>
+#include <vector>
+
+
+// Every SIMD level the host runs is checked against the scalar code and against what the PPU shows
+
+constexpr std::uint16_t PPUSTATUS = 0x2002;
+
+constexpr std::uint8_t SpriteOverflow = 0x20;
+constexpr std::uint8_t SpriteZeroHit = 0x40;
+
+
+static auto SupportedLevels() -> std::vector<emu::SIMDLevel>
+{
+	std::vector<emu::SIMDLevel> levels;
+
+	for (auto level : { emu::SIMDLevel::Scalar, emu::SIMDLevel::SSSE3, emu::SIMDLevel::AVX2 })
+	{
+		if (level <= emu::DetectSIMDLevel())
+			levels.push_back(level);
+	}
+
+	return levels;
+}
+
+// NROM whose CHR tile 0 is opaque everywhere (pixel value 1), background and sprites both draw it
+static auto OpaqueTileCartridgePath() -> std::filesystem::path
+{
+	auto path = std::filesystem::temp_directory_path() / "rexxnes_ppu_tests.nes";
+
+	if (!std::filesystem::exists(path))
+	{
+		std::vector<std::uint8_t> image(16 + 0x4000 + 0x2000);
+		image[0] = 'N';
+		image[1] = 'E';
+		image[2] = 'S';
+		image[3] = 0x1A;
+		image[4] = 1;
+		image[5] = 1;
+
+		std::memset(&image[16 + 0x4000], 0xFF, 8);
+
+		WriteCartridge(path, image);
+	}
+
+	return path;
+}
+
+
+TEST(SpriteFinderTests, LevelsAgreeWithScalar)
+{
+	std::mt19937 random(0x5EED);
+	std::array<std::uint8_t, 0x100> oam{};
+
+	auto scalar = emu::GetSpriteFinder(emu::SIMDLevel::Scalar);
+
+	for (std::uint32_t trial = 0; trial < 64; trial++)
+	{
+		for (auto& value : oam)
+			value = static_cast<std::uint8_t>(random());
+
+		// Hidden sprites below the screen and ones reaching into the first lines
+		for (std::uint32_t sprite = 0; sprite < 16; sprite++)
+			oam[sprite * 4] = static_cast<std::uint8_t>(0xF0 + sprite);
+
+		for (std::uint32_t sprite = 16; sprite < 24; sprite++)
+			oam[sprite * 4] = static_cast<std::uint8_t>(sprite - 16);
+
+		for (std::uint8_t height : { 8, 16 })
+		{
+			for (std::uint32_t row = 0; row < 240; row++)
+			{
+				std::uint64_t expected{ 0 };
+
+				for (std::uint32_t sprite = 0; sprite < 64; sprite++)
+				{
+					std::uint32_t y = oam[sprite * 4];
+
+					if (row >= y && row - y < height)
+						expected |= std::uint64_t{ 1 } << sprite;
+				}
+
+				auto context = std::format("trial {} row {} height {}", trial, row, height);
+
+				ASSERT_EQ(scalar(oam.data(), static_cast<std::uint8_t>(row), height), expected) << context;
+
+				for (auto level : SupportedLevels())
+					ASSERT_EQ(emu::GetSpriteFinder(level)(oam.data(), static_cast<std::uint8_t>(row), height), expected) << context << " " << emu::GetSIMDLevelName(level);
+			}
+		}
+	}
+}
+
+TEST(TileRowExpanderTests, LevelsAgreeWithScalar)
+{
+	std::mt19937 random(0x5EED);
+
+	std::array<std::uint32_t, 32> colors{};
+	std::array<std::uint8_t, 33 * 8> pixelValues{};
+	std::array<emu::TileRow, 33> rows{};
+
+	for (std::uint32_t trial = 0; trial < 64; trial++)
+	{
+		for (auto& color : colors)
+			color = static_cast<std::uint32_t>(random());
+
+		for (auto& value : pixelValues)
+			value = static_cast<std::uint8_t>(random() & 0x03);
+
+		for (std::uint32_t tile = 0; tile < rows.size(); tile++)
+			rows[tile] = emu::TileRow{ &pixelValues[tile * 8], static_cast<std::uint32_t>(random() & 0x07) * 4 };
+
+		std::vector<std::uint32_t> expected(rows.size() * 8);
+
+		for (std::uint32_t pixel = 0; pixel < expected.size(); pixel++)
+			expected[pixel] = colors[rows[pixel / 8].PaletteBase + pixelValues[pixel]];
+
+		for (auto level : SupportedLevels())
+		{
+			std::vector<std::uint32_t> output(expected.size());
+			emu::GetTileRowExpander(level)(rows, colors.data(), output.data());
+
+			ASSERT_EQ(output, expected) << "trial " << trial << " " << emu::GetSIMDLevelName(level);
+		}
+	}
+}
+
+
+class PPUTests : public ::testing::Test
+{
+protected:
+	auto SetUp() -> void override
+	{
+		// Sprites hidden below the screen, background and sprites shown everywhere
+		m_MemoryManager.GetMemoryMap().OAMRAM.Data.assign(0x100, 0xFF);
+		m_MemoryManager.WriteBus(0x2001, 0x1E);
+
+		m_MemoryManager.WritePPURAM(0x3F00, 0x0F);
+		m_MemoryManager.WritePPURAM(0x3F01, 0x16);
+		m_MemoryManager.WritePPURAM(0x3F11, 0x2A);
+	}
+
+	auto SetSprite(std::uint8_t sprite, std::uint8_t y, std::uint8_t x) -> void
+	{
+		auto& oam = m_MemoryManager.GetMemoryMap().OAMRAM.Data;
+
+		oam[sprite * 4] = y;
+		oam[sprite * 4 + 1] = 0;
+		oam[sprite * 4 + 2] = 0;
+		oam[sprite * 4 + 3] = x;
+	}
+
+	// Runs to the end of the visible frame, the status flags stay set until the pre-render line
+	auto RunFrame(emu::SIMDLevel level) -> void
+	{
+		m_PPU.SetSIMDLevel(level);
+
+		while (!m_PPU.Clock(341))
+			;
+	}
+
+	auto Pixel(std::uint32_t x, std::uint32_t y) -> std::uint32_t
+	{
+		std::uint32_t color{ 0 };
+		std::memcpy(&color, &m_PPU.GetFrameExchange().AcquireLatest().Pixels[(y * 256 + x) * 4], sizeof(color));
+
+		return color;
+	}
+
+	auto Status() -> std::uint8_t
+	{
+		return m_MemoryManager.GetPPUIOBit(PPUSTATUS);
+	}
+
+	emu::Cartridge m_Cartridge{ OpaqueTileCartridgePath() };
+	emu::Controller m_Controller;
+	emu::MemoryManager m_MemoryManager{ m_Cartridge, m_Controller };
+	emu::PowerHandler m_PowerHandler{ emu::PowerState::Run };
+	emu::PPU m_PPU{ m_PowerHandler, m_MemoryManager, 0 };
+};
+
+
+TEST_F(PPUTests, EightSpritesPerLine)
+{
+	// Nine sprites covering lines 50 - 57, sprite n at x = 16n + 8
+	for (std::uint8_t sprite = 0; sprite < 9; sprite++)
+		SetSprite(sprite, 49, static_cast<std::uint8_t>(sprite * 16 + 8));
+
+	auto background = m_MemoryManager.GetPalette().GetColor(0x01);
+	auto foreground = m_MemoryManager.GetPalette().GetColor(0x11);
+
+	for (auto level : SupportedLevels())
+	{
+		RunFrame(level);
+
+		auto context = emu::GetSIMDLevelName(level);
+
+		ASSERT_TRUE(Status() & SpriteOverflow) << context;
+		ASSERT_EQ(Pixel(7 * 16 + 8, 50), foreground) << context;
+		ASSERT_EQ(Pixel(7 * 16 + 15, 57), foreground) << context;
+		ASSERT_EQ(Pixel(7 * 16 + 8, 49), background) << context;
+		ASSERT_EQ(Pixel(7 * 16 + 8, 58), background) << context;
+
+		// The ninth sprite in OAM order is dropped
+		ASSERT_EQ(Pixel(8 * 16 + 8, 50), background) << context;
+	}
+
+	// Eight fit, a sprite parked below the screen does not wrap around into the first lines
+	SetSprite(8, 0xFF, 0);
+
+	for (auto level : SupportedLevels())
+	{
+		RunFrame(level);
+		ASSERT_FALSE(Status() & SpriteOverflow) << emu::GetSIMDLevelName(level);
+	}
+}
+
+TEST_F(PPUTests, SpriteZeroHit)
+{
+	// Sprite 1 overlaps the opaque background, only sprite 0 counts
+	SetSprite(1, 99, 100);
+
+	for (auto level : SupportedLevels())
+	{
+		RunFrame(level);
+		ASSERT_FALSE(Status() & SpriteZeroHit) << emu::GetSIMDLevelName(level);
+	}
+
+	SetSprite(0, 99, 100);
+
+	for (auto level : SupportedLevels())
+	{
+		RunFrame(level);
+		ASSERT_TRUE(Status() & SpriteZeroHit) << emu::GetSIMDLevelName(level);
+	}
+
+	// Without background there is nothing to hit
+	m_MemoryManager.WriteBus(0x2001, 0x14);
+
+	for (auto level : SupportedLevels())
+	{
+		RunFrame(level);
+		ASSERT_FALSE(Status() & SpriteZeroHit) << emu::GetSIMDLevelName(level);
+	}
+}
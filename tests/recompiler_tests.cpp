@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+
+#include "emu/cartridge/cartridge.h"
+#include "emu/cpu6502/cpu.h"
+#include "emu/memory/memorymanager.h"
+#include "emu/system/powerhandler.h"
+#include "testsupport.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <random>
+#include <string>
+#include <vector>
+
+
+// Compiled code is compared against the interpreter running the same program on a second machine
+
+constexpr std::uint16_t ProgramAddress = 0x0300;
+constexpr std::uint32_t TrialsPerOpCode = 64;
+
+constexpr const char* ROMPath = "rom/SuperMarioBros.nes";
+
+
+struct Machine
+{
+	explicit Machine(bool recompiler)
+	{
+		CPU.SetRecompilerEnabled(recompiler);
+		CPU.GetRecompiler().SetHotThreshold(1);
+	}
+
+	auto Load(const std::vector<std::uint8_t>& ram, const emu::Registers& registers) -> void
+	{
+		// Through the bus, so watched code pages see the writes
+		for (std::uint16_t address = 0; address < ram.size(); address++)
+			MemoryManager.WriteBus(address, ram[address]);
+
+		CPU.GetRegisters() = registers;
+		MemoryManager.ClearNMI();
+	}
+
+	emu::Cartridge Cartridge{ EmptyCartridgePath() };
+	emu::Controller Controller;
+	emu::MemoryManager MemoryManager{ Cartridge, Controller };
+	emu::PowerHandler PowerHandler{ emu::PowerState::Run };
+	emu::CPU CPU{ PowerHandler, MemoryManager };
+};
+
+
+static auto ExpectSameState(Machine& interpreted, Machine& compiled, const std::string& context) -> void
+{
+	auto& expected = interpreted.CPU.GetRegisters();
+	auto& actual = compiled.CPU.GetRegisters();
+
+	EXPECT_EQ(actual.A, expected.A) << context;
+	EXPECT_EQ(actual.X, expected.X) << context;
+	EXPECT_EQ(actual.Y, expected.Y) << context;
+	EXPECT_EQ(actual.SP, expected.SP) << context;
+	EXPECT_EQ(actual.PC, expected.PC) << context;
+	EXPECT_EQ(actual.GetP(), expected.GetP()) << context;
+	EXPECT_EQ(compiled.CPU.GetCycles(), interpreted.CPU.GetCycles()) << context;
+
+	EXPECT_EQ(compiled.MemoryManager.GetMemoryMap().CPURAM.Data, interpreted.MemoryManager.GetMemoryMap().CPURAM.Data) << context;
+	EXPECT_EQ(compiled.MemoryManager.GetMemoryMap().ProgramRAM.Data, interpreted.MemoryManager.GetMemoryMap().ProgramRAM.Data) << context;
+}
+
+
+class RecompilerTests : public ::testing::Test
+{
+protected:
+	auto SetUp() -> void override
+	{
+		if (!emu::Recompiler::IsSupported())
+			GTEST_SKIP() << "The recompiler only targets x86-64";
+	}
+};
+
+
+// Each opcode from random registers, flags and RAM, with operands pointing into RAM most of the time
+// and anywhere on the bus otherwise
+TEST_F(RecompilerTests, MatchesInterpreterPerInstruction)
+{
+	std::mt19937 random(0x6502);
+	auto byte = [&random] { return static_cast<std::uint8_t>(random()); };
+
+	Machine interpreted(false);
+	Machine compiled(true);
+
+	std::vector<std::uint8_t> ram(0x800);
+
+	for (std::uint32_t opCode = 0; opCode < 0x100; opCode++)
+	{
+		if (emu::CPU::GetMnemonic(static_cast<std::uint8_t>(opCode)).empty())
+			continue;
+
+		for (std::uint32_t trial = 0; trial < TrialsPerOpCode; trial++)
+		{
+			for (auto& value : ram)
+				value = byte();
+
+			// Zero page operands at the end of the page catch indexing that wraps where it should not
+			ram[ProgramAddress] = static_cast<std::uint8_t>(opCode);
+			ram[ProgramAddress + 1] = trial % 8 == 7 ? 0xFF : ram[ProgramAddress + 1];
+			ram[ProgramAddress + 2] = trial % 4 ? byte() & 0x07 : byte();
+
+			emu::Registers registers{ byte(), byte(), byte(), ProgramAddress, byte() };
+			registers.SetP(byte());
+
+			interpreted.Load(ram, registers);
+			compiled.Load(ram, registers);
+
+			auto expectedCycles = interpreted.CPU.Step();
+			auto cycles = compiled.CPU.Run(1);
+
+			auto context = std::format("opcode {:02x} ({}) trial {}", opCode, emu::CPU::GetMnemonic(static_cast<std::uint8_t>(opCode)), trial);
+
+			ASSERT_EQ(cycles, expectedCycles) << context;
+			ExpectSameState(interpreted, compiled, context);
+
+			if (HasFailure())
+				return;
+		}
+	}
+
+	auto& recompiler = compiled.CPU.GetRecompiler();
+
+	ASSERT_GT(recompiler.GetCompiledBlocks(), 0u);
+	ASSERT_GT(recompiler.GetNativeInstructions(), 0u);
+}
+
+// A loop closing on its own block start stays in compiled code, it still has to stop at the budget
+TEST_F(RecompilerTests, LoopsStopAtTheCycleBudget)
+{
+	std::vector<std::uint8_t> ram(0x800);
+	std::vector<std::uint8_t> program
+	{
+		0xA2, 0x00,			// LDX #$00
+		0xE8,				// INX
+		0x9D, 0x00, 0x04,	// STA $0400,X
+		0xE0, 0xC0,			// CPX #$C0
+		0xD0, 0xF8,			// BNE $0302
+		0x69, 0x01,			// ADC #$01
+		0x4C, 0x00, 0x03,	// JMP $0300
+	};
+
+	std::ranges::copy(program, ram.begin() + ProgramAddress);
+
+	Machine interpreted(false);
+	Machine compiled(true);
+
+	emu::Registers registers{};
+	registers.PC = ProgramAddress;
+
+	interpreted.Load(ram, registers);
+	compiled.Load(ram, registers);
+
+	for (std::uint32_t slice = 0; slice < 2000; slice++)
+	{
+		auto budget = 100 + slice % 29;
+
+		ASSERT_EQ(compiled.CPU.Run(budget), interpreted.CPU.Run(budget)) << "slice " << slice;
+		ExpectSameState(interpreted, compiled, std::format("slice {}", slice));
+
+		if (HasFailure())
+			return;
+	}
+
+	ASSERT_GT(compiled.CPU.GetRecompiler().GetNativeInstructions(), 0u);
+}
+
+// Whole frames of a real game, drawn the same with and without the recompiler
+TEST_F(RecompilerTests, RunsSuperMarioBrosLikeTheInterpreter)
+{
+	if (!std::filesystem::exists(ROMPath))
+		GTEST_SKIP() << ROMPath << " not found";
+
+	emu::Cartridge cartridge(ROMPath);
+	Console interpreted(cartridge, false);
+	Console compiled(cartridge, true);
+
+	for (std::uint64_t frame = 0; frame < 900; frame++)
+		ASSERT_EQ(compiled.RunFrames(1), interpreted.RunFrames(1)) << "frame " << frame;
+
+	ASSERT_EQ(compiled.CPU.GetCycles(), interpreted.CPU.GetCycles());
+	ASSERT_GT(compiled.CPU.GetRecompiler().GetCompiledBlocks(), 0u);
+}
@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+
+#include "emu/cartridge/cartridge.h"
+#include "emu/system/hash.h"
+#include "emu/system/rewindbuffer.h"
+#include "emu/system/savestate.h"
+#include "testsupport.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+
+
+// Round trips run Super Mario Bros from the source tree, they are skipped when the ROM is missing
+
+constexpr const char* ROMPath = "rom/SuperMarioBros.nes";
+
+constexpr std::uint64_t SaveFrame = 600;
+constexpr std::uint64_t CompareFrames = 120;
+
+
+static auto Bytes(const emu::MachineState& state) -> std::span<const std::uint8_t>
+{
+	return { reinterpret_cast<const std::uint8_t*>(&state), sizeof(state) };
+}
+
+
+class SaveStateTests : public ::testing::Test
+{
+protected:
+	auto SetUp() -> void override
+	{
+		if (!std::filesystem::exists(ROMPath))
+			GTEST_SKIP() << ROMPath << " not found";
+
+		m_Cartridge = std::make_unique<emu::Cartridge>(ROMPath);
+		m_Console = std::make_unique<Console>(*m_Cartridge);
+	}
+
+	std::unique_ptr<emu::Cartridge> m_Cartridge;
+	std::unique_ptr<Console> m_Console;
+};
+
+
+TEST_F(SaveStateTests, RoundTripReproducesFrames)
+{
+	m_Console->RunFrames(SaveFrame);
+
+	emu::MachineState state{};
+	m_Console->System.SaveState(state);
+
+	auto expected = m_Console->RunFrames(CompareFrames);
+
+	// Same console, rewound
+	ASSERT_TRUE(m_Console->System.LoadState(state));
+	ASSERT_EQ(m_Console->System.GetFrameCount(), SaveFrame);
+	ASSERT_EQ(m_Console->RunFrames(CompareFrames), expected);
+
+	// Freshly powered console
+	Console other(*m_Cartridge);
+	other.RunFrames(10);
+
+	ASSERT_TRUE(other.System.LoadState(state));
+	ASSERT_EQ(other.RunFrames(CompareFrames), expected);
+}
+
+TEST_F(SaveStateTests, RoundTripInTheMiddleOfAFrame)
+{
+	m_Console->RunFrames(SaveFrame);
+
+	for (auto instruction = 0; instruction < 5000; instruction++)
+		m_Console->System.StepInstruction();
+
+	emu::MachineState state{};
+	m_Console->System.SaveState(state);
+
+	auto expected = m_Console->RunFrames(CompareFrames);
+
+	// The lines drawn before the save are not part of the state, the first frame is incomplete
+	Console other(*m_Cartridge);
+
+	ASSERT_TRUE(other.System.LoadState(state));
+
+	emu::MachineState reloaded{};
+	other.System.SaveState(reloaded);
+
+	ASSERT_EQ(emu::HashBytes(Bytes(reloaded)), emu::HashBytes(Bytes(state)));
+
+	auto frames = other.RunFrames(CompareFrames);
+
+	ASSERT_TRUE(std::equal(frames.begin() + 1, frames.end(), expected.begin() + 1));
+}
+
+TEST_F(SaveStateTests, SavedStateIsDeterministic)
+{
+	m_Console->RunFrames(SaveFrame);
+
+	emu::MachineState first{};
+	emu::MachineState second{};
+	m_Console->System.SaveState(first);
+
+	ASSERT_TRUE(m_Console->System.LoadState(first));
+	m_Console->System.SaveState(second);
+
+	ASSERT_EQ(first.Header.Size, sizeof(emu::MachineState));
+	ASSERT_EQ(emu::HashBytes(Bytes(first)), emu::HashBytes(Bytes(second)));
+}
+
+TEST_F(SaveStateTests, RejectsOtherVersions)
+{
+	emu::MachineState state{};
+	m_Console->System.SaveState(state);
+
+	state.Header.Version++;
+	ASSERT_FALSE(m_Console->System.LoadState(state));
+
+	state.Header.Version--;
+	state.Header.Magic = 0;
+	ASSERT_FALSE(m_Console->System.LoadState(state));
+}
+
+TEST_F(SaveStateTests, RewindReturnsRecordedStates)
+{
+	constexpr std::uint32_t Capacity = 120;
+
+	emu::RewindBuffer rewindBuffer(Capacity);
+	std::vector<std::uint64_t> recorded;
+
+	m_Console->RunFrames(SaveFrame);
+
+	for (std::uint32_t frame = 0; frame < Capacity * 2; frame++)
+	{
+		m_Console->RunFrames(1);
+
+		emu::MachineState* state{ nullptr };
+
+		while (!(state = rewindBuffer.BeginCapture()))
+			std::this_thread::yield();
+
+		m_Console->System.SaveState(*state);
+		recorded.push_back(emu::HashBytes(Bytes(*state)));
+
+		rewindBuffer.EndCapture();
+	}
+
+	// Deltas compress to a fraction of the raw states
+	emu::MachineState state{};
+	ASSERT_TRUE(rewindBuffer.StepBack(state));
+	ASSERT_LT(rewindBuffer.GetMemoryUsage(), rewindBuffer.GetFrameCount() * sizeof(emu::MachineState) / 8);
+
+	// Oldest groups are dropped whole, at least the newest Capacity - KeyframeInterval frames are kept
+	std::uint32_t rewound{ 1 };
+	ASSERT_EQ(emu::HashBytes(Bytes(state)), recorded.back());
+
+	while (rewindBuffer.StepBack(state))
+	{
+		rewound++;
+		ASSERT_EQ(emu::HashBytes(Bytes(state)), recorded[recorded.size() - rewound]);
+	}
+
+	ASSERT_GE(rewound, Capacity - emu::RewindBuffer::KeyframeInterval);
+	ASSERT_LE(rewound, Capacity);
+	ASSERT_EQ(rewindBuffer.GetFrameCount(), 0u);
+
+	// Recording continues on top of a rewound history
+	ASSERT_TRUE(m_Console->System.LoadState(state));
+	m_Console->RunFrames(1);
+
+	auto next = rewindBuffer.BeginCapture();
+	ASSERT_NE(next, nullptr);
+
+	m_Console->System.SaveState(*next);
+	auto expected = emu::HashBytes(Bytes(*next));
+	rewindBuffer.EndCapture();
+
+	ASSERT_TRUE(rewindBuffer.StepBack(state));
+	ASSERT_EQ(emu::HashBytes(Bytes(state)), expected);
+}
+
+TEST_F(SaveStateTests, RunAheadShowsFutureFrames)
+{
+	constexpr std::uint32_t Depth = 2;
+	constexpr std::uint32_t Frames = 60;
+
+	// Run-ahead predicts with the current input, it is held for the whole comparison
+	auto runRight = [](Console& console, std::uint32_t frames)
+	{
+		std::vector<std::uint64_t> hashes;
+
+		for (std::uint32_t frame = 0; frame < frames; frame++)
+		{
+			console.Controller.SetButtonBits(0x80);
+			console.System.RunFrameAhead();
+
+			hashes.push_back(emu::HashBytes(console.PPU.GetFrameExchange().AcquireLatest().Pixels));
+		}
+
+		return hashes;
+	};
+
+	m_Console->RunFrames(SaveFrame);
+	auto expected = runRight(*m_Console, Frames + Depth);
+
+	Console ahead(*m_Cartridge);
+	ahead.RunFrames(SaveFrame);
+	ahead.System.SetRunAhead(Depth);
+
+	auto frames = runRight(ahead, Frames);
+
+	ASSERT_EQ(ahead.System.GetFrameCount(), SaveFrame + Frames);
+	ASSERT_TRUE(std::equal(frames.begin(), frames.end(), expected.begin() + Depth));
+}
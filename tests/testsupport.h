@@ -0,0 +1,108 @@
+#pragma once
+
+#include "emu/apu/apu.h"
+#include "emu/cartridge/cartridge.h"
+#include "emu/cpu6502/cpu.h"
+#include "emu/memory/memorymanager.h"
+#include "emu/ppu/ppu.h"
+#include "emu/system/hash.h"
+#include "emu/system/powerhandler.h"
+#include "emu/system/system.h"
+#include "input/controller.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <random>
+#include <system_error>
+#include <vector>
+
+
+// Helpers shared by the test executables. ctest runs every test as its own process, often in
+// parallel, so cartridge images are published with a rename and never seen half written.
+
+inline auto WriteCartridge(const std::filesystem::path& path, const std::vector<std::uint8_t>& image) -> void
+{
+	auto temporaryPath = path;
+	temporaryPath += std::format(".{:08x}", std::random_device{}());
+
+	{
+		std::ofstream fs(temporaryPath, std::ios::out | std::ios::binary);
+		fs.write(reinterpret_cast<const char*>(image.data()), image.size());
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+
+	// Fails where another process has the destination mapped, it already holds the same image
+	if (error)
+		std::filesystem::remove(temporaryPath, error);
+}
+
+// NROM with 16KB of zeroed PRG and 8KB of CHR, for programs that run from CPU RAM
+inline auto EmptyCartridgePath() -> std::filesystem::path
+{
+	auto path = std::filesystem::temp_directory_path() / "rexxnes_tests_empty.nes";
+
+	if (!std::filesystem::exists(path))
+	{
+		std::vector<std::uint8_t> image(16 + 0x4000 + 0x2000);
+		image[0] = 'N';
+		image[1] = 'E';
+		image[2] = 'S';
+		image[3] = 0x1A;
+		image[4] = 1;
+		image[5] = 1;
+
+		WriteCartridge(path, image);
+	}
+
+	return path;
+}
+
+
+// A whole console on one cartridge, driven by a fixed input script so runs can be compared frame by frame
+struct Console
+{
+	explicit Console(const emu::Cartridge& cartridge, bool recompiler = false)
+		: MemoryManager(cartridge, Controller)
+	{
+		CPU.SetRecompilerEnabled(recompiler);
+		System.Reset();
+	}
+
+	// Start on the title screen, then run right and jump every half second
+	auto RunFrames(std::uint64_t frames) -> std::vector<std::uint64_t>
+	{
+		std::vector<std::uint64_t> hashes;
+
+		for (std::uint64_t i = 0; i < frames; i++)
+		{
+			auto frame = System.GetFrameCount();
+			std::uint8_t buttons{ 0 };
+
+			if (frame >= 40 && frame < 45)
+				buttons = 0x08;
+			else if (frame >= 300)
+				buttons = (frame % 30) < 12 ? 0x81 : 0x80;
+
+			Controller.SetButtonBits(buttons);
+			System.RunFrame();
+
+			hashes.push_back(emu::HashBytes(PPU.GetFrameExchange().AcquireLatest().Pixels));
+		}
+
+		return hashes;
+	}
+
+	emu::Controller Controller;
+	emu::MemoryManager MemoryManager;
+	emu::PowerHandler PowerHandler{ emu::PowerState::Run };
+
+	emu::PPU PPU{ PowerHandler, MemoryManager, 0 };
+	emu::APU APU{ PowerHandler, MemoryManager };
+	emu::CPU CPU{ PowerHandler, MemoryManager };
+
+	emu::System System{ PowerHandler, CPU, PPU, APU };
+};